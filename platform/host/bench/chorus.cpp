@@ -0,0 +1,116 @@
+/*
+ * File: chorus.cpp
+ *
+ * Host benchmark for dsp::Chorus against two separate per-timbre chorus implementations.
+ *
+ * 2018 (c) Korg
+ *
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include <algorithm>
+
+#include "chorus.hpp"
+
+static const uint32_t k_voices = 3;
+static const uint32_t k_frames = 64;
+static const uint32_t k_blocks = 20000;
+static const uint32_t k_passes = 5;
+static const uint32_t k_line_size = 8192;
+static const float k_fs_recip = 1.f / 48000.f;
+
+/*
+ * Reference: one instance per timbre, LFOs evaluated and delay read on every frame.
+ */
+struct NaiveChorus {
+  dsp::DelayLine line;
+  dsp::SimpleLFO lfo;
+  dsp::SimpleLFO lfo2;
+  float delay, depth, depth2;
+
+  void process(const float *xn, float *yn, uint32_t frames) {
+    const float norm = 1.f / k_voices;
+    for (uint32_t t = 0; t < frames; ++t) {
+      const float l = xn[2*t], r = xn[2*t+1];
+      line.write(0.5f * (l + r));
+      lfo.cycle();
+      lfo2.cycle();
+      float yl = 0.f, yr = 0.f;
+      for (uint32_t v = 0; v < k_voices; ++v) {
+        const float off = (float)v / k_voices - 0.5f;
+        const float pan = (float)v / (k_voices - 1) - 0.5f;
+        const float s = line.readFrac(delay + depth * lfo.sine_bi_off(off) + depth2 * lfo2.sine_bi_off(off));
+        yl += norm * (1.f - 2.f * clipminf(0.f, pan)) * s;
+        yr += norm * (1.f + 2.f * clipmaxf(pan, 0.f)) * s;
+      }
+      yn[2*t]   = 0.5f * l + 0.5f * yl;
+      yn[2*t+1] = 0.5f * r + 0.5f * yr;
+    }
+  }
+};
+
+static f32pair_t s_ram[k_line_size];
+static float s_ram_main[k_line_size];
+static float s_ram_sub[k_line_size];
+
+static float s_main_x[2*k_frames], s_main_y[2*k_frames];
+static float s_sub_x[2*k_frames], s_sub_y[2*k_frames];
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+template<typename F>
+static double measure(F f) {
+  double best = 1e300;
+  for (uint32_t pass = 0; pass < k_passes; ++pass) {
+    const double t0 = now_ns();
+    for (uint32_t b = 0; b < k_blocks; ++b)
+      f();
+    best = std::min(best, (now_ns() - t0) / k_blocks);
+  }
+  return best;
+}
+
+int main(void) {
+  for (uint32_t i = 0; i < 2*k_frames; ++i) {
+    s_main_x[i] = (float)(i % 17) / 17.f - 0.5f;
+    s_sub_x[i] = (float)(i % 23) / 23.f - 0.5f;
+  }
+
+  static dsp::Chorus<k_voices> chorus;
+  chorus.setMemory(s_ram, k_line_size);
+  chorus.setDelay(480.f);
+  chorus.setModulation(0.6f, 96.f, k_fs_recip);
+  chorus.setVibrato(6.f, 8.f, k_fs_recip);
+
+  static NaiveChorus naive[2];
+  naive[0].line.setMemory(s_ram_main, k_line_size);
+  naive[1].line.setMemory(s_ram_sub, k_line_size);
+  for (uint32_t i = 0; i < 2; ++i) {
+    naive[i].line.clear();
+    naive[i].lfo.setF0(0.6f, k_fs_recip);
+    naive[i].lfo2.setF0(6.f, k_fs_recip);
+    naive[i].delay = 480.f;
+    naive[i].depth = 96.f;
+    naive[i].depth2 = 8.f;
+  }
+
+  const double t_chorus = measure([&]() {
+      chorus.process(s_main_x, s_main_y, s_sub_x, s_sub_y, k_frames);
+    });
+  const double t_naive = measure([&]() {
+      naive[0].process(s_main_x, s_main_y, k_frames);
+      naive[1].process(s_sub_x, s_sub_y, k_frames);
+    });
+
+  printf("chorus: %u voices, %u frames/block\n", k_voices, k_frames);
+  printf("  one pass, block LFO:         %8.0f ns/block\n", t_chorus);
+  printf("  two instances, frame LFO:    %8.0f ns/block\n", t_naive);
+  printf("  speedup:                     %8.2fx\n", t_naive / t_chorus);
+
+  return (t_chorus < t_naive) ? 0 : 1;
+}
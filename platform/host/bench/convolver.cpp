@@ -0,0 +1,109 @@
+/*
+ * File: convolver.cpp
+ *
+ * Host benchmark for dsp::Convolver: per callback cost and accuracy against direct convolution.
+ *
+ * 2018 (c) Korg
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <algorithm>
+#include <vector>
+
+#include "convolver.hpp"
+
+typedef dsp::Convolver<32, 8, 2> Convolver;
+
+static const uint32_t k_samplerate = 48000;
+static const uint32_t k_ir_len = k_samplerate * 3 / 2;
+static const uint32_t k_test_frames = k_samplerate * 10;
+static const uint32_t k_checks = 256;
+static const uint32_t k_passes = 5;
+
+static float s_mem[Convolver::memorySize(k_ir_len)];
+static Convolver s_conv;
+
+static uint32_t s_seed = 0x12345678;
+
+static float noise(void) {
+  s_seed = s_seed * 1664525 + 1013904223;
+  return (int32_t)s_seed * (1.f / 2147483648.f);
+}
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int run(const std::vector<float> &ir, const std::vector<float> &in, uint32_t frames) {
+  std::vector<float> out(in.size());
+  std::vector<double> cost(k_test_frames / frames, 1e300);
+
+  // Keep the fastest of several passes per callback to filter out host scheduling noise,
+  // the processing sequence being identical across passes
+  for (uint32_t pass = 0; pass < k_passes; ++pass) {
+    const uint32_t used = s_conv.init(s_mem, sizeof(s_mem) / sizeof(float), &ir[0], ir.size());
+    if (used != ir.size()) {
+      fprintf(stderr, "impulse response truncated to %u samples\n", used);
+      return 1;
+    }
+    for (uint32_t i = 0, c = 0; i + frames <= k_test_frames; i += frames, ++c) {
+      const double t0 = now_ns();
+      s_conv.process(&in[2*i], &out[2*i], frames);
+      cost[c] = std::min(cost[c], now_ns() - t0);
+    }
+  }
+
+  // Compare against direct convolution at scattered output positions
+  double max_err = 0, max_ref = 0;
+  for (uint32_t c = 0; c < k_checks; ++c) {
+    const uint32_t t = Convolver::k_latency + (uint32_t)((uint64_t)c * (k_test_frames - 2 * frames) / k_checks);
+    const uint32_t src = t - Convolver::k_latency;
+    for (uint32_t ch = 0; ch < 2; ++ch) {
+      double ref = 0;
+      for (uint32_t m = 0; m < ir.size() && m <= src; ++m)
+        ref += (double)ir[m] * in[2*(src - m) + ch];
+      max_err = std::max(max_err, (double)fabs(ref - out[2*t + ch]));
+      max_ref = std::max(max_ref, fabs(ref));
+    }
+  }
+
+  const double budget = 1e9 * frames / k_samplerate;
+  double sum = 0;
+  for (size_t i = 0; i < cost.size(); ++i)
+    sum += cost[i];
+  std::vector<double> sorted(cost);
+  std::sort(sorted.begin(), sorted.end());
+  const double mean = sum / cost.size();
+  const double p99 = sorted[sorted.size() * 99 / 100];
+  const double worst = sorted.back();
+
+  printf("%3u frames/call: mean %8.0f ns  p99 %8.0f ns  worst %8.0f ns  (worst %.2f%% of %.0f ns)  max err %.2e (peak %.2f)\n",
+         frames, mean, p99, worst, 100. * worst / budget, budget, max_err, max_ref);
+
+  return (max_err > 1e-4 * max_ref) ? 1 : 0;
+}
+
+int main(void) {
+  std::vector<float> ir(k_ir_len);
+  for (uint32_t i = 0; i < k_ir_len; ++i)
+    ir[i] = 0.1f * noise() * expf(-6.9f * i / k_ir_len);
+
+  std::vector<float> in(2 * k_test_frames);
+  for (uint32_t i = 0; i < 2 * k_test_frames; ++i)
+    in[i] = noise();
+
+  printf("convolver: %u taps, %u segments, head %u, largest partition %u, %zu KiB\n",
+         k_ir_len, (uint32_t)Convolver::k_segments, Convolver::partitionSize(0),
+         (uint32_t)Convolver::k_max_partition, sizeof(s_mem) / 1024);
+
+  int err = 0;
+  err |= run(ir, in, 32);
+  err |= run(ir, in, 64);
+  err |= run(ir, in, 17);
+  return err;
+}
@@ -0,0 +1,114 @@
+/*
+ * File: dynamics.cpp
+ *
+ * Host benchmark for dsp::Compressor look-ahead timing and per frame cost.
+ *
+ * 2018 (c) Korg
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <algorithm>
+
+#include "dynamics.hpp"
+
+static const uint32_t k_control_rate = 16;
+static const uint32_t k_frames = 64;
+static const uint32_t k_line_size = 256;
+static const uint32_t k_blocks = 20000;
+static const uint32_t k_passes = 5;
+static const float k_fs_recip = 1.f / 48000.f;
+
+typedef dsp::Compressor<k_control_rate> Compressor;
+
+static f32pair_t s_ram[k_line_size];
+
+static float s_x[2*k_line_size], s_y[2*k_line_size];
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/*
+ * Impulse below threshold, about unity gain: it must come out exactly lookahead frames late on both channels.
+ */
+static uint32_t check_delay(const uint32_t lookahead) {
+  static Compressor comp;
+  comp = Compressor();
+  comp.setCurve(0.f, 4.f, 0.f);
+  comp.setTimes(0.001f, 0.1f, k_fs_recip);
+  comp.setLookahead(s_ram, k_line_size, lookahead);
+
+  memset(s_x, 0, sizeof(s_x));
+  s_x[0] = 0.5f;
+  s_x[1] = -0.25f;
+  comp.process(s_x, s_y, k_line_size);
+
+  uint32_t errors = 0;
+  for (uint32_t t = 0; t < k_line_size; ++t) {
+    const float l = (t == lookahead) ? 0.5f : 0.f;
+    const float r = (t == lookahead) ? -0.25f : 0.f;
+    if (fabsf(s_y[2*t] - l) > 1e-5f || fabsf(s_y[2*t+1] - r) > 1e-5f)
+      ++errors;
+  }
+  printf("  look-ahead %3u frames:      %s\n", (unsigned)lookahead, errors ? "wrong delay" : "ok");
+  return errors;
+}
+
+/*
+ * Step into a limiter with instant attack, at every phase of the control period: with look-ahead of two control
+ * periods the gain is in place when the step reaches the output.
+ */
+static uint32_t check_limit(void) {
+  static Compressor comp;
+  const uint32_t lookahead = 2 * k_control_rate;
+  const float ceiling = 0.5f;
+  float peak = 0.f;
+  for (uint32_t phase = 0; phase < k_control_rate; ++phase) {
+    comp = Compressor();
+    comp.setLimiter(-6.0206f);
+    comp.setTimes(0.f, 0.1f, k_fs_recip);
+    comp.setLookahead(s_ram, k_line_size, lookahead);
+    for (uint32_t t = 0; t < k_line_size; ++t)
+      s_x[2*t] = s_x[2*t+1] = (t < k_line_size / 2 + phase) ? 0.f : 1.f;
+    comp.process(s_x, s_y, k_line_size);
+    for (uint32_t i = 0; i < 2*k_line_size; ++i)
+      peak = std::max(peak, s_y[i]);
+  }
+  const bool ok = peak <= ceiling * 1.01f;
+  printf("  step peak, limit %.2f:      %.4f %s\n", ceiling, peak, ok ? "ok" : "over ceiling");
+  return ok ? 0 : 1;
+}
+
+int main(void) {
+  printf("compressor: control period %u frames, %u frames/block\n", k_control_rate, k_frames);
+
+  uint32_t errors = 0;
+  const uint32_t lookaheads[] = {1, 2, k_control_rate, 48, k_line_size - 1};
+  for (uint32_t i = 0; i < sizeof(lookaheads) / sizeof(lookaheads[0]); ++i)
+    errors += check_delay(lookaheads[i]);
+  errors += check_limit();
+
+  static Compressor comp;
+  comp.setCurve(-18.f, 4.f, 6.f);
+  comp.setTimes(0.002f, 0.15f, k_fs_recip);
+  comp.setLookahead(s_ram, k_line_size, 48);
+  for (uint32_t i = 0; i < 2*k_frames; ++i)
+    s_x[i] = (float)(i % 17) / 17.f - 0.5f;
+
+  double best = 1e300;
+  for (uint32_t pass = 0; pass < k_passes; ++pass) {
+    const double t0 = now_ns();
+    for (uint32_t b = 0; b < k_blocks; ++b)
+      comp.process(s_x, s_y, k_frames);
+    best = std::min(best, (now_ns() - t0) / k_blocks);
+  }
+  printf("  look-ahead 48, soft knee:    %8.0f ns/block\n", best);
+
+  return errors ? 1 : 0;
+}
@@ -0,0 +1,69 @@
+/*
+ * File: api_curves.h
+ *
+ * Definitions of the curves sampled into the firmware lookup tables, shared by the
+ * host table generator and the characterization tools.
+ *
+ * 2018 (c) Korg
+ *
+ */
+
+#ifndef __api_curves_h
+#define __api_curves_h
+
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/** Fractional bit depth, exponentially mapped from 24 bits at 0 down to 1 bit at 1. */
+static inline double api_curve_bitres(double x) {
+  return pow(2.0, pow(24.0, 1.0 - x));
+}
+
+/** Linear below the 0.42264973081 knee with 1.2383127573 gain, cubic Hermite segment to unity above it. */
+static inline double api_curve_cubicsat(double x) {
+  const double t = 0.42264973081, g = 1.2383127573;
+  if (x <= t)
+    return g * x;
+  const double w = 1.0 - t, u = (x - t) / w;
+  const double h00 = 2*u*u*u - 3*u*u + 1, h10 = u*u*u - 2*u*u + u, h01 = -2*u*u*u + 3*u*u;
+  return h00 * g * t + h10 * w * g + h01;
+}
+
+/** Schetzen overdrive curve. */
+static inline double api_curve_schetzen(double x) {
+  if (x < 1.0/3.0)
+    return 2.0 * x;
+  if (x < 2.0/3.0)
+    return (3.0 - (2.0 - 3.0*x) * (2.0 - 3.0*x)) / 3.0;
+  return 1.0;
+}
+
+/**
+ * Harmonic amplitudes of the placeholder wave banks.
+ *
+ * The firmware wave banks are not published, only their organization in categories A to F of increasing harmonic
+ * content. Bank b holds waves with 4(b+1)+i harmonics rolling off as 1/h^p, p going from 2 in bank A to 0.75 in
+ * bank F, odd harmonics only for odd wave indexes.
+ */
+static inline double api_curve_wave_harmonic(int bank, int index, int h) {
+  if (h > 4 * (bank + 1) + index || ((index & 1) && !(h & 1)))
+    return 0.0;
+  return pow((double)h, -(2.0 - 0.25 * bank));
+}
+
+/*
+ * Band-limited saw, square and parabolic waves. The firmware tables are not documented either: table i holds the
+ * harmonics below Nyquist at note API_CURVE_BL_NOTES[i], at most the 127 a 256 point period can hold, so that it is
+ * alias free up to that note. Saw and square harmonics fall as 1/h, parabola harmonics as 1/h^2.
+ */
+#define API_CURVE_BL_NOTES {55, 67, 79, 91, 103, 115, 127}
+
+static inline int api_curve_bl_harmonics(int note) {
+  const int h = (int)(24000.0 / (440.0 * pow(2.0, (note - 69) / 12.0)));
+  return (h > 127) ? 127 : h;
+}
+
+#endif // __api_curves_h
@@ -0,0 +1,97 @@
+/*
+ * File: api_host.c
+ *
+ * Host implementation of the runtime services declared in osc_api.h and fx_api.h.
+ *
+ * Random sources are deterministic so that host runs are reproducible.
+ *
+ * 2018 (c) Korg
+ *
+ */
+
+#include <stdint.h>
+#include <math.h>
+
+#include "userprg.h"
+#include "osc_api.h"
+#include "api_host.h"
+
+#ifndef USER_TARGET_PLATFORM
+#define USER_TARGET_PLATFORM (k_user_target_prologue)
+#endif
+
+const uint32_t k_osc_api_platform = USER_TARGET_PLATFORM;
+const uint32_t k_osc_api_version = USER_API_VERSION;
+const uint32_t k_fx_api_platform = USER_TARGET_PLATFORM;
+const uint32_t k_fx_api_version = USER_API_VERSION;
+
+/* Per thread, so that concurrent renders stay deterministic */
+static __thread uint32_t s_rand_state = API_HOST_DEFAULT_SEED;
+static __thread float s_bpmf = 120.f;
+static __thread float s_white_spare;
+static __thread int s_white_has_spare = 0;
+
+void api_host_seed(uint32_t seed) {
+  s_rand_state = (seed % 0x7FFFFFFEU) + 1;
+  s_white_has_spare = 0;
+}
+
+void api_host_set_bpmf(float bpm) {
+  s_bpmf = bpm;
+}
+
+/* Park-Miller-Carta, 31-bit state in [1, 2^31-2]. */
+static uint32_t rand_pmc(void) {
+  uint32_t lo = 16807 * (s_rand_state & 0xFFFF);
+  const uint32_t hi = 16807 * (s_rand_state >> 16);
+  lo += (hi & 0x7FFF) << 16;
+  lo += hi >> 15;
+  if (lo > 0x7FFFFFFF)
+    lo -= 0x7FFFFFFF;
+  return (s_rand_state = lo);
+}
+
+/* Box-Muller pair, scaled so that +/-4 sigma spans [-1, 1]. */
+static float white_gauss(void) {
+  if (s_white_has_spare) {
+    s_white_has_spare = 0;
+    return s_white_spare;
+  }
+  const float u1 = (rand_pmc() + 0.5f) * (1.f / 2147483648.f);
+  const float u2 = rand_pmc() * (1.f / 2147483648.f);
+  const float r = 0.25f * sqrtf(-2.f * logf(u1));
+  float y0 = r * cosf(6.2831853f * u2);
+  float y1 = r * sinf(6.2831853f * u2);
+  y0 = (y0 > 1.f) ? 1.f : (y0 < -1.f) ? -1.f : y0;
+  y1 = (y1 > 1.f) ? 1.f : (y1 < -1.f) ? -1.f : y1;
+  s_white_spare = y1;
+  s_white_has_spare = 1;
+  return y0;
+}
+
+uint32_t _osc_mcu_hash(void) { return API_HOST_MCU_HASH; }
+uint32_t _fx_mcu_hash(void) { return API_HOST_MCU_HASH; }
+
+uint32_t _osc_rand(void) { return rand_pmc(); }
+uint32_t _fx_rand(void) { return rand_pmc(); }
+
+float _osc_white(void) { return white_gauss(); }
+float _fx_white(void) { return white_gauss(); }
+
+uint16_t _fx_get_bpm(void) { return (uint16_t)(s_bpmf * 10.f + 0.5f); }
+float _fx_get_bpmf(void) { return s_bpmf; }
+
+/* Fractional table index of a note, table i reached an octave below the last note it is alias free for */
+static float bl_idx(const uint8_t *notes, float note) {
+  float lo = notes[0] - 12.f;
+  for (uint32_t i = 0; i < 7; ++i) {
+    if (note <= notes[i])
+      return (note <= lo) ? (float)i : i + (note - lo) / (notes[i] - lo);
+    lo = notes[i];
+  }
+  return 6.f;
+}
+
+float _osc_bl_saw_idx(float note) { return fminf(bl_idx(wt_saw_notes, note), 6.f); }
+float _osc_bl_sqr_idx(float note) { return fminf(bl_idx(wt_sqr_notes, note), 6.f); }
+float _osc_bl_par_idx(float note) { return fminf(bl_idx(wt_par_notes, note), 6.f); }
@@ -0,0 +1,32 @@
+/*
+ * File: api_host.h
+ *
+ * Host controls for the emulated firmware runtime services.
+ *
+ * 2018 (c) Korg
+ *
+ */
+
+#ifndef __api_host_h
+#define __api_host_h
+
+#include <stdint.h>
+
+#define API_HOST_DEFAULT_SEED (0x1U)
+#define API_HOST_MCU_HASH     (0x4B4F5247U)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /** Reseed the emulated Park-Miller-Carta generator behind _osc_rand/_fx_rand and _osc_white/_fx_white, per thread. */
+  void api_host_seed(uint32_t seed);
+
+  /** Set the tempo returned by _fx_get_bpm/_fx_get_bpmf, per thread. */
+  void api_host_set_bpmf(float bpm);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __api_host_h
@@ -0,0 +1,137 @@
+/*
+ * File: chain_host.c
+ *
+ * Host signal chain of an oscillator and effect units, as wired on the instruments.
+ *
+ * 2018 (c) Korg
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "chain_host.h"
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+uint32_t chain_host_stage_module(uint32_t stage) {
+  switch (stage) {
+  case k_chain_osc:   return k_user_module_osc;
+  case k_chain_modfx: return k_user_module_modfx;
+  case k_chain_delfx: return k_user_module_delfx;
+  case k_chain_revfx: return k_user_module_revfx;
+  default:            return k_num_user_modules;
+  }
+}
+
+static uint32_t module_stage(uint32_t module) {
+  for (uint32_t s = 0; s < k_num_chain_stages; ++s)
+    if (chain_host_stage_module(s) == module)
+      return s;
+  return k_num_chain_stages;
+}
+
+void chain_host_reset(chain_host_t *ch) {
+  memset(ch, 0, sizeof(*ch));
+  render_input_init(&ch->input, k_render_input_noise);
+}
+
+int chain_host_load(chain_host_t *ch, const char *path, uint32_t voices) {
+  unit_host_t probe;
+  if (unit_host_open(&probe, path, 0) != 0)
+    return -1;
+  const uint32_t module = unit_host_module(&probe);
+  const uint32_t stage = module_stage(module);
+
+  if (stage == k_num_chain_stages || (ch->stages & (1U << stage))) {
+    fprintf(stderr, "%s: %s slot %s\n", path, unit_host_module_name(module),
+            (stage == k_num_chain_stages) ? "not in the chain" : "already taken");
+    unit_host_close(&probe);
+    return -1;
+  }
+
+  if (stage == k_chain_osc) {
+    // Voices are private instances
+    unit_host_close(&probe);
+    if (voice_host_open(&ch->voices, path, voices ? voices : 1, 0) != 0)
+      return -1;
+  }
+  else
+    ch->fx[stage] = probe;
+
+  ch->stages |= 1U << stage;
+  return 0;
+}
+
+void chain_host_close(chain_host_t *ch) {
+  if (ch->stages & (1U << k_chain_osc))
+    voice_host_close(&ch->voices);
+  for (uint32_t s = k_chain_modfx; s < k_num_chain_stages; ++s)
+    if (ch->stages & (1U << s))
+      unit_host_close(&ch->fx[s]);
+  ch->stages = 0;
+}
+
+void chain_host_init(chain_host_t *ch) {
+  if (ch->stages & (1U << k_chain_osc))
+    voice_host_init(&ch->voices);
+  for (uint32_t s = k_chain_modfx; s < k_num_chain_stages; ++s)
+    if (ch->stages & (1U << s))
+      unit_host_init(&ch->fx[s]);
+  ch->pos = 0;
+}
+
+void chain_host_render(chain_host_t *ch, const user_event_t * const events[k_num_chain_stages],
+                       const uint32_t counts[k_num_chain_stages], float *yn, uint32_t frames) {
+  float main_xn[2 * UNIT_HOST_MAX_FRAMES], sub_xn[2 * UNIT_HOST_MAX_FRAMES];
+  float main_yn[2 * UNIT_HOST_MAX_FRAMES], sub_yn[2 * UNIT_HOST_MAX_FRAMES];
+
+  memset(ch->ns, 0, sizeof(ch->ns));
+
+  // Main timbre bus
+  if (ch->stages & (1U << k_chain_osc)) {
+    int32_t osc_yn[UNIT_HOST_MAX_FRAMES];
+    const double t0 = now_ns();
+    voice_host_render(&ch->voices, events[k_chain_osc], counts[k_chain_osc], osc_yn, frames, NULL);
+    ch->ns[k_chain_osc] = now_ns() - t0;
+    for (uint32_t i = 0; i < frames; ++i)
+      main_xn[2*i] = main_xn[2*i+1] = osc_yn[i] * (1.f / 2147483648.f);
+  }
+  else
+    render_input_fill(&ch->input, ch->pos, main_xn, frames);
+  ch->pos += frames;
+
+  if (ch->sub == k_chain_sub_main)
+    memcpy(sub_xn, main_xn, 2 * frames * sizeof(float));
+  else
+    memset(sub_xn, 0, 2 * frames * sizeof(float));
+
+  // Modulation effect, main and sub timbre outputs summed into the effect bus
+  if (ch->stages & (1U << k_chain_modfx)) {
+    const unit_host_io_t io = {NULL, main_xn, main_yn, sub_xn, sub_yn, NULL};
+    const double t0 = now_ns();
+    unit_host_render(&ch->fx[k_chain_modfx], &io, events[k_chain_modfx], counts[k_chain_modfx], frames);
+    ch->ns[k_chain_modfx] = now_ns() - t0;
+    for (uint32_t i = 0; i < 2 * frames; ++i)
+      yn[i] = main_yn[i] + sub_yn[i];
+  }
+  else {
+    for (uint32_t i = 0; i < 2 * frames; ++i)
+      yn[i] = main_xn[i] + sub_xn[i];
+  }
+
+  // Delay and reverb effects in place
+  for (uint32_t s = k_chain_delfx; s <= k_chain_revfx; ++s) {
+    if (!(ch->stages & (1U << s)))
+      continue;
+    const unit_host_io_t io = {NULL, NULL, NULL, NULL, NULL, yn};
+    const double t0 = now_ns();
+    unit_host_render(&ch->fx[s], &io, events[s], counts[s], frames);
+    ch->ns[s] = now_ns() - t0;
+  }
+}
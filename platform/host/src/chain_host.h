@@ -0,0 +1,89 @@
+/*
+ * File: chain_host.h
+ *
+ * Host signal chain of an oscillator and effect units, as wired on the instruments.
+ *
+ * Voices of the oscillator are mixed into the main timbre bus of the modulation effect, whose main and sub timbre
+ * outputs are summed into the in-place buffer of the delay effect, then of the reverb effect. Any stage can be left
+ * out, effect chains without an oscillator are fed with a test input.
+ *
+ * 2018 (c) Korg
+ *
+ */
+
+#ifndef __chain_host_h
+#define __chain_host_h
+
+#include <stdint.h>
+
+#include "unit_host.h"
+#include "voice_host.h"
+#include "render_job.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /** Stages in signal order */
+  enum {
+    k_chain_osc = 0U,
+    k_chain_modfx,
+    k_chain_delfx,
+    k_chain_revfx,
+    k_num_chain_stages
+  };
+
+  enum {
+    /** Sub timbre bus silent, as on single timbre patches */
+    k_chain_sub_silent = 0U,
+    /** Sub timbre bus fed with the main timbre, as on layered prologue patches */
+    k_chain_sub_main,
+  };
+
+  typedef struct chain_host {
+    /** Oscillator voices */
+    voice_host_t voices;
+    unit_host_t fx[k_num_chain_stages];
+    /** Stages loaded, bit per stage */
+    uint32_t stages;
+    uint32_t sub;
+    /** Input of effect chains without oscillator */
+    render_input_t input;
+    uint32_t pos;
+    /** Host processing time of each stage over the last block, in ns */
+    double ns[k_num_chain_stages];
+  } chain_host_t;
+
+  void chain_host_reset(chain_host_t *ch);
+
+  /**
+   * Load a unit in the stage of its module.
+   *
+   * @param voices Oscillators: number of voices
+   * @return 0 on success, -1 with a message on stderr if loading fails or the stage is taken
+   */
+  int chain_host_load(chain_host_t *ch, const char *path, uint32_t voices);
+
+  void chain_host_close(chain_host_t *ch);
+
+  /** Initialize all loaded units. */
+  void chain_host_init(chain_host_t *ch);
+
+  /**
+   * Render one block through all loaded stages.
+   *
+   * @param events Events of each stage, sorted by offset with offsets in [0, frames-1]
+   * @param counts Number of events of each stage
+   * @param yn     Stereo interleaved chain output
+   */
+  void chain_host_render(chain_host_t *ch, const user_event_t * const events[k_num_chain_stages],
+                         const uint32_t counts[k_num_chain_stages], float *yn, uint32_t frames);
+
+  /** Module of a stage, see userprg.h */
+  uint32_t chain_host_stage_module(uint32_t stage);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __chain_host_h
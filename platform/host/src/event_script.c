@@ -0,0 +1,235 @@
+/*
+ * File: event_script.c
+ *
+ * Timed event scripts driving host renders.
+ *
+ * 2018 (c) Korg
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "userprg.h"
+#include "event_script.h"
+
+#define SCRIPT_FS (48000)
+
+typedef struct name_index {
+  const char *name;
+  uint8_t index;
+} name_index_t;
+
+static const name_index_t s_types[] = {
+  {"param", k_user_event_param},
+  {"value", k_user_event_value},
+  {"note_on", k_user_event_note_on},
+  {"note_off", k_user_event_note_off},
+  {"pitch", k_user_event_pitch},
+  {"shape_lfo", k_user_event_shape_lfo},
+  {NULL, 0}
+};
+
+/* Indexes as in userosc.h and userdelfx.h/userrevfx.h */
+static const name_index_t s_osc_params[] = {
+  {"id1", 0}, {"id2", 1}, {"id3", 2}, {"id4", 3}, {"id5", 4}, {"id6", 5},
+  {"shape", 6}, {"shiftshape", 7},
+  {NULL, 0}
+};
+
+static const name_index_t s_fx_params[] = {
+  {"time", 0}, {"depth", 1}, {"shift_depth", 3},
+  {NULL, 0}
+};
+
+static int lookup(const name_index_t *table, const char *name, uint8_t *index) {
+  for (; table->name != NULL; ++table) {
+    if (strcmp(table->name, name) == 0) {
+      *index = table->index;
+      return 0;
+    }
+  }
+  return -1;
+}
+
+static int32_t q31_clip(double x) {
+  x = x * 2147483648.0;
+  return (x >= 2147483647.0) ? 0x7FFFFFFF : (x <= -2147483648.0) ? (int32_t)0x80000000 : (int32_t)lrint(x);
+}
+
+void event_script_init(event_script_t *s) {
+  memset(s, 0, sizeof(*s));
+}
+
+void event_script_free(event_script_t *s) {
+  free(s->events);
+  event_script_init(s);
+}
+
+int event_script_add(event_script_t *s, uint32_t frame, uint8_t type, uint8_t index, int32_t value) {
+  if (s->count == s->capacity) {
+    const uint32_t capacity = s->capacity ? 2 * s->capacity : 64;
+    script_event_t *events = (script_event_t *)realloc(s->events, capacity * sizeof(script_event_t));
+    if (events == NULL)
+      return -1;
+    s->events = events;
+    s->capacity = capacity;
+  }
+
+  // Insert after events at the same or earlier frames
+  uint32_t i = s->count;
+  for (; i > 0 && s->events[i-1].frame > frame; --i)
+    s->events[i] = s->events[i-1];
+
+  script_event_t *e = &s->events[i];
+  e->frame = frame;
+  e->event.offset = 0;
+  e->event.type = type;
+  e->event.index = index;
+  e->event.value = value;
+  ++s->count;
+  return 0;
+}
+
+static int parse_time(const char *tok, uint32_t *frame) {
+  char *end;
+  const double t = strtod(tok, &end);
+  if (end == tok || t < 0)
+    return -1;
+  if (strcmp(end, "s") == 0)
+    *frame = (uint32_t)lrint(t * SCRIPT_FS);
+  else if (strcmp(end, "ms") == 0)
+    *frame = (uint32_t)lrint(t * 0.001 * SCRIPT_FS);
+  else if (*end == '\0' && strchr(tok, '.') == NULL)
+    *frame = (uint32_t)t;
+  else
+    return -1;
+  return 0;
+}
+
+static int parse_number(const char *tok, double *x) {
+  char *end;
+  if (tok == NULL)
+    return -1;
+  *x = strtod(tok, &end);
+  return (end == tok || *end != '\0') ? -1 : 0;
+}
+
+int event_script_parse_line(event_script_t *s, const char *line, uint32_t module) {
+  char buf[256];
+  strncpy(buf, line, sizeof(buf) - 1);
+  buf[sizeof(buf) - 1] = '\0';
+
+  char *comment = strchr(buf, '#');
+  if (comment != NULL)
+    *comment = '\0';
+
+  char *tok[4] = {NULL, NULL, NULL, NULL};
+  uint32_t ntok = 0;
+  for (char *t = strtok(buf, " \t\r\n"); t != NULL && ntok < 4; t = strtok(NULL, " \t\r\n"))
+    tok[ntok++] = t;
+  if (ntok == 0)
+    return 0;
+
+  uint32_t frame;
+  if (ntok < 2 || parse_time(tok[0], &frame) != 0)
+    return -1;
+
+  if (strcmp(tok[1], "end") == 0) {
+    s->length = frame;
+    return 0;
+  }
+
+  uint8_t type;
+  if (lookup(s_types, tok[1], &type) != 0)
+    return -1;
+
+  const uint32_t osc = (module == k_user_module_osc);
+  double x, y;
+  uint8_t index = 0;
+  int32_t value = 0;
+
+  switch (type) {
+  case k_user_event_param:
+    if (tok[2] == NULL || tok[3] == NULL)
+      return -1;
+    if (lookup(osc ? s_osc_params : s_fx_params, tok[2], &index) != 0) {
+      if (parse_number(tok[2], &x) != 0 || x < 0 || x > 255)
+        return -1;
+      index = (uint8_t)x;
+    }
+    if (parse_number(tok[3], &x) != 0)
+      return -1;
+    if (strchr(tok[3], '.') == NULL)
+      value = (int32_t)x;
+    else
+      value = osc ? (int32_t)lrint(fmin(fmax(x, 0.0), 1.0) * 1023.0) : q31_clip(x);
+    break;
+  case k_user_event_value:
+    if (parse_number(tok[2], &x) != 0)
+      return -1;
+    value = (int32_t)x;
+    break;
+  case k_user_event_note_on:
+  case k_user_event_note_off:
+    if (parse_number(tok[2], &x) != 0 || x < 0 || x > 151)
+      return -1;
+    index = (uint8_t)x;
+    value = (parse_number(tok[3], &y) == 0) ? (int32_t)y : 100;
+    break;
+  case k_user_event_pitch:
+    if (parse_number(tok[2], &x) != 0 || x < 0 || x >= 152)
+      return -1;
+    value = (int32_t)lrint(floor(x) * 256.0 + floor((x - floor(x)) * 256.0));
+    break;
+  case k_user_event_shape_lfo:
+    if (parse_number(tok[2], &x) != 0)
+      return -1;
+    value = q31_clip(x);
+    break;
+  default:
+    return -1;
+  }
+
+  return event_script_add(s, frame, type, index, value);
+}
+
+int event_script_load(event_script_t *s, const char *path, uint32_t module) {
+  FILE *fp = fopen(path, "r");
+  if (fp == NULL) {
+    perror(path);
+    return -1;
+  }
+
+  char line[256];
+  uint32_t lineno = 0;
+  int ret = 0;
+  while (fgets(line, sizeof(line), fp) != NULL) {
+    ++lineno;
+    if (event_script_parse_line(s, line, module) != 0) {
+      fprintf(stderr, "%s:%u: invalid event: %s", path, (unsigned)lineno, line);
+      ret = -1;
+      break;
+    }
+  }
+
+  fclose(fp);
+  return ret;
+}
+
+uint32_t event_script_block(const event_script_t *s, uint32_t *cursor, uint32_t frame, uint32_t frames,
+                            user_event_t *out, uint32_t max) {
+  uint32_t n = 0;
+  uint32_t i = *cursor;
+
+  for (; i < s->count && n < max && s->events[i].frame < frame + frames; ++i, ++n) {
+    out[n] = s->events[i].event;
+    // Events postponed from earlier blocks land on the block start
+    out[n].offset = (uint16_t)((s->events[i].frame > frame) ? s->events[i].frame - frame : 0);
+  }
+
+  *cursor = i;
+  return n;
+}
@@ -0,0 +1,85 @@
+/*
+ * File: event_script.h
+ *
+ * Timed event scripts driving host renders.
+ *
+ * One event per line, '#' starts a comment:
+ *
+ *   <time> <type> [<index>] [<value>]
+ *
+ *   time       Frame number, or seconds/milliseconds with an 's'/'ms' suffix (0.5s, 20ms)
+ *   param      <index> <value>  index: number, or id1-id6/shape/shiftshape (osc), time/depth/shift_depth (fx).
+ *                               value: integer as passed to the param hook, or normalized in [0, 1] when written
+ *                               with a decimal point (10 bits for osc, Q31 for fx)
+ *   value      <value>          osc value hook
+ *   note_on    <note> [<velocity>]
+ *   note_off   <note>
+ *   pitch      <note>           fractional notes set the fine byte
+ *   shape_lfo  <value>          in [-1, 1]
+ *   end                         render length
+ *
+ * Events at the same time keep their script order.
+ *
+ * 2018 (c) Korg
+ *
+ */
+
+#ifndef __event_script_h
+#define __event_script_h
+
+#include <stdint.h>
+
+#include "userevents.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  typedef struct script_event {
+    /** Absolute frame */
+    uint32_t frame;
+    /** Event, offset unused */
+    user_event_t event;
+  } script_event_t;
+
+  typedef struct event_script {
+    script_event_t *events;
+    uint32_t count;
+    uint32_t capacity;
+    /** Frame of the end event, 0 if none */
+    uint32_t length;
+  } event_script_t;
+
+  void event_script_init(event_script_t *s);
+  void event_script_free(event_script_t *s);
+
+  /** Append an event, keeping events sorted by frame. */
+  int event_script_add(event_script_t *s, uint32_t frame, uint8_t type, uint8_t index, int32_t value);
+
+  /**
+   * Parse a script file, adding to s.
+   *
+   * @param module Module the script is written for, see userprg.h. Selects parameter names and value scaling.
+   * @return 0 on success, -1 with a message on stderr otherwise
+   */
+  int event_script_load(event_script_t *s, const char *path, uint32_t module);
+
+  /** Parse one line, adding to s. */
+  int event_script_parse_line(event_script_t *s, const char *line, uint32_t module);
+
+  /**
+   * Collect the events of a block with block relative offsets.
+   *
+   * @param cursor Index of the next event to consume, 0 before the first block
+   * @param frame  First frame of the block
+   * @param frames Block size
+   * @return Number of events written to out, at most max. Excess events are postponed to the following block.
+   */
+  uint32_t event_script_block(const event_script_t *s, uint32_t *cursor, uint32_t frame, uint32_t frames,
+                              user_event_t *out, uint32_t max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __event_script_h
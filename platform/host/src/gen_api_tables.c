@@ -0,0 +1,123 @@
+/*
+ * File: gen_api_tables.c
+ *
+ * Generates host definitions of the firmware lookup tables declared in osc_api.h and fx_api.h.
+ *
+ * Tables are computed from their documented definitions, see api_curves.h for the
+ * curves that are only documented by their general shape.
+ *
+ * 2018 (c) Korg
+ *
+ */
+
+#include <stdio.h>
+#include <math.h>
+
+#include "api_curves.h"
+
+#define k_lut_size_8 (256)
+#define k_lut_size_7 (128)
+
+typedef double (*table_fn)(double x, int i);
+
+static double midi_to_hz(double x, int i) { (void)x; return 440.0 * pow(2.0, (i - 69) / 12.0); }
+static double sine_half(double x, int i) { (void)i; return sin(M_PI * x); }
+static double log_fn(double x, int i) { (void)i; return log(x < 1e-5 ? 1e-5 : x); }
+static double tanpi_fn(double x, int i) { (void)i; return tan(M_PI * 0.49 * x); }
+static double sqrtm2log_fn(double x, int i) { (void)i; return sqrt(-2.0 * log(0.005 + 0.995 * x)); }
+static double pow2_fn(double x, int i) { (void)i; return pow(2.0, 3.0 * x); }
+
+static double bitres_fn(double x, int i) { (void)i; return api_curve_bitres(x); }
+static double cubicsat_fn(double x, int i) { (void)i; return api_curve_cubicsat(x); }
+static double schetzen_fn(double x, int i) { (void)i; return api_curve_schetzen(x); }
+
+static void emit(const char *name, int count, double span, table_fn fn) {
+  printf("const float %s[%d] = {", name, count);
+  for (int i = 0; i < count; ++i) {
+    const double x = (span > 0) ? i / span : 0.0;
+    printf("%s%#.9gf", (i % 6) ? ", " : (i ? ",\n  " : "\n  "), fn(x, i));
+  }
+  printf("\n};\n\n");
+}
+
+/* Placeholder wave bank, see api_curve_wave_harmonic() */
+static void emit_waves(const char *name, int bank, int count) {
+  const int size = 128;
+  for (int i = 0; i < count; ++i) {
+    double w[129], peak = 0;
+    for (int k = 0; k < size; ++k) {
+      w[k] = 0;
+      for (int h = 1; h < size / 2; ++h)
+        w[k] += api_curve_wave_harmonic(bank, i, h) * sin(2.0 * M_PI * h * k / size);
+      peak = (fabs(w[k]) > peak) ? fabs(w[k]) : peak;
+    }
+    w[size] = w[0];
+    printf("static const float %s_%d[%d] = {", name, i, size + 1);
+    for (int k = 0; k <= size; ++k)
+      printf("%s%#.9gf", (k % 6) ? ", " : (k ? ",\n  " : "\n  "), w[k] / peak);
+    printf("\n};\n\n");
+  }
+  printf("const float * const %s[%d] = {", name, count);
+  for (int i = 0; i < count; ++i)
+    printf("%s%s_%d", i ? ", " : "", name, i);
+  printf("};\n\n");
+}
+
+enum { k_bl_saw, k_bl_sqr, k_bl_par };
+
+/* Band-limited half-wave tables, with a guard copy of the last table read with a zero weight by osc_bl2_*f() */
+static void emit_bl_waves(const char *prefix, int kind) {
+  static const unsigned char notes[7] = API_CURVE_BL_NOTES;
+  const int size = 128;
+
+  printf("const unsigned char wt_%s_notes[7] = {", prefix);
+  for (int i = 0; i < 7; ++i)
+    printf("%s%d", i ? ", " : "", notes[i]);
+  printf("};\n\n");
+
+  printf("const float wt_%s_lut_f[%d] = {", prefix, 8 * (size + 1));
+  for (int i = 0; i < 8; ++i) {
+    const int harmonics = api_curve_bl_harmonics(notes[(i < 7) ? i : 6]);
+    double w[129], peak = 0;
+    for (int k = 0; k <= size; ++k) {
+      // Half period, phase k / 2size
+      const double x = M_PI * k / size;
+      w[k] = 0;
+      for (int h = 1; h <= harmonics; ++h) {
+        if (kind == k_bl_saw)
+          w[k] += sin(h * x) / h;
+        else if (kind == k_bl_sqr)
+          w[k] += (h & 1) ? sin(h * x) / h : 0.0;
+        else
+          w[k] += cos(h * x) / ((double)h * h);
+      }
+      peak = (fabs(w[k]) > peak) ? fabs(w[k]) : peak;
+    }
+    for (int k = 0; k <= size; ++k)
+      printf("%s%#.9gf", (k % 6) ? ", " : ((i || k) ? ",\n  " : "\n  "), w[k] / peak);
+  }
+  printf("\n};\n\n");
+}
+
+int main(void) {
+  printf("/* Generated by gen_api_tables.c, do not edit. */\n\n");
+  emit("midi_to_hz_lut_f", 152, 0, midi_to_hz);
+  emit("wt_sine_lut_f", k_lut_size_7 + 1, k_lut_size_7, sine_half);
+  emit("log_lut_f", k_lut_size_8 + 1, k_lut_size_8, log_fn);
+  emit("tanpi_lut_f", k_lut_size_8 + 1, k_lut_size_8, tanpi_fn);
+  emit("sqrtm2log_lut_f", k_lut_size_8 + 1, k_lut_size_8, sqrtm2log_fn);
+  emit("pow2_lut_f", k_lut_size_8 + 1, k_lut_size_8, pow2_fn);
+  emit("cubicsat_lut_f", k_lut_size_7 + 1, k_lut_size_7, cubicsat_fn);
+  emit("schetzen_lut_f", k_lut_size_7 + 1, k_lut_size_7, schetzen_fn);
+  emit("bitres_lut_f", k_lut_size_7 + 1, k_lut_size_7, bitres_fn);
+  emit_waves("wavesA", 0, 16);
+  emit_waves("wavesB", 1, 16);
+  emit_waves("wavesC", 2, 14);
+  emit_waves("wavesD", 3, 13);
+  emit_waves("wavesE", 4, 15);
+  emit_waves("wavesF", 5, 16);
+  emit_bl_waves("saw", k_bl_saw);
+  emit_bl_waves("sqr", k_bl_sqr);
+  emit_bl_waves("par", k_bl_par);
+  return 0;
+}
@@ -0,0 +1,63 @@
+/*
+ * File: mem_trace.c
+ *
+ * Instrumentation entry points of units built with MEMTRACE=1, resolved against the host executable.
+ *
+ * 2018 (c) Korg
+ *
+ */
+
+#include <stddef.h>
+
+#include "mem_trace.h"
+
+static mem_trace_fn s_fn = NULL;
+static void *s_ctx = NULL;
+
+void mem_trace_set(mem_trace_fn fn, void *ctx) {
+  s_ctx = ctx;
+  s_fn = fn;
+}
+
+static inline void trace(uintptr_t addr, uint32_t size, uint32_t store) {
+  if (s_fn != NULL)
+    s_fn(s_ctx, addr, size, store);
+}
+
+#define MEM_TRACE_SIZED(n)                                                      \
+  __attribute__((visibility("default")))                                        \
+  void __tsan_read##n(void *addr) { trace((uintptr_t)addr, n, 0); }             \
+  __attribute__((visibility("default")))                                        \
+  void __tsan_write##n(void *addr) { trace((uintptr_t)addr, n, 1); }            \
+  __attribute__((visibility("default")))                                        \
+  void __tsan_unaligned_read##n(void *addr) { trace((uintptr_t)addr, n, 0); }   \
+  __attribute__((visibility("default")))                                        \
+  void __tsan_unaligned_write##n(void *addr) { trace((uintptr_t)addr, n, 1); }
+
+MEM_TRACE_SIZED(1)
+MEM_TRACE_SIZED(2)
+MEM_TRACE_SIZED(4)
+MEM_TRACE_SIZED(8)
+MEM_TRACE_SIZED(16)
+
+__attribute__((visibility("default")))
+void __tsan_read_range(void *addr, size_t size) { trace((uintptr_t)addr, (uint32_t)size, 0); }
+
+__attribute__((visibility("default")))
+void __tsan_write_range(void *addr, size_t size) { trace((uintptr_t)addr, (uint32_t)size, 1); }
+
+__attribute__((visibility("default")))
+void __tsan_vptr_read(void **vptr) { trace((uintptr_t)vptr, sizeof(*vptr), 0); }
+
+__attribute__((visibility("default")))
+void __tsan_vptr_update(void **vptr, void *value) { (void)value; trace((uintptr_t)vptr, sizeof(*vptr), 1); }
+
+/* Remaining entry points of the instrumentation, there is no race detection state to maintain */
+__attribute__((visibility("default")))
+void __tsan_init(void) { }
+
+__attribute__((visibility("default")))
+void __tsan_func_entry(void *pc) { (void)pc; }
+
+__attribute__((visibility("default")))
+void __tsan_func_exit(void) { }
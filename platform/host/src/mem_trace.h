@@ -0,0 +1,40 @@
+/*
+ * File: mem_trace.h
+ *
+ * Memory access tracing of units built with MEMTRACE=1.
+ *
+ * Such units are compiled with -fsanitize=thread but linked without libtsan, which turns every load and store of the
+ * unit code, globals included, into a call to __tsan_{read,write}<size>. The host runtime defines these and forwards
+ * them to the installed callback. Accesses by the firmware API emulation and by library calls such as memcpy are not
+ * traced.
+ *
+ * 2018 (c) Korg
+ *
+ */
+
+#ifndef __mem_trace_h
+#define __mem_trace_h
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /**
+   * Access callback.
+   *
+   * @param addr First byte accessed
+   * @param size Bytes accessed
+   * @param store 1 for stores, 0 for loads
+   */
+  typedef void (*mem_trace_fn)(void *ctx, uintptr_t addr, uint32_t size, uint32_t store);
+
+  /** Install the callback for all threads, NULL to stop tracing. */
+  void mem_trace_set(mem_trace_fn fn, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __mem_trace_h
@@ -0,0 +1,155 @@
+/*
+ * File: render_job.c
+ *
+ * Offline render of a loaded unit from an event script, with level, timing and output hash results.
+ *
+ * 2018 (c) Korg
+ *
+ */
+
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "api_host.h"
+#include "render_job.h"
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+void render_input_init(render_input_t *in, uint32_t type) {
+  memset(in, 0, sizeof(*in));
+  in->type = type;
+  in->noise = 0x12345678;
+}
+
+void render_input_fill(render_input_t *in, uint32_t pos, float *xn, uint32_t frames) {
+  for (uint32_t i = 0; i < frames; ++i) {
+    const uint32_t t = pos + i;
+    float l = 0.f, r = 0.f;
+    switch (in->type) {
+    case k_render_input_impulse:
+      l = r = (t % UNIT_HOST_FS == 0) ? 1.f : 0.f;
+      break;
+    case k_render_input_noise:
+      in->noise ^= in->noise << 13;
+      in->noise ^= in->noise >> 17;
+      in->noise ^= in->noise << 5;
+      l = r = 0.25f * ((int32_t)in->noise * (1.f / 2147483648.f));
+      break;
+    case k_render_input_sine:
+      l = r = 0.5f * (float)sin(2.0 * M_PI * 440.0 * t / UNIT_HOST_FS);
+      break;
+    case k_render_input_buffer:
+      if (t < in->frames) {
+        l = in->data[t * in->channels];
+        r = in->data[t * in->channels + (in->channels > 1)];
+      }
+      break;
+    default:
+      break;
+    }
+    xn[2*i] = l;
+    xn[2*i+1] = r;
+  }
+}
+
+const char *render_input_name(uint32_t type) {
+  switch (type) {
+  case k_render_input_silence: return "silence";
+  case k_render_input_impulse: return "impulse";
+  case k_render_input_noise:   return "noise";
+  case k_render_input_sine:    return "sine";
+  case k_render_input_buffer:  return "buffer";
+  default:                     return NULL;
+  }
+}
+
+void render_job_init(render_job_t *job) {
+  memset(job, 0, sizeof(*job));
+  job->frames = UNIT_HOST_MAX_FRAMES;
+  render_input_init(&job->input, k_render_input_impulse);
+  job->seed = API_HOST_DEFAULT_SEED;
+  job->bpm = 120.f;
+}
+
+int render_job_run(unit_host_t *u, const render_job_t *job, render_result_t *r) {
+  const uint32_t module = unit_host_module(u);
+  const uint32_t channels = unit_host_channels(u);
+  const uint32_t length = job->length ? job->length : (job->script != NULL) ? job->script->length : 0;
+  const uint32_t frames = (job->frames && job->frames <= UNIT_HOST_MAX_FRAMES) ? job->frames : UNIT_HOST_MAX_FRAMES;
+
+  memset(r, 0, sizeof(*r));
+  r->length = length;
+  r->channels = channels;
+  r->hash = 0xCBF29CE484222325ULL;
+  if (length == 0)
+    return -1;
+
+  render_input_t input = job->input;
+
+  api_host_seed(job->seed);
+  api_host_set_bpmf(job->bpm);
+  unit_host_init(u);
+
+  int32_t osc_yn[UNIT_HOST_MAX_FRAMES];
+  float xn[2 * UNIT_HOST_MAX_FRAMES], sub_xn[2 * UNIT_HOST_MAX_FRAMES];
+  float yn[2 * UNIT_HOST_MAX_FRAMES], sub_yn[2 * UNIT_HOST_MAX_FRAMES];
+  user_event_t events[UNIT_HOST_MAX_EVENTS];
+  const unit_host_io_t io = {osc_yn, xn, yn, sub_xn, sub_yn, xn};
+
+  uint32_t cursor = 0;
+  double sum2 = 0;
+
+  for (uint32_t pos = 0; pos < length; pos += frames) {
+    const uint32_t n = (length - pos < frames) ? length - pos : frames;
+    const uint32_t count = (job->script != NULL)
+      ? event_script_block(job->script, &cursor, pos, n, events, UNIT_HOST_MAX_EVENTS) : 0;
+
+    if (module != k_user_module_osc) {
+      render_input_fill(&input, pos, xn, n);
+      memcpy(sub_xn, xn, 2 * n * sizeof(float));
+    }
+
+    const double t0 = now_ns();
+    unit_host_render(u, &io, events, count, n);
+    const double dt = now_ns() - t0;
+    r->total_ns += dt;
+    r->max_ns = (dt > r->max_ns) ? dt : r->max_ns;
+    ++r->blocks;
+
+    // Main timbre output of modulation effects, in-place output otherwise
+    const float *out = (module == k_user_module_modfx) ? yn : xn;
+    if (module == k_user_module_osc) {
+      for (uint32_t i = 0; i < n; ++i)
+        yn[i] = osc_yn[i] * (1.f / 2147483648.f);
+      out = yn;
+    }
+
+    for (uint32_t i = 0; i < n * channels; ++i) {
+      const float x = out[i];
+      uint32_t bits;
+      memcpy(&bits, &x, sizeof(bits));
+      for (uint32_t b = 0; b < 4; ++b) {
+        r->hash ^= (bits >> (8 * b)) & 0xFF;
+        r->hash *= 0x100000001B3ULL;
+      }
+      if (!isfinite(x)) {
+        ++r->nonfinite;
+        continue;
+      }
+      const double a = fabs(x);
+      r->peak = (a > r->peak) ? a : r->peak;
+      sum2 += (double)x * x;
+    }
+
+    if (job->out != NULL)
+      memcpy(job->out + (size_t)pos * channels, out, n * channels * sizeof(float));
+  }
+
+  r->rms = sqrt(sum2 / ((double)length * channels));
+  return 0;
+}
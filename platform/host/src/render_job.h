@@ -0,0 +1,97 @@
+/*
+ * File: render_job.h
+ *
+ * Offline render of a loaded unit from an event script, with level, timing and output hash results.
+ *
+ * 2018 (c) Korg
+ *
+ */
+
+#ifndef __render_job_h
+#define __render_job_h
+
+#include <stdint.h>
+
+#include "unit_host.h"
+#include "event_script.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /**
+   * Effect input signals.
+   */
+  enum {
+    k_render_input_silence = 0U,
+    /** Unit impulse every second */
+    k_render_input_impulse,
+    /** White noise at -12dBFS peak */
+    k_render_input_noise,
+    /** 440Hz sine at -6dBFS */
+    k_render_input_sine,
+    /** Caller supplied buffer */
+    k_render_input_buffer,
+    k_num_render_inputs
+  };
+
+  typedef struct render_input {
+    uint32_t type;
+    /** Interleaved samples of k_render_input_buffer, silence past the end */
+    const float *data;
+    uint32_t channels;
+    uint32_t frames;
+    uint32_t noise;
+  } render_input_t;
+
+  void render_input_init(render_input_t *in, uint32_t type);
+
+  /** Fill a stereo interleaved block starting at frame pos. */
+  void render_input_fill(render_input_t *in, uint32_t pos, float *xn, uint32_t frames);
+
+  /** Name of an input type, NULL if out of range */
+  const char *render_input_name(uint32_t type);
+
+  typedef struct render_job {
+    /** Events, may be NULL */
+    const event_script_t *script;
+    /** Frames to render, 0 for the script length */
+    uint32_t length;
+    /** Block size */
+    uint32_t frames;
+    render_input_t input;
+    uint32_t seed;
+    float bpm;
+    /** Output capture of length * channels samples, may be NULL */
+    float *out;
+  } render_job_t;
+
+  typedef struct render_result {
+    uint32_t length;
+    uint32_t blocks;
+    uint32_t channels;
+    double peak;
+    double rms;
+    double total_ns;
+    double max_ns;
+    /** FNV-1a hash of the output samples */
+    uint64_t hash;
+    /** NaN and infinite output samples */
+    uint32_t nonfinite;
+  } render_result_t;
+
+  /** Default job: 64 frame blocks, impulse input, default seed, 120bpm. */
+  void render_job_init(render_job_t *job);
+
+  /**
+   * Initialize the unit and render the job on the calling thread.
+   *
+   * @return 0 on success, -1 if the job has no length
+   */
+  int render_job_run(unit_host_t *u, const render_job_t *job, render_result_t *r);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __render_job_h
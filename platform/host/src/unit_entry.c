@@ -0,0 +1,16 @@
+/*
+ * File: unit_entry.c
+ *
+ * Host counterpart of the entry templates in platform/tpl, linked into units built as native shared objects.
+ *
+ * The dynamic loader zeroes .bss and runs constructors, so only the target of the unit is exported here for the host
+ * runtime to select the hooks to resolve. Hooks left undefined by the unit are skipped by the runtime.
+ *
+ * 2018 (c) Korg
+ *
+ */
+
+#include "userprg.h"
+
+__attribute__((used, visibility("default")))
+const uint32_t _unit_target = USER_TARGET_PLATFORM | USER_TARGET_MODULE;
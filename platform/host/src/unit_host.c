@@ -0,0 +1,301 @@
+/*
+ * File: unit_host.c
+ *
+ * Host runtime for user units built as native shared objects.
+ *
+ * Units resolve the firmware API (_osc_*, _fx_*, lookup tables) and _user_events() against the executable hosting
+ * them, which must therefore export its symbols (-rdynamic).
+ *
+ * 2018 (c) Korg
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <dlfcn.h>
+
+#include "unit_host.h"
+#include "profile.h"
+
+/* Unit running its cycle/process hook on this thread, for _user_events() */
+static __thread unit_host_t *s_current;
+
+#define resolve(u, member, name) (*(void **)(&(u)->member) = dlsym((u)->handle, (name)))
+
+int unit_host_open(unit_host_t *u, const char *path, uint32_t target) {
+  memset(u, 0, sizeof(*u));
+
+  // dlopen() searches the library path for names without a slash
+  char local[4096];
+  if (strchr(path, '/') == NULL) {
+    snprintf(local, sizeof(local), "./%s", path);
+    path = local;
+  }
+
+  u->handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+  if (u->handle == NULL) {
+    fprintf(stderr, "%s\n", dlerror());
+    return -1;
+  }
+
+  if (target == 0) {
+    const uint32_t *unit_target = (const uint32_t *)dlsym(u->handle, "_unit_target");
+    if (unit_target == NULL) {
+      fprintf(stderr, "%s: no _unit_target symbol, module must be specified\n", path);
+      unit_host_close(u);
+      return -1;
+    }
+    target = *unit_target;
+  }
+  u->target = target;
+
+  resolve(u, init, "_hook_init");
+
+  switch (unit_host_module(u)) {
+  case k_user_module_osc:
+    resolve(u, osc_cycle, "_hook_cycle");
+    resolve(u, osc_on, "_hook_on");
+    resolve(u, osc_off, "_hook_off");
+    resolve(u, osc_mute, "_hook_mute");
+    resolve(u, osc_value, "_hook_value");
+    resolve(u, osc_param, "_hook_param");
+    if (u->osc_cycle == NULL)
+      break;
+    return 0;
+  case k_user_module_modfx:
+    resolve(u, modfx_process, "_hook_process");
+    resolve(u, fx_suspend, "_hook_suspend");
+    resolve(u, fx_resume, "_hook_resume");
+    resolve(u, fx_param, "_hook_param");
+    if (u->modfx_process == NULL)
+      break;
+    return 0;
+  case k_user_module_delfx:
+  case k_user_module_revfx:
+    resolve(u, fx_process, "_hook_process");
+    resolve(u, fx_suspend, "_hook_suspend");
+    resolve(u, fx_resume, "_hook_resume");
+    resolve(u, fx_param, "_hook_param");
+    if (u->fx_process == NULL)
+      break;
+    return 0;
+  default:
+    fprintf(stderr, "%s: unsupported module %u\n", path, (unsigned)unit_host_module(u));
+    unit_host_close(u);
+    return -1;
+  }
+
+  fprintf(stderr, "%s: missing %s hook\n", path,
+          (unit_host_module(u) == k_user_module_osc) ? "_hook_cycle" : "_hook_process");
+  unit_host_close(u);
+  return -1;
+}
+
+int unit_host_open_instance(unit_host_t *u, const char *path, uint32_t target) {
+  const char *tmpdir = getenv("TMPDIR");
+  char copy[4096];
+  snprintf(copy, sizeof(copy), "%s/unit_host_XXXXXX", (tmpdir != NULL) ? tmpdir : "/tmp");
+
+  const int out = mkstemp(copy);
+  const int in = open(path, O_RDONLY);
+  if (out < 0 || in < 0) {
+    perror((in < 0) ? path : copy);
+    if (out >= 0) {
+      close(out);
+      unlink(copy);
+    }
+    if (in >= 0)
+      close(in);
+    return -1;
+  }
+
+  char buf[65536];
+  ssize_t n;
+  int ret = 0;
+  while ((n = read(in, buf, sizeof(buf))) > 0)
+    if (write(out, buf, (size_t)n) != n) {
+      ret = -1;
+      break;
+    }
+  if (n < 0)
+    ret = -1;
+  close(in);
+  close(out);
+
+  if (ret == 0)
+    ret = unit_host_open(u, copy, target);
+  else
+    perror(copy);
+
+  // The mapping outlives the file
+  unlink(copy);
+  return ret;
+}
+
+void unit_host_close(unit_host_t *u) {
+  if (u->handle != NULL)
+    dlclose(u->handle);
+  u->handle = NULL;
+}
+
+int unit_host_dump_profile(const unit_host_t *u, const char *path) {
+  const prof_ring_t *ring = (const prof_ring_t *)dlsym(u->handle, "prof_ring");
+  if (ring == NULL) {
+    fprintf(stderr, "unit has no prof_ring: no PROF_SCOPE, or not built with PROFILE=1\n");
+    return -1;
+  }
+  if (ring->magic != PROF_MAGIC) {
+    fprintf(stderr, "no profiled scope was reached\n");
+    return -1;
+  }
+
+  // Ring capacity of the unit may differ from the default one
+  const size_t size = offsetof(prof_ring_t, samples) + ring->capacity * sizeof(prof_sample_t);
+  FILE *fp = fopen(path, "wb");
+  if (fp == NULL) {
+    perror(path);
+    return -1;
+  }
+  const int ret = (fwrite(ring, 1, size, fp) == size) ? 0 : -1;
+  if (fclose(fp) != 0 || ret != 0) {
+    fprintf(stderr, "%s: write error\n", path);
+    return -1;
+  }
+  return 0;
+}
+
+void unit_host_init(unit_host_t *u) {
+  u->params.shape_lfo = 0;
+  u->params.pitch = 60 << 8;
+  u->params.cutoff = 0x1FFF;
+  u->params.resonance = 0;
+  u->pending_count = 0;
+  u->dropped = 0;
+
+  if (u->init != NULL)
+    u->init(u->target, USER_API_VERSION);
+}
+
+void unit_host_apply(unit_host_t *u, const user_event_t *event) {
+  const uint32_t osc = (unit_host_module(u) == k_user_module_osc);
+
+  switch (event->type) {
+  case k_user_event_param:
+    if (osc && u->osc_param != NULL)
+      u->osc_param(event->index, (uint16_t)event->value);
+    else if (!osc && u->fx_param != NULL)
+      u->fx_param(event->index, event->value);
+    break;
+  case k_user_event_value:
+    if (osc && u->osc_value != NULL)
+      u->osc_value((uint16_t)event->value);
+    break;
+  case k_user_event_note_on:
+    u->params.pitch = (uint16_t)(event->index << 8);
+    if (osc && u->osc_on != NULL)
+      u->osc_on(&u->params);
+    break;
+  case k_user_event_note_off:
+    if (osc && u->osc_off != NULL)
+      u->osc_off(&u->params);
+    break;
+  case k_user_event_pitch:
+    u->params.pitch = (uint16_t)event->value;
+    break;
+  case k_user_event_shape_lfo:
+    u->params.shape_lfo = event->value;
+    break;
+  default:
+    break;
+  }
+}
+
+static void render_range(unit_host_t *u, const unit_host_io_t *io, uint32_t pos, uint32_t frames) {
+  switch (unit_host_module(u)) {
+  case k_user_module_osc:
+    u->osc_cycle(&u->params, io->osc_yn + pos, frames);
+    break;
+  case k_user_module_modfx:
+    u->modfx_process(io->main_xn + 2*pos, io->main_yn + 2*pos, io->sub_xn + 2*pos, io->sub_yn + 2*pos, frames);
+    break;
+  default:
+    u->fx_process(io->xn + 2*pos, frames);
+    break;
+  }
+}
+
+void unit_host_render(unit_host_t *u, const unit_host_io_t *io,
+                      const user_event_t *events, uint32_t count, uint32_t frames) {
+  // Events the unit did not fetch during the previous block land on this block boundary
+  for (uint32_t i = 0; i < u->pending_count; ++i)
+    unit_host_apply(u, &u->pending[i]);
+  u->pending_count = 0;
+
+  uint32_t i = 0;
+
+  if (u->flags & k_unit_host_split) {
+    for (uint32_t pos = 0; pos < frames; ) {
+      for (; i < count && events[i].offset <= pos; ++i)
+        unit_host_apply(u, &events[i]);
+      const uint32_t end = (i < count && events[i].offset < frames) ? events[i].offset : frames;
+      render_range(u, io, pos, end - pos);
+      pos = end;
+    }
+    return;
+  }
+
+  for (; i < count && events[i].offset == 0; ++i)
+    unit_host_apply(u, &events[i]);
+
+  u->block_events = events + i;
+  u->block_count = count - i;
+  u->fetched_mask = 0;
+
+  s_current = u;
+  render_range(u, io, 0, frames);
+  s_current = NULL;
+
+  for (; i < count; ++i) {
+    if (u->fetched_mask & USER_EVENT_MASK(events[i].type))
+      continue;
+    if (u->pending_count < UNIT_HOST_MAX_EVENTS)
+      u->pending[u->pending_count++] = events[i];
+    else
+      ++u->dropped;
+  }
+
+  u->block_events = NULL;
+  u->block_count = 0;
+}
+
+const char *unit_host_module_name(uint32_t module) {
+  switch (module) {
+  case k_user_module_modfx: return "modfx";
+  case k_user_module_delfx: return "delfx";
+  case k_user_module_revfx: return "revfx";
+  case k_user_module_osc:   return "osc";
+  default:                  return "global";
+  }
+}
+
+const user_event_t *_user_events(uint32_t type_mask, uint32_t *count) {
+  unit_host_t *u = s_current;
+  uint32_t n = 0;
+
+  if (u == NULL) {
+    *count = 0;
+    return NULL;
+  }
+
+  for (uint32_t i = 0; i < u->block_count; ++i)
+    if (type_mask & USER_EVENT_MASK(u->block_events[i].type))
+      u->fetched[n++] = u->block_events[i];
+
+  u->fetched_mask |= type_mask;
+  *count = n;
+  return u->fetched;
+}
@@ -0,0 +1,138 @@
+/*
+ * File: unit_host.h
+ *
+ * Host runtime for user units built as native shared objects.
+ *
+ * Loads a unit, resolves its hooks and runs it block by block, dispatching timed events either through the regular
+ * hooks at block boundaries, as the firmware does, or to the unit itself via userevents.h.
+ *
+ * 2018 (c) Korg
+ *
+ */
+
+#ifndef __unit_host_h
+#define __unit_host_h
+
+#include <stdint.h>
+
+#include "userosc.h"
+#include "userevents.h"
+
+#define UNIT_HOST_FS          (48000)
+#define UNIT_HOST_MAX_FRAMES  (64)
+#define UNIT_HOST_MAX_EVENTS  (256)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  enum {
+    /** Split blocks at event offsets and apply all events through the regular hooks */
+    k_unit_host_split = 1U<<0,
+  };
+
+  /**
+   * Audio buffers of one block. Only the buffers of the unit module are used.
+   */
+  typedef struct unit_host_io {
+    /** osc: Q31 output, 1 sample per frame */
+    int32_t *osc_yn;
+    /** modfx: main and sub timbre, 2 interleaved channels */
+    const float *main_xn;
+    float *main_yn;
+    const float *sub_xn;
+    float *sub_yn;
+    /** delfx/revfx: in-place buffer, 2 interleaved channels */
+    float *xn;
+  } unit_host_io_t;
+
+  typedef struct unit_host {
+    void *handle;
+    /** Platform and module, see userprg.h */
+    uint32_t target;
+    uint32_t flags;
+
+    void (*init)(uint32_t platform, uint32_t api);
+    void (*osc_cycle)(const user_osc_param_t *params, int32_t *yn, uint32_t frames);
+    void (*osc_on)(const user_osc_param_t *params);
+    void (*osc_off)(const user_osc_param_t *params);
+    void (*osc_mute)(const user_osc_param_t *params);
+    void (*osc_value)(uint16_t value);
+    void (*osc_param)(uint16_t index, uint16_t value);
+    void (*modfx_process)(const float *main_xn, float *main_yn, const float *sub_xn, float *sub_yn, uint32_t frames);
+    void (*fx_process)(float *xn, uint32_t frames);
+    void (*fx_suspend)(void);
+    void (*fx_resume)(void);
+    void (*fx_param)(uint8_t index, int32_t value);
+
+    user_osc_param_t params;
+
+    /* Events of the current block with non-zero offsets, for _user_events() */
+    const user_event_t *block_events;
+    uint32_t block_count;
+    uint32_t fetched_mask;
+    user_event_t fetched[UNIT_HOST_MAX_EVENTS];
+
+    /* Events left unfetched by the previous block, applied at the start of the next one */
+    user_event_t pending[UNIT_HOST_MAX_EVENTS];
+    uint32_t pending_count;
+    uint32_t dropped;
+  } unit_host_t;
+
+  /**
+   * Load a unit.
+   *
+   * @param target Platform and module, 0 to use the _unit_target symbol of the unit
+   * @return 0 on success, -1 with a message on stderr otherwise
+   */
+  int unit_host_open(unit_host_t *u, const char *path, uint32_t target);
+
+  /**
+   * Load a private copy of a unit.
+   *
+   * Units keep their state in globals, the shared object is copied to a temporary file before loading so that each
+   * instance gets its own data and bss.
+   */
+  int unit_host_open_instance(unit_host_t *u, const char *path, uint32_t target);
+
+  void unit_host_close(unit_host_t *u);
+
+  static inline uint32_t unit_host_module(const unit_host_t *u) {
+    return u->target & USER_TARGET_MODULE_MASK;
+  }
+
+  /** Call the init hook, as the firmware does after loading. */
+  void unit_host_init(unit_host_t *u);
+
+  /** Apply an event immediately through the regular hooks. */
+  void unit_host_apply(unit_host_t *u, const user_event_t *event);
+
+  /**
+   * Render one block.
+   *
+   * @param events Events of the block sorted by offset, offsets in [0, frames-1]
+   * @param frames Block size, at most UNIT_HOST_MAX_FRAMES
+   */
+  void unit_host_render(unit_host_t *u, const unit_host_io_t *io,
+                        const user_event_t *events, uint32_t count, uint32_t frames);
+
+  /** Number of output channels of the unit: 1 for oscillators, 2 for effects */
+  static inline uint32_t unit_host_channels(const unit_host_t *u) {
+    return (unit_host_module(u) == k_user_module_osc) ? 1 : 2;
+  }
+
+  /**
+   * Write the PROF_SCOPE sample ring of a unit built with PROFILE=1, for prof_dump.
+   *
+   * @return 0 on success, -1 with a message on stderr otherwise
+   */
+  int unit_host_dump_profile(const unit_host_t *u, const char *path);
+
+  /** Module name as used in event scripts and reports */
+  const char *unit_host_module_name(uint32_t module);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __unit_host_h
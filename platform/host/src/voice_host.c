@@ -0,0 +1,323 @@
+/*
+ * File: voice_host.c
+ *
+ * Polyphonic host for oscillator units.
+ *
+ * 2018 (c) Korg
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "voice_host.h"
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int32_t q31_sat(int64_t x) {
+  return (x > 0x7FFFFFFF) ? 0x7FFFFFFF : (x < -0x7FFFFFFF - 1) ? (int32_t)0x80000000 : (int32_t)x;
+}
+
+int voice_host_open(voice_host_t *vh, const char *path, uint32_t count, uint32_t target) {
+  memset(vh, 0, sizeof(*vh));
+
+  if (count == 0 || count > VOICE_HOST_MAX_VOICES) {
+    fprintf(stderr, "voice count must be in [1, %u]\n", VOICE_HOST_MAX_VOICES);
+    return -1;
+  }
+
+  vh->voices = (voice_t *)calloc(count, sizeof(voice_t));
+  if (vh->voices == NULL)
+    return -1;
+
+  for (; vh->count < count; ++vh->count) {
+    if (unit_host_open_instance(&vh->voices[vh->count].unit, path, target) != 0) {
+      voice_host_close(vh);
+      return -1;
+    }
+    if (unit_host_module(&vh->voices[vh->count].unit) != k_user_module_osc) {
+      fprintf(stderr, "%s: not an oscillator unit\n", path);
+      ++vh->count;
+      voice_host_close(vh);
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+void voice_host_close(voice_host_t *vh) {
+  for (uint32_t i = 0; i < vh->count; ++i)
+    unit_host_close(&vh->voices[i].unit);
+  free(vh->voices);
+  vh->voices = NULL;
+  vh->count = 0;
+}
+
+void voice_host_set_gate(voice_host_t *vh, float attack, float release) {
+  vh->attack_inc = (attack > 0.f) ? 1.f / (attack * UNIT_HOST_FS) : 1.f;
+  vh->release_dec = (release > 0.f) ? 1.f / (release * UNIT_HOST_FS) : 1.f;
+}
+
+void voice_host_init(voice_host_t *vh) {
+  for (uint32_t i = 0; i < vh->count; ++i) {
+    voice_t *v = &vh->voices[i];
+    unit_host_init(&v->unit);
+    v->state = k_voice_idle;
+    v->gate = 0;
+    v->gain = 0.f;
+    v->level = 0;
+    v->stamp = 0;
+    v->fading = 0;
+    v->pending = 0;
+  }
+  vh->stamp = 0;
+  vh->steals = 0;
+  vh->dropped = 0;
+  vh->mix_gain = 1.f / vh->count;
+  voice_host_set_gate(vh, 0.002f, 0.05f);
+}
+
+/* Voice for a new note, -1 to drop it */
+static int allocate(voice_host_t *vh) {
+  int best = -1;
+
+  for (uint32_t i = 0; i < vh->count; ++i)
+    if (vh->voices[i].state == k_voice_idle)
+      return (int)i;
+
+  for (uint32_t i = 0; i < vh->count; ++i)
+    if (vh->voices[i].state == k_voice_released
+        && (best < 0 || vh->voices[i].stamp < vh->voices[best].stamp))
+      best = (int)i;
+  if (best >= 0)
+    return best;
+
+  if (vh->policy == k_voice_steal_none)
+    return -1;
+
+  for (uint32_t i = 0; i < vh->count; ++i) {
+    const voice_t *v = &vh->voices[i];
+    const voice_t *b = (best >= 0) ? &vh->voices[best] : NULL;
+    int better = (b == NULL);
+    if (b != NULL) {
+      switch (vh->policy) {
+      case k_voice_steal_quietest: better = v->level < b->level; break;
+      case k_voice_steal_lowest:   better = v->note < b->note; break;
+      case k_voice_steal_highest:  better = v->note > b->note; break;
+      default:                     better = v->stamp < b->stamp; break;
+      }
+    }
+    if (better)
+      best = (int)i;
+  }
+
+  ++vh->steals;
+  return best;
+}
+
+/* Insert keeping events sorted by offset, after those at the same offset */
+static void push(voice_t *v, const user_event_t *event) {
+  if (v->count >= UNIT_HOST_MAX_EVENTS)
+    return;
+  uint32_t i = v->count++;
+  for (; i > 0 && v->events[i-1].offset > event->offset; --i)
+    v->events[i] = v->events[i-1];
+  v->events[i] = *event;
+}
+
+/* Cancel the delayed note on of a voice, whether still pending or already pushed past the given offset */
+static void cancel_note_on(voice_t *v, uint32_t offset) {
+  v->pending = 0;
+  for (uint32_t i = 0; i < v->count; ) {
+    if (v->events[i].type == k_user_event_note_on && v->events[i].offset > offset) {
+      memmove(&v->events[i], &v->events[i+1], (v->count - i - 1) * sizeof(user_event_t));
+      --v->count;
+    }
+    else
+      ++i;
+  }
+}
+
+void voice_host_render(voice_host_t *vh, const user_event_t *events, uint32_t count,
+                       int32_t *yn, uint32_t frames, double *ns) {
+  for (uint32_t i = 0; i < vh->count; ++i) {
+    voice_t *v = &vh->voices[i];
+    v->count = 0;
+    v->fade_offset = 0;
+    // Note on delayed past the fade of a stolen voice
+    if (v->pending) {
+      if (v->note_on.offset < frames) {
+        push(v, &v->note_on);
+        v->pending = 0;
+      }
+      else
+        v->note_on.offset -= frames;
+    }
+  }
+
+  // Route events
+  for (uint32_t e = 0; e < count; ++e) {
+    const user_event_t *event = &events[e];
+    switch (event->type) {
+    case k_user_event_note_on: {
+      const int i = allocate(vh);
+      if (i < 0) {
+        ++vh->dropped;
+        break;
+      }
+      voice_t *v = &vh->voices[i];
+      uint32_t offset = event->offset;
+      if (v->state != k_voice_idle) {
+        // Still sounding, fade out then start the note
+        if (v->fading)
+          cancel_note_on(v, event->offset);
+        else
+          v->fade_offset = event->offset;
+        v->fading = 1;
+        offset += VOICE_HOST_STEAL_FRAMES;
+      }
+      // Without split blocks the unit takes the note at a block boundary, the gate must not open before
+      if (!(v->unit.flags & k_unit_host_split))
+        offset = (offset + frames - 1) / frames * frames;
+      v->note_on = *event;
+      v->note_on.offset = offset;
+      if (offset < frames)
+        push(v, &v->note_on);
+      else {
+        v->pending = 1;
+        v->note_on.offset -= frames;
+      }
+      v->state = k_voice_held;
+      v->note = event->index;
+      v->stamp = ++vh->stamp;
+      break;
+    }
+    case k_user_event_note_off:
+      for (uint32_t i = 0; i < vh->count; ++i) {
+        voice_t *v = &vh->voices[i];
+        if (v->state == k_voice_held && v->note == event->index) {
+          v->state = k_voice_released;
+          v->stamp = ++vh->stamp;
+          // A note that has not started yet is dropped, a fade finishes the previous one
+          if (v->fading || v->pending)
+            cancel_note_on(v, event->offset);
+          else
+            push(v, event);
+        }
+      }
+      break;
+    case k_user_event_pitch: {
+      // Voices holding the note, as a single instance would get it, or all sounding voices
+      uint32_t routed = 0;
+      for (uint32_t i = 0; i < vh->count; ++i) {
+        voice_t *v = &vh->voices[i];
+        if (v->state == k_voice_held && v->note == (uint8_t)(event->value >> 8)) {
+          push(v, event);
+          ++routed;
+        }
+      }
+      for (uint32_t i = 0; i < vh->count && routed == 0; ++i)
+        if (vh->voices[i].state != k_voice_idle)
+          push(&vh->voices[i], event);
+      break;
+    }
+    default:
+      for (uint32_t i = 0; i < vh->count; ++i)
+        push(&vh->voices[i], event);
+      break;
+    }
+  }
+
+  int64_t acc[UNIT_HOST_MAX_FRAMES];
+  memset(acc, 0, sizeof(acc));
+
+  for (uint32_t i = 0; i < vh->count; ++i) {
+    voice_t *v = &vh->voices[i];
+
+    if (ns != NULL)
+      ns[i] = 0;
+
+    // Idle voices keep track of parameters without rendering
+    if (v->state == k_voice_idle && !vh->render_idle) {
+      for (uint32_t k = 0; k < v->count; ++k)
+        unit_host_apply(&v->unit, &v->events[k]);
+      continue;
+    }
+
+    int32_t y[UNIT_HOST_MAX_FRAMES];
+    const unit_host_io_t io = {y, NULL, NULL, NULL, NULL, NULL};
+
+    const double t0 = (ns != NULL) ? now_ns() : 0;
+    unit_host_render(&v->unit, &io, v->events, v->count, frames);
+    if (ns != NULL)
+      ns[i] = now_ns() - t0;
+
+    // Gate follows note events at their offsets, a fade runs from its start to the delayed note on
+    uint32_t e = 0;
+    uint32_t gate = v->gate;
+    uint32_t fading = 0;
+    const float fade_dec = 1.f / VOICE_HOST_STEAL_FRAMES;
+
+    int32_t level = 0;
+    float gain = v->gain;
+    for (uint32_t f = 0; f < frames; ++f) {
+      if (v->fading && f == v->fade_offset)
+        fading = 1;
+      for (; e < v->count && v->events[e].offset <= f; ++e) {
+        if (v->events[e].type == k_user_event_note_on) {
+          gate = 1;
+          fading = v->fading = 0;
+        }
+        else if (v->events[e].type == k_user_event_note_off)
+          gate = 0;
+      }
+      if (fading)
+        gain -= (fade_dec > vh->release_dec) ? fade_dec : vh->release_dec;
+      else
+        gain = gate ? gain + vh->attack_inc : gain - vh->release_dec;
+      gain = (gain > 1.f) ? 1.f : (gain < 0.f) ? 0.f : gain;
+
+      const int32_t a = (y[f] < 0) ? -(y[f] + 1) : y[f];
+      level = (a > level) ? a : level;
+      acc[f] += ((int64_t)y[f] * (int32_t)(gain * 2147483647.0)) >> 31;
+    }
+
+    v->gate = gate;
+    v->gain = gain;
+    v->level = level;
+    if (v->state == k_voice_released && gain == 0.f) {
+      v->state = k_voice_idle;
+      v->fading = 0;
+    }
+  }
+
+  const float mix_gain = (vh->mix_gain > 1.f) ? 1.f : (vh->mix_gain < 0.f) ? 0.f : vh->mix_gain;
+  const int32_t mix = (int32_t)(mix_gain * 2147483647.0);
+  for (uint32_t f = 0; f < frames; ++f)
+    yn[f] = q31_sat((acc[f] * mix) >> 31);
+}
+
+uint32_t voice_host_active(const voice_host_t *vh) {
+  uint32_t n = 0;
+  for (uint32_t i = 0; i < vh->count; ++i)
+    n += (vh->voices[i].state != k_voice_idle);
+  return n;
+}
+
+const char *voice_host_policy_name(uint32_t policy) {
+  switch (policy) {
+  case k_voice_steal_oldest:   return "oldest";
+  case k_voice_steal_quietest: return "quietest";
+  case k_voice_steal_lowest:   return "lowest";
+  case k_voice_steal_highest:  return "highest";
+  case k_voice_steal_none:     return "none";
+  default:                     return NULL;
+  }
+}
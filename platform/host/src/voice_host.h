@@ -0,0 +1,133 @@
+/*
+ * File: voice_host.h
+ *
+ * Polyphonic host for oscillator units.
+ *
+ * Runs N private instances of an oscillator unit as voices, allocates them on note events and mixes their Q31 outputs
+ * through a per-voice amplitude gate, as the voice cards of polyphonic instruments do.
+ *
+ * 2018 (c) Korg
+ *
+ */
+
+#ifndef __voice_host_h
+#define __voice_host_h
+
+#include <stdint.h>
+
+#include "unit_host.h"
+
+#define VOICE_HOST_MAX_VOICES (16)
+
+/** Fade out of a sounding voice before it starts a new note, in frames */
+#define VOICE_HOST_STEAL_FRAMES (32)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /**
+   * Voice stealing policies, used when a note starts while all voices are busy.
+   * Voices already released are always taken first, the one released the longest ago.
+   */
+  enum {
+    /** Steal the voice started the longest ago */
+    k_voice_steal_oldest = 0U,
+    /** Steal the voice with the lowest output level over its last block */
+    k_voice_steal_quietest,
+    /** Steal the voice playing the lowest note */
+    k_voice_steal_lowest,
+    /** Steal the voice playing the highest note */
+    k_voice_steal_highest,
+    /** Drop the new note */
+    k_voice_steal_none,
+    k_num_voice_steal_policies
+  };
+
+  enum {
+    k_voice_idle = 0U,
+    k_voice_held,
+    k_voice_released
+  };
+
+  typedef struct voice {
+    unit_host_t unit;
+    uint32_t state;
+    uint8_t note;
+    /** Allocation order of the last note on or note off */
+    uint32_t stamp;
+    /** Amplitude gate, linear attack and release */
+    uint32_t gate;
+    float gain;
+    /** Peak output level of the last block, Q31 */
+    int32_t level;
+    /** Fading out before the pending note on, which is delayed to past the fade */
+    uint32_t fading;
+    uint32_t fade_offset;
+    /** Note on delayed to a later block, past a fade or to the block boundary where the unit takes it */
+    uint32_t pending;
+    user_event_t note_on;
+    user_event_t events[UNIT_HOST_MAX_EVENTS];
+    uint32_t count;
+  } voice_t;
+
+  typedef struct voice_host {
+    voice_t *voices;
+    uint32_t count;
+    uint32_t policy;
+    uint32_t stamp;
+    /** Render idle voices too, for worst case load */
+    uint32_t render_idle;
+    /** Gate slopes per frame */
+    float attack_inc;
+    float release_dec;
+    /** Mix gain applied to the sum of voices, at most 1 */
+    float mix_gain;
+    uint32_t steals;
+    uint32_t dropped;
+  } voice_host_t;
+
+  /**
+   * Load count instances of an oscillator unit.
+   *
+   * @return 0 on success, -1 with a message on stderr otherwise
+   */
+  int voice_host_open(voice_host_t *vh, const char *path, uint32_t count, uint32_t target);
+
+  void voice_host_close(voice_host_t *vh);
+
+  /** Initialize all instances and set default gate times and mix gain. */
+  void voice_host_init(voice_host_t *vh);
+
+  /**
+   * Set amplitude gate times.
+   *
+   * @param attack  Attack time in seconds
+   * @param release Release time in seconds
+   */
+  void voice_host_set_gate(voice_host_t *vh, float attack, float release);
+
+  /**
+   * Render one block.
+   *
+   * Note events are routed to the allocated voice, parameter, value and shape LFO events are sent to all voices.
+   * Pitch events go to the voices holding their note, or to all sounding voices when none does. A voice that is
+   * still sounding fades out over VOICE_HOST_STEAL_FRAMES before it starts a new note.
+   *
+   * @param events Events of the block sorted by offset, offsets in [0, frames-1]
+   * @param yn     Q31 mix of all voices
+   * @param ns     Host processing time of each voice in ns, may be NULL
+   */
+  void voice_host_render(voice_host_t *vh, const user_event_t *events, uint32_t count,
+                         int32_t *yn, uint32_t frames, double *ns);
+
+  /** Number of voices not idle */
+  uint32_t voice_host_active(const voice_host_t *vh);
+
+  const char *voice_host_policy_name(uint32_t policy);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __voice_host_h
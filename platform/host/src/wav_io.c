@@ -0,0 +1,153 @@
+/*
+ * File: wav_io.c
+ *
+ * Minimal WAV file input/output for host renders.
+ *
+ * 2018 (c) Korg
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "wav_io.h"
+
+#define WAV_FORMAT_PCM   (1)
+#define WAV_FORMAT_FLOAT (3)
+
+static void put_u16(uint8_t *p, uint16_t x) {
+  p[0] = (uint8_t)x;
+  p[1] = (uint8_t)(x >> 8);
+}
+
+static void put_u32(uint8_t *p, uint32_t x) {
+  put_u16(p, (uint16_t)x);
+  put_u16(p + 2, (uint16_t)(x >> 16));
+}
+
+static uint32_t get_u16(const uint8_t *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8);
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+  return get_u16(p) | (get_u16(p + 2) << 16);
+}
+
+static int write_header(wav_writer_t *w) {
+  const uint32_t bytes = w->frames * w->channels * 4;
+  uint8_t h[44];
+  memcpy(h, "RIFF", 4);
+  put_u32(h + 4, 36 + bytes);
+  memcpy(h + 8, "WAVEfmt ", 8);
+  put_u32(h + 16, 16);
+  put_u16(h + 20, WAV_FORMAT_FLOAT);
+  put_u16(h + 22, (uint16_t)w->channels);
+  put_u32(h + 24, w->rate);
+  put_u32(h + 28, w->rate * w->channels * 4);
+  put_u16(h + 32, (uint16_t)(w->channels * 4));
+  put_u16(h + 34, 32);
+  memcpy(h + 36, "data", 4);
+  put_u32(h + 40, bytes);
+  return (fseek(w->fp, 0, SEEK_SET) == 0 && fwrite(h, sizeof(h), 1, w->fp) == 1) ? 0 : -1;
+}
+
+int wav_open_write(wav_writer_t *w, const char *path, uint32_t channels, uint32_t rate) {
+  w->fp = fopen(path, "wb");
+  w->channels = channels;
+  w->rate = rate;
+  w->frames = 0;
+  if (w->fp == NULL) {
+    perror(path);
+    return -1;
+  }
+  return write_header(w);
+}
+
+int wav_write(wav_writer_t *w, const float *xn, uint32_t frames) {
+  // Samples are stored little endian, as on the supported hosts
+  if (fwrite(xn, sizeof(float) * w->channels, frames, w->fp) != frames)
+    return -1;
+  w->frames += frames;
+  return 0;
+}
+
+int wav_close(wav_writer_t *w) {
+  int ret = write_header(w);
+  if (fclose(w->fp) != 0)
+    ret = -1;
+  w->fp = NULL;
+  return ret;
+}
+
+float *wav_read(const char *path, uint32_t *channels, uint32_t *frames, uint32_t *rate) {
+  FILE *fp = fopen(path, "rb");
+  if (fp == NULL) {
+    perror(path);
+    return NULL;
+  }
+
+  uint8_t h[12];
+  if (fread(h, sizeof(h), 1, fp) != 1 || memcmp(h, "RIFF", 4) != 0 || memcmp(h + 8, "WAVE", 4) != 0) {
+    fprintf(stderr, "%s: not a WAV file\n", path);
+    fclose(fp);
+    return NULL;
+  }
+
+  uint32_t format = 0, bits = 0;
+  *channels = 0;
+  float *xn = NULL;
+
+  uint8_t ck[8];
+  while (fread(ck, sizeof(ck), 1, fp) == 1) {
+    const uint32_t size = get_u32(ck + 4);
+    if (memcmp(ck, "fmt ", 4) == 0 && size >= 16) {
+      uint8_t f[16];
+      if (fread(f, sizeof(f), 1, fp) != 1)
+        break;
+      format = get_u16(f);
+      *channels = get_u16(f + 2);
+      *rate = get_u32(f + 4);
+      bits = get_u16(f + 14);
+      fseek(fp, (long)(size - 16 + (size & 1)), SEEK_CUR);
+    }
+    else if (memcmp(ck, "data", 4) == 0 && *channels != 0) {
+      const uint32_t bytes = bits / 8;
+      const int supported = (format == WAV_FORMAT_FLOAT && bits == 32)
+        || (format == WAV_FORMAT_PCM && (bits == 16 || bits == 24 || bits == 32));
+      if (!supported)
+        break;
+      const uint32_t n = size / bytes;
+      uint8_t *raw = (uint8_t *)malloc(size);
+      xn = (float *)malloc((n ? n : 1) * sizeof(float));
+      if (raw == NULL || xn == NULL || fread(raw, 1, size, fp) != size) {
+        free(raw);
+        free(xn);
+        xn = NULL;
+        break;
+      }
+      for (uint32_t i = 0; i < n; ++i) {
+        const uint8_t *p = raw + i * bytes;
+        if (format == WAV_FORMAT_FLOAT) {
+          const uint32_t u = get_u32(p);
+          memcpy(&xn[i], &u, sizeof(float));
+        }
+        else if (bits == 16)
+          xn[i] = (int16_t)get_u16(p) * (1.f / 32768.f);
+        else if (bits == 24)
+          xn[i] = (int32_t)((get_u16(p) << 8) | ((uint32_t)p[2] << 24)) * (1.f / 2147483648.f);
+        else
+          xn[i] = (int32_t)get_u32(p) * (1.f / 2147483648.f);
+      }
+      free(raw);
+      *frames = n / *channels;
+      break;
+    }
+    else
+      fseek(fp, (long)(size + (size & 1)), SEEK_CUR);
+  }
+
+  fclose(fp);
+  if (xn == NULL)
+    fprintf(stderr, "%s: unsupported or truncated WAV file\n", path);
+  return xn;
+}
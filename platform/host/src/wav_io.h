@@ -0,0 +1,47 @@
+/*
+ * File: wav_io.h
+ *
+ * Minimal WAV file input/output for host renders.
+ *
+ * 2018 (c) Korg
+ *
+ */
+
+#ifndef __wav_io_h
+#define __wav_io_h
+
+#include <stdio.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  typedef struct wav_writer {
+    FILE *fp;
+    uint32_t channels;
+    uint32_t rate;
+    uint32_t frames;
+  } wav_writer_t;
+
+  /** Create a 32-bit float WAV file. Returns 0 on success. */
+  int wav_open_write(wav_writer_t *w, const char *path, uint32_t channels, uint32_t rate);
+
+  /** Append interleaved frames. Returns 0 on success. */
+  int wav_write(wav_writer_t *w, const float *xn, uint32_t frames);
+
+  /** Finalize the header and close. Returns 0 on success. */
+  int wav_close(wav_writer_t *w);
+
+  /**
+   * Read a 16/24/32-bit PCM or 32-bit float WAV file.
+   *
+   * @return Interleaved samples to be released with free(), NULL on error
+   */
+  float *wav_read(const char *path, uint32_t *channels, uint32_t *frames, uint32_t *rate);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __wav_io_h
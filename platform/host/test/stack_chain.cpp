@@ -0,0 +1,49 @@
+/*
+ * File: stack_chain.cpp
+ *
+ * Call chains of two hooks through an anonymous namespace and two instances of a template, the shapes of the DSP
+ * engines, for the stack_check test. stack_chain.list is the matching listing.
+ *
+ * 2018 (c) Korg
+ *
+ */
+
+#include <string.h>
+
+namespace dsp {
+
+  template<int N>
+  struct Line {
+    __attribute__((noinline)) float process(const float *x);
+  };
+
+  template<int N>
+  float Line<N>::process(const float *x) {
+    volatile float buf[200 * N];
+    for (int i = 0; i < 200 * N; ++i)
+      buf[i] = x[i % 16];
+    return buf[x[0] > 0.f ? 3 : 7];
+  }
+
+}
+
+namespace {
+
+  __attribute__((noinline)) float run(const float *x) {
+    volatile float acc[8];
+    static dsp::Line<4> line;
+    acc[1] = x[1];
+    return line.process(x) + acc[1];
+  }
+
+}
+
+extern "C" float _hook_process(const float *x) {
+  return run(x);
+}
+
+extern "C" float _hook_init(float *x) {
+  static dsp::Line<1> line;
+  memset(x, 0, 16 * sizeof(float));
+  return line.process(x);
+}
@@ -0,0 +1,247 @@
+/*
+ * File: fmath.cpp
+ *
+ * Accuracy and speed characterization of the float_math.h approximations and the
+ * lookup table based functions of osc_api.h and fx_api.h.
+ *
+ * Each function is swept over its domain against a double precision libm reference.
+ * Reports maximum and RMS error, maximum error in ULPs and their distribution,
+ * monotonicity violations, and host ns/call next to the libm reference.
+ *
+ * Usage: fmath [-c] [name ...]
+ *   -c    Comma separated output.
+ *   name  Only report functions whose name starts with one of the given prefixes.
+ *
+ * 2018 (c) Korg
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include <algorithm>
+
+#include "fmath_funcs.h"
+
+static const uint32_t k_sweep_points = 1U << 20;
+static const uint32_t k_bench_points = 4096;
+static const uint32_t k_bench_rounds = 256;
+static const uint32_t k_bench_passes = 5;
+
+/* ULP histogram bucket upper bounds, last bucket is open ended. */
+static const uint32_t k_ulp_buckets[] = { 0, 1, 3, 15, 255, 65535 };
+static const uint32_t k_ulp_bucket_cnt = sizeof(k_ulp_buckets) / sizeof(k_ulp_buckets[0]) + 1;
+static const char * const k_ulp_bucket_names[] = { "0", "1", "2-3", "4-15", "16-255", "256-64K", ">64K" };
+
+typedef float (*approx_fn)(float);
+typedef double (*ref_fn)(double);
+
+struct Result {
+  double max_err;
+  double max_err_at;
+  double rms_err;
+  uint32_t max_ulp;
+  uint32_t ulp_hist[k_ulp_bucket_cnt];
+  uint32_t mono_violations;
+  uint32_t non_finite;
+  double ns;
+  double ref_ns;
+};
+
+struct Entry {
+  const char *name;
+  approx_fn approx;
+  ref_fn ref;
+  double (*bench)(const float *in);
+  double (*ref_bench)(const float *in);
+  float lo, hi;
+  int sweep, error, monotonic;
+};
+
+static volatile float s_sink;
+static volatile double s_dsink;
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/*
+ * Fastest of several passes over a fixed input block. The function is a template
+ * parameter so that it is inlined into the loop as it would be in unit code.
+ */
+template <float (*F)(float)>
+static double bench(const float *in) {
+  double best = 1e30;
+  for (uint32_t p = 0; p < k_bench_passes; ++p) {
+    float acc = 0.f;
+    const double t0 = now_ns();
+    for (uint32_t r = 0; r < k_bench_rounds; ++r)
+      for (uint32_t i = 0; i < k_bench_points; ++i)
+        acc += F(in[i]);
+    const double t1 = now_ns();
+    s_sink = acc;
+    best = std::min(best, (t1 - t0) / (k_bench_rounds * k_bench_points));
+  }
+  return best;
+}
+
+template <double (*F)(double)>
+static double ref_bench(const float *in) {
+  double best = 1e30;
+  for (uint32_t p = 0; p < k_bench_passes; ++p) {
+    double acc = 0.0;
+    const double t0 = now_ns();
+    for (uint32_t r = 0; r < k_bench_rounds; ++r)
+      for (uint32_t i = 0; i < k_bench_points; ++i)
+        acc += F(in[i]);
+    const double t1 = now_ns();
+    s_dsink = acc;
+    best = std::min(best, (t1 - t0) / (k_bench_rounds * k_bench_points));
+  }
+  return best;
+}
+
+#define FM_DEFINE(name, approx, ref, lo, hi, sweep, error, mono) \
+  static inline float fm_##name(float x) { return approx; }      \
+  static double fm_ref_##name(double x) { return ref; }
+FMATH_FUNCS(FM_DEFINE)
+#undef FM_DEFINE
+
+#define FM_ENTRY(name, approx, ref, lo, hi, sweep, error, mono) \
+  { #name, fm_##name, fm_ref_##name, bench<fm_##name>, ref_bench<fm_ref_##name>, (float)(lo), (float)(hi), sweep, error, mono },
+static const Entry s_entries[] = {
+  FMATH_FUNCS(FM_ENTRY)
+};
+#undef FM_ENTRY
+
+static const uint32_t k_entry_cnt = sizeof(s_entries) / sizeof(s_entries[0]);
+
+/* Map floats onto a monotonic integer line so that ULP distances are plain differences. */
+static int64_t ordered(float f) {
+  int32_t i;
+  memcpy(&i, &f, sizeof(i));
+  return (i < 0) ? (int64_t)INT32_MIN - i : (int64_t)i;
+}
+
+static uint32_t ulp_distance(float a, float b) {
+  const int64_t d = ordered(a) - ordered(b);
+  const int64_t ad = (d < 0) ? -d : d;
+  return (ad > UINT32_MAX) ? UINT32_MAX : (uint32_t)ad;
+}
+
+static float sweep_point(const Entry &e, uint32_t i, uint32_t n) {
+  const double t = (double)i / (n - 1);
+  if (e.sweep == FM_LOG)
+    return (float)exp(log((double)e.lo) + t * (log((double)e.hi) - log((double)e.lo)));
+  return (float)(e.lo + t * ((double)e.hi - e.lo));
+}
+
+static void characterize(const Entry &e, Result &r, float *bench_in) {
+  memset(&r, 0, sizeof(r));
+  double sum_sq = 0.0;
+  float prev = 0.f;
+  bool has_prev = false;
+  uint32_t n = 0;
+  for (uint32_t i = 0; i < k_sweep_points; ++i) {
+    const float x = sweep_point(e, i, k_sweep_points);
+    const float y = e.approx(x);
+    const double ref = e.ref(x);
+    if (!isfinite(y)) {
+      ++r.non_finite;
+      has_prev = false;
+      continue;
+    }
+    double err = fabs((double)y - ref);
+    if (e.error == FM_REL)
+      err /= std::max(fabs(ref), 1e-30);
+    if (err > r.max_err) {
+      r.max_err = err;
+      r.max_err_at = x;
+    }
+    sum_sq += err * err;
+    ++n;
+    const uint32_t ulp = ulp_distance(y, (float)ref);
+    r.max_ulp = std::max(r.max_ulp, ulp);
+    uint32_t b = 0;
+    while (b < k_ulp_bucket_cnt - 1 && ulp > k_ulp_buckets[b])
+      ++b;
+    ++r.ulp_hist[b];
+    if (has_prev && e.monotonic && ((e.monotonic > 0) ? (y < prev) : (y > prev)))
+      ++r.mono_violations;
+    prev = y;
+    has_prev = true;
+  }
+  r.rms_err = n ? sqrt(sum_sq / n) : 0.0;
+
+  /* Scattered inputs so that branches and table accesses are not trivially predictable. */
+  for (uint32_t i = 0; i < k_bench_points; ++i)
+    bench_in[i] = sweep_point(e, (i * 2654435761U) % k_bench_points, k_bench_points);
+  r.ns = e.bench(bench_in);
+  r.ref_ns = e.ref_bench(bench_in);
+}
+
+static bool selected(const char *name, int argc, char **argv, int first) {
+  if (first >= argc)
+    return true;
+  for (int i = first; i < argc; ++i)
+    if (!strncmp(name, argv[i], strlen(argv[i])))
+      return true;
+  return false;
+}
+
+int main(int argc, char **argv) {
+  bool csv = false;
+  int first = 1;
+  if (argc > 1 && !strcmp(argv[1], "-c")) {
+    csv = true;
+    first = 2;
+  }
+
+  static float bench_in[k_bench_points];
+
+  if (csv) {
+    printf("function,lo,hi,error,max_err,max_err_at,rms_err,max_ulp");
+    for (uint32_t b = 0; b < k_ulp_bucket_cnt; ++b)
+      printf(",ulp_%s", k_ulp_bucket_names[b]);
+    printf(",mono_violations,non_finite,ns_call,ref_ns_call\n");
+  }
+  else {
+    printf("%-18s %-20s %3s %10s %10s %10s %10s  %-40s %5s %7s %7s\n",
+           "function", "domain", "err", "max", "at", "rms", "max ulp",
+           "ulp distribution % (0|1|2-3|4-15|16-255|256-64K|>64K)", "mono", "ns", "libm ns");
+  }
+
+  for (uint32_t k = 0; k < k_entry_cnt; ++k) {
+    const Entry &e = s_entries[k];
+    if (!selected(e.name, argc, argv, first))
+      continue;
+    Result r;
+    characterize(e, r, bench_in);
+    const uint32_t total = k_sweep_points - r.non_finite;
+    if (csv) {
+      printf("%s,%g,%g,%s,%.6g,%.6g,%.6g,%u", e.name, e.lo, e.hi, e.error == FM_REL ? "rel" : "abs",
+             r.max_err, r.max_err_at, r.rms_err, r.max_ulp);
+      for (uint32_t b = 0; b < k_ulp_bucket_cnt; ++b)
+        printf(",%u", r.ulp_hist[b]);
+      printf(",%u,%u,%.3f,%.3f\n", r.mono_violations, r.non_finite, r.ns, r.ref_ns);
+      continue;
+    }
+    char domain[32], dist[64], mono[8];
+    snprintf(domain, sizeof(domain), "[%g, %g]", e.lo, e.hi);
+    int len = 0;
+    for (uint32_t b = 0; b < k_ulp_bucket_cnt; ++b)
+      len += snprintf(dist + len, sizeof(dist) - len, "%s%.0f", b ? "|" : "",
+                      total ? 100.0 * r.ulp_hist[b] / total : 0.0);
+    if (e.monotonic)
+      snprintf(mono, sizeof(mono), "%u", r.mono_violations);
+    else
+      snprintf(mono, sizeof(mono), "-");
+    printf("%-18s %-20s %3s %10.3g %10.4g %10.3g %10u  %-40s %5s %7.2f %7.2f%s\n",
+           e.name, domain, e.error == FM_REL ? "rel" : "abs", r.max_err, r.max_err_at, r.rms_err, r.max_ulp,
+           dist, mono, r.ns, r.ref_ns, r.non_finite ? " (non-finite results)" : "");
+  }
+  return 0;
+}
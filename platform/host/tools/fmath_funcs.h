@@ -0,0 +1,82 @@
+/*
+ * File: fmath_funcs.h
+ *
+ * Functions covered by the math characterization harness, shared by its host and Cortex-M4 builds.
+ *
+ * Each entry is X(name, approximation of float x, reference of double x, low, high, sweep, error, monotonic):
+ *  - sweep: FM_LIN for uniformly spaced inputs, FM_LOG for logarithmically spaced positive inputs.
+ *  - error: FM_ABS reports absolute error, FM_REL relative error.
+ *  - monotonic: 1 or -1 when the reference is increasing or decreasing over the domain, 0 otherwise.
+ *
+ * 2018 (c) Korg
+ *
+ */
+
+#ifndef __fmath_funcs_h
+#define __fmath_funcs_h
+
+#include "float_math.h"
+#include "osc_api.h"
+#include "fx_api.h"
+#include "api_curves.h"
+#include "approx.hpp"
+
+#define FM_LIN 0
+#define FM_LOG 1
+
+#define FM_ABS 0
+#define FM_REL 1
+
+#define FMATH_FUNCS(X)                                                                                                  \
+  /* float_math.h */                                                                                                    \
+  X(fastsinf,          fastsinf(x),               sin(x),                     -M_PI,   M_PI,    FM_LIN, FM_ABS,  0)     \
+  X(fastersinf,        fastersinf(x),             sin(x),                     -M_PI,   M_PI,    FM_LIN, FM_ABS,  0)     \
+  X(fastsinfullf,      fastsinfullf(x),           sin(x),                     -100.f,  100.f,   FM_LIN, FM_ABS,  0)     \
+  X(fastersinfullf,    fastersinfullf(x),         sin(x),                     -100.f,  100.f,   FM_LIN, FM_ABS,  0)     \
+  X(fastcosf,          fastcosf(x),               cos(x),                     -M_PI,   M_PI,    FM_LIN, FM_ABS,  0)     \
+  X(fastercosf,        fastercosf(x),             cos(x),                     -M_PI,   M_PI,    FM_LIN, FM_ABS,  0)     \
+  X(fastcosfullf,      fastcosfullf(x),           cos(x),                     -100.f,  100.f,   FM_LIN, FM_ABS,  0)     \
+  X(fastercosfullf,    fastercosfullf(x),         cos(x),                     -100.f,  100.f,   FM_LIN, FM_ABS,  0)     \
+  X(fasttanf,          fasttanf(x),               tan(x),                     -1.5f,   1.5f,    FM_LIN, FM_REL,  1)     \
+  X(fastertanf,        fastertanf(x),             tan(x),                     -1.5f,   1.5f,    FM_LIN, FM_REL,  1)     \
+  X(fastlog2f,         fastlog2f(x),              log2(x),                    1e-6f,   1e6f,    FM_LOG, FM_ABS,  1)     \
+  X(fasterlog2f,       fasterlog2f(x),            log2(x),                    1e-6f,   1e6f,    FM_LOG, FM_ABS,  1)     \
+  X(fastlogf,          fastlogf(x),               log(x),                     1e-6f,   1e6f,    FM_LOG, FM_ABS,  1)     \
+  X(fasterlogf,        fasterlogf(x),             log(x),                     1e-6f,   1e6f,    FM_LOG, FM_ABS,  1)     \
+  X(fastpow2f,         fastpow2f(x),              exp2(x),                    -24.f,   24.f,    FM_LIN, FM_REL,  1)     \
+  X(fasterpow2f,       fasterpow2f(x),            exp2(x),                    -24.f,   24.f,    FM_LIN, FM_REL,  1)     \
+  X(fastexpf,          fastexpf(x),               exp(x),                     -16.f,   16.f,    FM_LIN, FM_REL,  1)     \
+  X(fasterexpf,        fasterexpf(x),             exp(x),                     -16.f,   16.f,    FM_LIN, FM_REL,  1)     \
+  X(fastpowf_2_2,      fastpowf(x, 2.2f),         pow(x, 2.2),                1e-3f,   1e3f,    FM_LOG, FM_REL,  1)     \
+  X(fasterpowf_2_2,    fasterpowf(x, 2.2f),       pow(x, 2.2),                1e-3f,   1e3f,    FM_LOG, FM_REL,  1)     \
+  X(fasteratan2f_x1,   fasteratan2f(x, 1.f),      atan2(x, 1.0),              -100.f,  100.f,   FM_LIN, FM_ABS,  1)     \
+  X(fasteratan2f_y1,   fasteratan2f(1.f, x),      atan2(1.0, x),              -100.f,  100.f,   FM_LIN, FM_ABS, -1)     \
+  X(fastertanhf,       fastertanhf(x),            tanh(x),                    -4.f,    4.f,     FM_LIN, FM_ABS,  1)     \
+  X(fasterampdbf,      fasterampdbf(x),           20.0 * log10(x),            1e-5f,   10.f,    FM_LOG, FM_ABS,  1)     \
+  X(fasterdbampf,      fasterdbampf(x),           pow(10.0, 0.05 * x),        -120.f,  24.f,    FM_LIN, FM_REL,  1)     \
+  /* osc_api.h / fx_api.h lookup tables, fx_ variants share tables and code with their osc_ counterparts */            \
+  X(osc_sinf,          osc_sinf(x),               sin(2.0 * M_PI * x),        0.f,     0.999f,  FM_LIN, FM_ABS,  0)     \
+  X(osc_cosf,          osc_cosf(x),               cos(2.0 * M_PI * x),        0.f,     0.999f,  FM_LIN, FM_ABS,  0)     \
+  X(osc_logf,          osc_logf(x),               log(x),                     1e-5f,   1.f,     FM_LOG, FM_ABS,  1)     \
+  X(osc_tanpif,        osc_tanpif(x),             tan(M_PI * x),              1e-4f,   0.49f,   FM_LIN, FM_REL,  1)     \
+  X(osc_sqrtm2logf,    osc_sqrtm2logf(x),         sqrt(-2.0 * log(x)),        0.005f,  1.f,     FM_LIN, FM_ABS, -1)     \
+  X(fx_pow2f,          fx_pow2f(x),               exp2(x),                    0.f,     3.f,     FM_LIN, FM_REL,  1)     \
+  X(osc_bitresf,       osc_bitresf(x),            api_curve_bitres(x),        0.f,     0.999f,  FM_LIN, FM_REL, -1)     \
+  X(osc_sat_cubicf,    osc_sat_cubicf(x),         copysign(api_curve_cubicsat(fabs(x)), x), -0.999f, 0.999f, FM_LIN, FM_ABS, 1) \
+  X(osc_sat_schetzenf, osc_sat_schetzenf(x),      copysign(api_curve_schetzen(fabs(x)), x), -0.999f, 0.999f, FM_LIN, FM_ABS, 1) \
+  /* approx.hpp */                                                                                                      \
+  X(approx_sin3,       dsp::approx::sin<3>(x),    sin(x),                     -M_PI,   M_PI,    FM_LIN, FM_ABS,  0)     \
+  X(approx_sin5,       dsp::approx::sin<5>(x),    sin(x),                     -M_PI,   M_PI,    FM_LIN, FM_ABS,  0)     \
+  X(approx_sin7,       dsp::approx::sin<7>(x),    sin(x),                     -M_PI,   M_PI,    FM_LIN, FM_ABS,  0)     \
+  X(approx_sin9,       dsp::approx::sin<9>(x),    sin(x),                     -M_PI,   M_PI,    FM_LIN, FM_ABS,  0)     \
+  X(approx_exp2_3,     dsp::approx::exp2<3>(x),   exp2(x),                    -24.f,   24.f,    FM_LIN, FM_REL,  1)     \
+  X(approx_exp2_4,     dsp::approx::exp2<4>(x),   exp2(x),                    -24.f,   24.f,    FM_LIN, FM_REL,  1)     \
+  X(approx_exp2_5,     dsp::approx::exp2<5>(x),   exp2(x),                    -24.f,   24.f,    FM_LIN, FM_REL,  1)     \
+  X(approx_exp2_6,     dsp::approx::exp2<6>(x),   exp2(x),                    -24.f,   24.f,    FM_LIN, FM_REL,  1)     \
+  X(approx_log2_4,     dsp::approx::log2<4>(x),   log2(x),                    1e-6f,   1e6f,    FM_LOG, FM_ABS,  1)     \
+  X(approx_log2_6,     dsp::approx::log2<6>(x),   log2(x),                    1e-6f,   1e6f,    FM_LOG, FM_ABS,  1)     \
+  X(approx_log2_8,     dsp::approx::log2<8>(x),   log2(x),                    1e-6f,   1e6f,    FM_LOG, FM_ABS,  1)     \
+  X(approx_tanh3,      dsp::approx::tanh<3>(x),   tanh(x),                    -4.f,    4.f,     FM_LIN, FM_ABS,  1)     \
+  X(approx_tanh5,      dsp::approx::tanh<5>(x),   tanh(x),                    -4.f,    4.f,     FM_LIN, FM_ABS,  1)
+
+#endif // __fmath_funcs_h
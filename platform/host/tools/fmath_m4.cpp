@@ -0,0 +1,15 @@
+/*
+ * File: fmath_m4.cpp
+ *
+ * Out of line instances of the characterized functions, compiled for Cortex-M4 so that
+ * their instruction counts can be read back from the object file disassembly.
+ *
+ * 2018 (c) Korg
+ *
+ */
+
+#include "fmath_funcs.h"
+
+#define FM_DEFINE(name, approx, ...) \
+  extern "C" __attribute__((noinline)) float m4_##name(float x) { return approx; }
+FMATH_FUNCS(FM_DEFINE)
@@ -0,0 +1,366 @@
+/*
+ * File: golden.cpp
+ *
+ * Golden render regression of units built as native shared objects.
+ *
+ * Renders each unit through the event script of its module and compares the output with a stored golden render:
+ *  - Maximum absolute sample error.
+ *  - SNR of the golden render against the difference, in dB.
+ *  - Log-spectral distance, the RMS dB difference of 1024 point Hann windowed power spectra averaged over frames,
+ *    with a -120dBFS floor.
+ * Tolerances are set per unit in a thresholds file. Any output change is listed, bit exact renders are reported as
+ * such, so that refactors meant to be transparent can be told apart from those within tolerance.
+ *
+ * 2018 (c) Korg
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fnmatch.h>
+#include <sys/stat.h>
+
+#include "fft.hpp"
+
+#include "api_host.h"
+#include "unit_host.h"
+#include "event_script.h"
+#include "render_job.h"
+#include "wav_io.h"
+
+static const uint32_t k_spectrum_size = 1024;
+static const double k_spectrum_floor = 1e-12;
+
+struct Tolerance {
+  double max_abs;
+  double min_snr;
+  double max_lsd;
+};
+
+struct Rule {
+  char pattern[128];
+  Tolerance tol;
+};
+
+struct Metrics {
+  double max_abs;
+  double snr;
+  double lsd;
+  bool identical;
+};
+
+static void usage(const char *name) {
+  fprintf(stderr,
+          "usage: %s [options] unit.so ...\n"
+          "  -u          update the golden renders instead of comparing\n"
+          "  -g dir      golden renders (default: golden/renders)\n"
+          "  -s dir      event scripts, <dir>/<platform>/<module>/<name>.ev or <dir>/<module>.ev (default: golden)\n"
+          "  -t file     tolerances (default: golden/thresholds.txt)\n"
+          "  -v          print metrics of bit exact renders too\n",
+          name);
+}
+
+/* <platform>/<module>/<name> from the last components of a unit path */
+static int unit_name(const char *path, char *name, size_t size) {
+  const char *p = path + strlen(path);
+  int slashes = 0;
+  while (p > path && slashes < 3)
+    if (*--p == '/' && ++slashes == 3)
+      ++p;
+  if (slashes < 2)
+    return -1;
+  snprintf(name, size, "%s", p);
+  char *ext = strrchr(name, '.');
+  if (ext != NULL && strcmp(ext, ".so") == 0)
+    *ext = '\0';
+  return 0;
+}
+
+static int make_dirs(const char *path) {
+  char buf[4096];
+  snprintf(buf, sizeof(buf), "%s", path);
+  for (char *p = buf + 1; *p; ++p) {
+    if (*p != '/')
+      continue;
+    *p = '\0';
+    if (mkdir(buf, 0777) != 0 && errno != EEXIST)
+      return -1;
+    *p = '/';
+  }
+  return 0;
+}
+
+static int load_rules(const char *path, Rule **rules, uint32_t *count) {
+  FILE *fp = fopen(path, "r");
+  if (fp == NULL) {
+    perror(path);
+    return -1;
+  }
+
+  char line[256];
+  uint32_t lineno = 0;
+  int ret = 0;
+  *rules = NULL;
+  *count = 0;
+  while (fgets(line, sizeof(line), fp) != NULL) {
+    ++lineno;
+    char *comment = strchr(line, '#');
+    if (comment != NULL)
+      *comment = '\0';
+
+    Rule r;
+    char extra;
+    const int n = sscanf(line, "%127s %lf %lf %lf %c", r.pattern, &r.tol.max_abs, &r.tol.min_snr, &r.tol.max_lsd,
+                         &extra);
+    if (n <= 0)
+      continue;
+    if (n != 4) {
+      fprintf(stderr, "%s:%u: invalid tolerance: %s", path, (unsigned)lineno, line);
+      ret = -1;
+      break;
+    }
+
+    Rule *grown = (Rule *)realloc(*rules, (*count + 1) * sizeof(Rule));
+    if (grown == NULL) {
+      ret = -1;
+      break;
+    }
+    *rules = grown;
+    (*rules)[(*count)++] = r;
+  }
+
+  fclose(fp);
+  return ret;
+}
+
+static const Tolerance *find_tolerance(const Rule *rules, uint32_t count, const char *name) {
+  for (uint32_t i = 0; i < count; ++i)
+    if (fnmatch(rules[i].pattern, name, 0) == 0)
+      return &rules[i].tol;
+  return NULL;
+}
+
+/* Mean log-spectral distance over channels and frames, hop of half a window */
+static double spectral_distance(const float *ref, const float *test, uint32_t channels, uint32_t frames) {
+  static float twiddles[dsp::FFT::twiddlesSize(k_spectrum_size)];
+  static float window[k_spectrum_size];
+  static dsp::FFT fft;
+  static bool ready = false;
+  if (!ready) {
+    dsp::FFT::computeTwiddles(twiddles, k_spectrum_size);
+    fft.setTwiddles(twiddles, k_spectrum_size, k_spectrum_size);
+    for (uint32_t i = 0; i < k_spectrum_size; ++i)
+      window[i] = (float)(0.5 - 0.5 * cos(2.0 * M_PI * i / k_spectrum_size));
+    ready = true;
+  }
+
+  float a[2 * k_spectrum_size], b[2 * k_spectrum_size];
+  // Power of a full scale sine
+  const double norm = 1.0 / ((double)k_spectrum_size * k_spectrum_size / 16.0);
+  double sum = 0;
+  uint32_t n = 0;
+
+  for (uint32_t c = 0; c < channels; ++c) {
+    for (uint32_t pos = 0; pos + k_spectrum_size <= frames; pos += k_spectrum_size / 2) {
+      for (uint32_t i = 0; i < k_spectrum_size; ++i) {
+        a[2*i] = ref[(pos + i) * channels + c] * window[i];
+        b[2*i] = test[(pos + i) * channels + c] * window[i];
+        a[2*i+1] = b[2*i+1] = 0.f;
+      }
+      fft.forward(a);
+      fft.forward(b);
+
+      double d2 = 0;
+      for (uint32_t k = 0; k <= k_spectrum_size / 2; ++k) {
+        const double pa = ((double)a[2*k] * a[2*k] + (double)a[2*k+1] * a[2*k+1]) * norm;
+        const double pb = ((double)b[2*k] * b[2*k] + (double)b[2*k+1] * b[2*k+1]) * norm;
+        const double d = 10 * log10(pa + k_spectrum_floor) - 10 * log10(pb + k_spectrum_floor);
+        d2 += d * d;
+      }
+      sum += sqrt(d2 / (k_spectrum_size / 2 + 1));
+      ++n;
+    }
+  }
+
+  return n ? sum / n : 0.0;
+}
+
+static Metrics compare(const float *ref, const float *test, uint32_t channels, uint32_t frames) {
+  Metrics m;
+  double signal = 0, noise = 0;
+  m.max_abs = 0;
+  m.identical = (memcmp(ref, test, (size_t)channels * frames * sizeof(float)) == 0);
+
+  for (uint32_t i = 0; i < channels * frames; ++i) {
+    const double e = (double)test[i] - ref[i];
+    m.max_abs = (fabs(e) > m.max_abs) ? fabs(e) : m.max_abs;
+    signal += (double)ref[i] * ref[i];
+    noise += e * e;
+  }
+
+  // NaN outputs fail all comparisons
+  if (m.max_abs != m.max_abs)
+    m.max_abs = INFINITY;
+  m.snr = (noise == 0) ? INFINITY : (signal == 0) ? -INFINITY : 10 * log10(signal / noise);
+  m.lsd = m.identical ? 0.0 : spectral_distance(ref, test, channels, frames);
+  return m;
+}
+
+static bool within(const Metrics &m, const Tolerance &t) {
+  return m.max_abs <= t.max_abs && m.snr >= t.min_snr && m.lsd <= t.max_lsd;
+}
+
+static int load_script(event_script_t *s, const char *dir, const char *name, uint32_t module) {
+  char path[4096];
+  snprintf(path, sizeof(path), "%s/%s.ev", dir, name);
+  if (access(path, R_OK) != 0)
+    snprintf(path, sizeof(path), "%s/%s.ev", dir, unit_host_module_name(module));
+  if (event_script_load(s, path, module) != 0)
+    return -1;
+  if (s->length == 0) {
+    fprintf(stderr, "%s: no end event\n", path);
+    return -1;
+  }
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  const char *golden_dir = "golden/renders";
+  const char *script_dir = "golden";
+  const char *rules_path = "golden/thresholds.txt";
+  bool update = false;
+  bool verbose = false;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "ug:s:t:vh")) != -1) {
+    switch (opt) {
+    case 'u': update = true; break;
+    case 'g': golden_dir = optarg; break;
+    case 's': script_dir = optarg; break;
+    case 't': rules_path = optarg; break;
+    case 'v': verbose = true; break;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  if (optind == argc) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  Rule *rules = NULL;
+  uint32_t rule_count = 0;
+  if (!update && load_rules(rules_path, &rules, &rule_count) != 0)
+    return 1;
+
+  uint32_t identical = 0, within_count = 0, failed = 0, missing = 0, errors = 0;
+
+  for (int arg = optind; arg < argc; ++arg) {
+    const char *path = argv[arg];
+    char name[256];
+    if (unit_name(path, name, sizeof(name)) != 0) {
+      fprintf(stderr, "%s: expected <platform>/<module>/<name>.so\n", path);
+      ++errors;
+      continue;
+    }
+
+    unit_host_t u;
+    if (unit_host_open(&u, path, 0) != 0) {
+      ++errors;
+      continue;
+    }
+    const uint32_t module = unit_host_module(&u);
+    const uint32_t channels = unit_host_channels(&u);
+
+    event_script_t script;
+    event_script_init(&script);
+    if (load_script(&script, script_dir, name, module) != 0) {
+      unit_host_close(&u);
+      ++errors;
+      continue;
+    }
+
+    render_job_t job;
+    render_job_init(&job);
+    job.script = &script;
+    job.input.type = k_render_input_noise;
+    float *out = (float *)calloc((size_t)script.length * channels, sizeof(float));
+    job.out = out;
+
+    render_result_t r;
+    const int status = (out != NULL) ? render_job_run(&u, &job, &r) : -1;
+    unit_host_close(&u);
+    if (status != 0) {
+      fprintf(stderr, "%s: render failed\n", name);
+      free(out);
+      event_script_free(&script);
+      ++errors;
+      continue;
+    }
+
+    char golden[4096];
+    snprintf(golden, sizeof(golden), "%s/%s.wav", golden_dir, name);
+
+    if (update) {
+      wav_writer_t wav;
+      if (make_dirs(golden) != 0 || wav_open_write(&wav, golden, channels, UNIT_HOST_FS) != 0
+          || wav_write(&wav, out, script.length) != 0 || wav_close(&wav) != 0) {
+        fprintf(stderr, "%s: write error\n", golden);
+        ++errors;
+      }
+      else
+        printf("%-40s updated\n", name);
+    }
+    else {
+      uint32_t ref_channels = 0, ref_frames = 0, ref_rate = 0;
+      float *ref = (access(golden, R_OK) == 0) ? wav_read(golden, &ref_channels, &ref_frames, &ref_rate) : NULL;
+      const Tolerance *tol = find_tolerance(rules, rule_count, name);
+
+      if (ref == NULL) {
+        printf("%-40s MISSING %s\n", name, golden);
+        ++missing;
+      }
+      else if (ref_channels != channels || ref_frames != script.length) {
+        printf("%-40s FAIL %u frames x %u channels, golden %u x %u\n", name, (unsigned)script.length,
+               (unsigned)channels, (unsigned)ref_frames, (unsigned)ref_channels);
+        ++failed;
+      }
+      else if (tol == NULL) {
+        fprintf(stderr, "%s: no tolerance in %s\n", name, rules_path);
+        ++errors;
+      }
+      else {
+        const Metrics m = compare(ref, out, channels, script.length);
+        const bool ok = m.identical || within(m, *tol);
+        if (m.identical)
+          ++identical;
+        else if (ok)
+          ++within_count;
+        else
+          ++failed;
+        if (!m.identical || verbose)
+          printf("%-40s %-9s max abs %.3g (%.3g), SNR %.1f dB (%.1f), spectral distance %.3f dB (%.3f)\n",
+                 name, m.identical ? "identical" : ok ? "changed" : "FAIL",
+                 m.max_abs, tol->max_abs, m.snr, tol->min_snr, m.lsd, tol->max_lsd);
+      }
+      free(ref);
+    }
+
+    free(out);
+    event_script_free(&script);
+  }
+
+  if (!update)
+    printf("%d units: %u identical, %u changed within tolerance, %u failed, %u without golden render, %u errors\n",
+           argc - optind, (unsigned)identical, (unsigned)within_count, (unsigned)failed, (unsigned)missing,
+           (unsigned)errors);
+
+  free(rules);
+  return (failed || missing || errors) ? 1 : 0;
+}
@@ -0,0 +1,35 @@
+# Counts instructions per m4_* symbol in "objdump -d" output of fmath_m4.o.
+#
+# Literal pool words are reported by objdump as .word and excluded from the count.
+# Branch counts are listed separately, as taken branches refill the pipeline.
+
+/^[0-9a-f]+ <m4_.*>:$/ {
+  name = $2
+  gsub(/^<m4_|>:$/, "", name)
+  order[++n] = name
+  next
+}
+
+/^[0-9a-f]+ <.*>:$/ {
+  name = ""
+  next
+}
+
+name != "" && /^ *[0-9a-f]+:\t/ {
+  split($0, f, "\t")
+  op = f[3]
+  sub(/ .*/, "", op)
+  if (op == "" || op ~ /^\.(word|short|byte)$/)
+    next
+  count[name]++
+  if (op ~ /^(b|bx|bl|blx|cbz|cbnz|b[a-z][a-z])(\.[nw])?$/ && op !~ /^bic|^bfi|^bfc/)
+    branches[name]++
+  if (op ~ /^vdiv|^vsqrt/)
+    slow[name]++
+}
+
+END {
+  printf "%-18s %8s %8s %10s\n", "function", "insns", "branches", "vdiv/vsqrt"
+  for (i = 1; i <= n; ++i)
+    printf "%-18s %8d %8d %10d\n", order[i], count[order[i]], branches[order[i]], slow[order[i]]
+}
@@ -0,0 +1,176 @@
+/*
+ * File: minimax.cpp
+ *
+ * Remez exchange solver generating the minimax coefficients of approx.hpp.
+ *
+ * Usage: minimax <sin|exp2|log2> <order>
+ *
+ * Coefficients are printed lowest degree first, along with the theoretical maximum
+ * relative error before rounding to single precision:
+ *  - sin:  sin(x) ~ x * P(x^2) for x in [-pi/2, pi/2], P has (order+1)/2 terms.
+ *  - exp2: 2^x ~ P(x) for x in [0, 1), P of degree order.
+ *  - log2: log2(1+t) ~ t * P(t) for t in [sqrt(1/2)-1, sqrt(2)-1], P has order terms.
+ *
+ * 2018 (c) Korg
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+typedef long double real;
+
+static const int k_max_terms = 16;
+static const int k_grid = 200000;
+static const int k_iterations = 100;
+
+struct Problem {
+  real lo, hi;
+  real (*target)(real);  // function approximated by the polynomial
+  real (*weight)(real);  // error weight, 1/target for relative error
+};
+
+static real sin_target(real u) { const real x = sqrtl(u); return (u > 0) ? sinl(x) / x : 1.L; }
+static real sin_weight(real u) { return 1.L / sin_target(u); }
+static real exp2_target(real x) { return exp2l(x); }
+static real exp2_weight(real x) { return 1.L / exp2l(x); }
+static real log2_target(real t) { return (t != 0) ? log2l(1.L + t) / t : 1.L / logl(2.L); }
+static real log2_weight(real t) { return 1.L / log2_target(t); }
+
+static real poly(const real *c, int n, real x) {
+  real y = c[n-1];
+  for (int k = n - 2; k >= 0; --k)
+    y = c[k] + x * y;
+  return y;
+}
+
+static real error_at(const Problem &p, const real *c, int n, real x) {
+  return p.weight(x) * (p.target(x) - poly(c, n, x));
+}
+
+/* Gaussian elimination with partial pivoting, a is m x (m+1) augmented. */
+static bool solve(real a[][k_max_terms + 2], int m, real *out) {
+  for (int col = 0; col < m; ++col) {
+    int piv = col;
+    for (int r = col + 1; r < m; ++r)
+      if (fabsl(a[r][col]) > fabsl(a[piv][col]))
+        piv = r;
+    if (fabsl(a[piv][col]) < 1e-300L)
+      return false;
+    for (int k = 0; k <= m; ++k) {
+      const real t = a[col][k]; a[col][k] = a[piv][k]; a[piv][k] = t;
+    }
+    for (int r = 0; r < m; ++r) {
+      if (r == col)
+        continue;
+      const real f = a[r][col] / a[col][col];
+      for (int k = col; k <= m; ++k)
+        a[r][k] -= f * a[col][k];
+    }
+  }
+  for (int r = 0; r < m; ++r)
+    out[r] = a[r][m] / a[r][r];
+  return true;
+}
+
+static real remez(const Problem &p, int n, real *c) {
+  const int m = n + 1;
+  real ref[k_max_terms + 1];
+  for (int i = 0; i < m; ++i)
+    ref[i] = 0.5L * (p.lo + p.hi) - 0.5L * (p.hi - p.lo) * cosl(M_PI * i / (m - 1));
+
+  static real xs[k_grid], es[k_grid];
+  real max_err = 0.L;
+  for (int it = 0; it < k_iterations; ++it) {
+    real a[k_max_terms + 1][k_max_terms + 2];
+    for (int i = 0; i < m; ++i) {
+      real xk = 1.L;
+      for (int k = 0; k < n; ++k, xk *= ref[i])
+        a[i][k] = xk;
+      a[i][n] = ((i & 1) ? -1.L : 1.L) / p.weight(ref[i]);
+      a[i][m] = p.target(ref[i]);
+    }
+    real sol[k_max_terms + 1];
+    if (!solve(a, m, sol))
+      break;
+    memcpy(c, sol, n * sizeof(real));
+    const real level = fabsl(sol[n]);
+
+    for (int g = 0; g < k_grid; ++g) {
+      xs[g] = p.lo + (p.hi - p.lo) * g / (k_grid - 1);
+      es[g] = error_at(p, c, n, xs[g]);
+    }
+
+    /* Extremum of each run of equal error sign. */
+    real ext_x[k_grid / 2], ext_e[k_grid / 2];
+    int cnt = 0;
+    for (int g = 0; g < k_grid; ) {
+      int best = g;
+      const bool pos = es[g] >= 0;
+      while (g < k_grid && (es[g] >= 0) == pos) {
+        if (fabsl(es[g]) > fabsl(es[best]))
+          best = g;
+        ++g;
+      }
+      ext_x[cnt] = xs[best];
+      ext_e[cnt] = es[best];
+      ++cnt;
+    }
+    /* Drop the smaller end extremum until m remain. */
+    int first = 0, last = cnt - 1;
+    while (last - first + 1 > m) {
+      if (fabsl(ext_e[first]) < fabsl(ext_e[last]))
+        ++first;
+      else
+        --last;
+    }
+    max_err = 0.L;
+    for (int g = 0; g < k_grid; ++g)
+      max_err = fmaxl(max_err, fabsl(es[g]));
+    if (last - first + 1 < m)
+      break;
+    for (int i = 0; i < m; ++i)
+      ref[i] = ext_x[first + i];
+    if (max_err - level < 1e-6L * max_err)
+      break;
+  }
+  return max_err;
+}
+
+int main(int argc, char **argv) {
+  if (argc != 3) {
+    fprintf(stderr, "Usage: %s <sin|exp2|log2> <order>\n", argv[0]);
+    return 1;
+  }
+  const int order = atoi(argv[2]);
+  Problem p;
+  int n;
+  if (!strcmp(argv[1], "sin")) {
+    p = { 0.L, (real)(M_PI * M_PI / 4.0), sin_target, sin_weight };
+    n = (order + 1) / 2;
+  }
+  else if (!strcmp(argv[1], "exp2")) {
+    p = { 0.L, 1.L, exp2_target, exp2_weight };
+    n = order + 1;
+  }
+  else if (!strcmp(argv[1], "log2")) {
+    p = { sqrtl(0.5L) - 1.L, sqrtl(2.L) - 1.L, log2_target, log2_weight };
+    n = order;
+  }
+  else {
+    fprintf(stderr, "Unknown function %s\n", argv[1]);
+    return 1;
+  }
+  if (n < 1 || n > k_max_terms) {
+    fprintf(stderr, "Unsupported order %d\n", order);
+    return 1;
+  }
+  real c[k_max_terms];
+  const real err = remez(p, n, c);
+  printf("// %s, order %d, max relative error %.3Le\n", argv[1], order, err);
+  for (int k = 0; k < n; ++k)
+    printf("%.9ef%s", (double)c[k], (k < n - 1) ? ", " : "\n");
+  return 0;
+}
@@ -0,0 +1,371 @@
+/*
+ * File: osc_quality.cpp
+ *
+ * Aliasing, THD and DC offset of oscillators over the whole note range, next to their CPU cost.
+ *
+ * Sweeps notes 0 to 151 through oscillator units built as native shared objects, and through the waveform primitives
+ * of osc_api.h driven directly. Each note is rendered at the pitch of osc_w0f_for_note() and analyzed with a 65536
+ * point Blackman-Harris windowed FFT:
+ *  - Aliasing: power outside the main lobes of the harmonics below Nyquist, relative to the total power.
+ *  - THD: power of harmonics 2 and up below Nyquist, relative to the fundamental. For waveforms other than sines it
+ *    measures harmonic content, and compares between implementations of the same waveform only.
+ *  - DC offset: mean of the samples, windowed.
+ * CPU cost is the mean host time per 64 frame block over the sweep.
+ *
+ * 2018 (c) Korg
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "fft.hpp"
+
+#include "api_host.h"
+#include "unit_host.h"
+
+static const uint32_t k_fft_size = 65536;
+static const uint32_t k_settle_frames = 4096;
+// Half width of the main lobe of the 4-term Blackman-Harris window, in bins, with a margin
+static const uint32_t k_lobe_bins = 5;
+static const uint32_t k_num_notes = k_midi_to_hz_size;
+static const double k_floor = 1e-20;
+
+/*===========================================================================*/
+/* Sources.                                                                  */
+/*===========================================================================*/
+
+enum {
+  k_prim_sin = 0,
+  k_prim_saw,
+  k_prim_bl_saw,
+  k_prim_bl2_saw,
+  k_prim_polyblep_saw,
+  k_prim_sqr,
+  k_prim_bl_sqr,
+  k_prim_bl2_sqr,
+  k_prim_par,
+  k_prim_bl_par,
+  k_prim_bl2_par,
+  k_num_prims
+};
+
+static const char *s_prim_names[k_num_prims] = {
+  "sin", "saw", "bl_saw", "bl2_saw", "polyblep_saw", "sqr", "bl_sqr", "bl2_sqr", "par", "bl_par", "bl2_par"
+};
+
+/* Naive sawtooth with a two sample polynomial correction at the discontinuity */
+static inline float polyblep_saw(float x, float w0) {
+  float y = 2.f * x - 1.f;
+  if (x < w0) {
+    const float t = x / w0;
+    y -= t + t - t * t - 1.f;
+  }
+  else if (x > 1.f - w0) {
+    const float t = (x - 1.f) / w0;
+    y -= t * t + t + t + 1.f;
+  }
+  return y;
+}
+
+#define PRIM_LOOP(expr)                         \
+  for (uint32_t i = 0; i < frames; ++i) {       \
+    const float x = phase;                      \
+    out[i] = (expr);                            \
+    phase += w0;                                \
+    phase -= (uint32_t)phase;                   \
+  }
+
+/* One block of a primitive, the switch kept out of the sample loop as in unit code */
+static float render_prim(uint32_t prim, float phase, float w0, float note, float *out, uint32_t frames) {
+  const float idx = osc_bl_saw_idx(note);
+  const uint8_t idx_u8 = (uint8_t)idx;
+  switch (prim) {
+  case k_prim_sin:          PRIM_LOOP(osc_sinf(x)); break;
+  case k_prim_saw:          PRIM_LOOP(osc_sawf(x)); break;
+  case k_prim_bl_saw:       PRIM_LOOP(osc_bl_sawf(x, idx_u8)); break;
+  case k_prim_bl2_saw:      PRIM_LOOP(osc_bl2_sawf(x, idx)); break;
+  case k_prim_polyblep_saw: PRIM_LOOP(polyblep_saw(x, w0)); break;
+  case k_prim_sqr:          PRIM_LOOP(osc_sqrf(x)); break;
+  case k_prim_bl_sqr:       PRIM_LOOP(osc_bl_sqrf(x, (uint8_t)osc_bl_sqr_idx(note))); break;
+  case k_prim_bl2_sqr:      PRIM_LOOP(osc_bl2_sqrf(x, osc_bl_sqr_idx(note))); break;
+  case k_prim_par:          PRIM_LOOP(osc_parf(x)); break;
+  case k_prim_bl_par:       PRIM_LOOP(osc_bl_parf(x, (uint8_t)osc_bl_par_idx(note))); break;
+  case k_prim_bl2_par:      PRIM_LOOP(osc_bl2_parf(x, osc_bl_par_idx(note))); break;
+  default: break;
+  }
+  return phase;
+}
+
+struct Source {
+  const char *name;
+  uint32_t prim;     // k_num_prims for units
+  unit_host_t unit;
+};
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* Render the settling frames then the analyzed ones of a note, return the host time spent per block */
+static double render_note(Source *src, uint8_t note, float *buf) {
+  const float w0 = osc_w0f_for_note(note, 0);
+  const uint32_t total = k_settle_frames + k_fft_size;
+  double ns = 0;
+  uint32_t blocks = 0;
+
+  if (src->prim < k_num_prims) {
+    float phase = 0.f;
+    float y[UNIT_HOST_MAX_FRAMES];
+    for (uint32_t pos = 0; pos < total; pos += UNIT_HOST_MAX_FRAMES) {
+      const double t0 = now_ns();
+      phase = render_prim(src->prim, phase, w0, note, y, UNIT_HOST_MAX_FRAMES);
+      ns += now_ns() - t0;
+      ++blocks;
+      if (pos >= k_settle_frames)
+        memcpy(buf + pos - k_settle_frames, y, sizeof(y));
+    }
+    return ns / blocks;
+  }
+
+  user_event_t on;
+  memset(&on, 0, sizeof(on));
+  on.type = k_user_event_note_on;
+  on.index = note;
+  on.value = 100;
+  unit_host_apply(&src->unit, &on);
+
+  int32_t y[UNIT_HOST_MAX_FRAMES];
+  const unit_host_io_t io = {y, NULL, NULL, NULL, NULL, NULL};
+  for (uint32_t pos = 0; pos < total; pos += UNIT_HOST_MAX_FRAMES) {
+    const double t0 = now_ns();
+    unit_host_render(&src->unit, &io, NULL, 0, UNIT_HOST_MAX_FRAMES);
+    ns += now_ns() - t0;
+    ++blocks;
+    if (pos >= k_settle_frames)
+      for (uint32_t i = 0; i < UNIT_HOST_MAX_FRAMES; ++i)
+        buf[pos - k_settle_frames + i] = y[i] * (1.f / 2147483648.f);
+  }
+  return ns / blocks;
+}
+
+/*===========================================================================*/
+/* Analysis.                                                                 */
+/*===========================================================================*/
+
+struct NoteMetrics {
+  double hz;
+  double level_db;
+  double alias_db;
+  double thd_db;
+  double dc;
+  double ns;
+};
+
+static void analyze(const float *x, double hz, NoteMetrics *m) {
+  static float twiddles[dsp::FFT::twiddlesSize(k_fft_size)];
+  static float window[k_fft_size];
+  static float buf[2 * k_fft_size];
+  static uint32_t owner[k_fft_size / 2 + 1];
+  static dsp::FFT fft;
+  static bool ready = false;
+  if (!ready) {
+    dsp::FFT::computeTwiddles(twiddles, k_fft_size);
+    fft.setTwiddles(twiddles, k_fft_size, k_fft_size);
+    for (uint32_t i = 0; i < k_fft_size; ++i) {
+      const double w = 2.0 * M_PI * i / k_fft_size;
+      window[i] = (float)(0.35875 - 0.48829 * cos(w) + 0.14128 * cos(2 * w) - 0.01168 * cos(3 * w));
+    }
+    ready = true;
+  }
+
+  // Windowed mean, a plain one is biased by the partial period at the end of the capture
+  double dc = 0, wsum = 0;
+  for (uint32_t i = 0; i < k_fft_size; ++i) {
+    dc += (double)x[i] * window[i];
+    wsum += window[i];
+    buf[2*i] = x[i] * window[i];
+    buf[2*i+1] = 0.f;
+  }
+  m->dc = dc / wsum;
+  fft.forward(buf);
+
+  // Bins owned by each harmonic below Nyquist, 0 for the rest, DC excluded
+  const uint32_t half = k_fft_size / 2;
+  const double bins_per_hz = (double)k_fft_size / UNIT_HOST_FS;
+  memset(owner, 0, sizeof(owner));
+  for (uint32_t h = 1; h * hz < UNIT_HOST_FS / 2; ++h) {
+    const int32_t c = (int32_t)lrint(h * hz * bins_per_hz);
+    for (int32_t k = c - (int32_t)k_lobe_bins; k <= c + (int32_t)k_lobe_bins; ++k)
+      if (k > (int32_t)k_lobe_bins && k <= (int32_t)half && owner[k] == 0)
+        owner[k] = h;
+  }
+
+  // Power normalized to a full scale sine, window gain of 0.35875
+  const double norm = 2.0 / ((double)k_fft_size * k_fft_size * 0.35875 * 0.35875 * 0.5);
+  double fund = 0, harm = 0, alias = 0;
+  for (uint32_t k = k_lobe_bins + 1; k <= half; ++k) {
+    const double p = ((double)buf[2*k] * buf[2*k] + (double)buf[2*k+1] * buf[2*k+1]) * norm;
+    if (owner[k] == 1)
+      fund += p;
+    else if (owner[k] > 1)
+      harm += p;
+    else
+      alias += p;
+  }
+
+  m->hz = hz;
+  m->level_db = 10 * log10(fund + k_floor);
+  m->alias_db = 10 * log10((alias + k_floor) / (fund + harm + alias + k_floor));
+  m->thd_db = 10 * log10((harm + k_floor) / (fund + k_floor));
+}
+
+/*===========================================================================*/
+/* Main.                                                                     */
+/*===========================================================================*/
+
+static void usage(const char *name) {
+  fprintf(stderr,
+          "usage: %s [options] [unit.so ...]\n"
+          "  -p prims    comma separated osc_api.h primitives, or all:\n"
+          "              sin, saw, bl_saw, bl2_saw, polyblep_saw, sqr, bl_sqr, bl2_sqr, par, bl_par, bl2_par\n"
+          "  -n step     note step of the sweep (default: 1)\n"
+          "  -S shape    units: shape in [0, 1] (default: 0)\n"
+          "  -T shift    units: shift-shape in [0, 1] (default: 0)\n"
+          "  -c          comma separated output, one line per note\n"
+          "  -q          summary only\n",
+          name);
+}
+
+static int parse_prims(char *list, Source *sources, uint32_t *count) {
+  for (char *tok = strtok(list, ","); tok != NULL; tok = strtok(NULL, ",")) {
+    uint32_t p = 0;
+    const bool all = (strcmp(tok, "all") == 0);
+    for (; p < k_num_prims; ++p) {
+      if (all || strcmp(tok, s_prim_names[p]) == 0) {
+        sources[*count].name = s_prim_names[p];
+        sources[*count].prim = p;
+        ++*count;
+        if (!all)
+          break;
+      }
+    }
+    if (!all && p == k_num_prims) {
+      fprintf(stderr, "unknown primitive %s\n", tok);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  static Source sources[64];
+  uint32_t count = 0;
+  uint32_t step = 1;
+  float shape = 0.f, shift = 0.f;
+  uint32_t csv = 0, quiet = 0;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "p:n:S:T:cqh")) != -1) {
+    switch (opt) {
+    case 'p':
+      if (parse_prims(optarg, sources, &count) != 0) {
+        usage(argv[0]);
+        return 1;
+      }
+      break;
+    case 'n': step = (uint32_t)atoi(optarg); break;
+    case 'S': shape = (float)atof(optarg); break;
+    case 'T': shift = (float)atof(optarg); break;
+    case 'c': csv = 1; break;
+    case 'q': quiet = 1; break;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  for (int i = optind; i < argc && count < sizeof(sources) / sizeof(sources[0]); ++i) {
+    Source *src = &sources[count];
+    src->name = argv[i];
+    src->prim = k_num_prims;
+    if (unit_host_open(&src->unit, argv[i], 0) != 0)
+      return 1;
+    if (unit_host_module(&src->unit) != k_user_module_osc) {
+      fprintf(stderr, "%s: not an oscillator unit\n", argv[i]);
+      return 1;
+    }
+    ++count;
+  }
+
+  if (count == 0 || step == 0) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  static float buf[k_fft_size];
+  NoteMetrics metrics[k_num_notes];
+
+  if (csv)
+    printf("source,note,hz,level_db,alias_db,thd_db,dc,ns_block\n");
+
+  for (uint32_t s = 0; s < count; ++s) {
+    Source *src = &sources[s];
+    if (src->prim == k_num_prims) {
+      api_host_seed(API_HOST_DEFAULT_SEED);
+      unit_host_init(&src->unit);
+      const user_event_t params[2] = {
+        {0, k_user_event_param, k_user_osc_param_shape, (int32_t)(shape * 1023.f)},
+        {0, k_user_event_param, k_user_osc_param_shiftshape, (int32_t)(shift * 1023.f)}
+      };
+      unit_host_apply(&src->unit, &params[0]);
+      unit_host_apply(&src->unit, &params[1]);
+    }
+
+    if (!csv && !quiet) {
+      printf("%s\n", src->name);
+      printf("  %4s %9s %9s %9s %9s %10s %9s\n", "note", "hz", "level dB", "alias dB", "THD dB", "dc", "ns/block");
+    }
+
+    uint32_t notes = 0;
+    double alias_sum = 0, ns_sum = 0, dc_max = 0;
+    double alias_worst = -1e9;
+    uint32_t worst_note = 0;
+    for (uint32_t note = 0; note < k_num_notes; note += step) {
+      NoteMetrics *m = &metrics[note];
+      m->ns = render_note(src, (uint8_t)note, buf);
+      analyze(buf, osc_w0f_for_note((uint8_t)note, 0) * UNIT_HOST_FS, m);
+
+      ++notes;
+      alias_sum += m->alias_db;
+      ns_sum += m->ns;
+      dc_max = (fabs(m->dc) > dc_max) ? fabs(m->dc) : dc_max;
+      if (m->alias_db > alias_worst) {
+        alias_worst = m->alias_db;
+        worst_note = note;
+      }
+
+      if (csv)
+        printf("%s,%u,%.3f,%.2f,%.2f,%.2f,%.6f,%.1f\n", src->name, (unsigned)note, m->hz, m->level_db, m->alias_db,
+               m->thd_db, m->dc, m->ns);
+      else if (!quiet)
+        printf("  %4u %9.2f %9.2f %9.2f %9.2f %10.6f %9.1f\n", (unsigned)note, m->hz, m->level_db, m->alias_db,
+               m->thd_db, m->dc, m->ns);
+    }
+
+    if (!csv)
+      printf("%s: alias %.1f dB mean, %.1f dB worst at note %u, |dc| %.6f max, %.1f ns/block\n", src->name,
+             alias_sum / notes, alias_worst, (unsigned)worst_note, dc_max, ns_sum / notes);
+  }
+
+  for (uint32_t s = 0; s < count; ++s)
+    if (sources[s].prim == k_num_prims)
+      unit_host_close(&sources[s].unit);
+  return 0;
+}
@@ -0,0 +1,131 @@
+/*
+ * File: prof_dump.c
+ *
+ * Decoder of the PROF_SCOPE sample ring of profile.h.
+ *
+ * Reads a memory dump of prof_ring, taken with a debugger from a unit running on target or written by unit_render -P,
+ * and reports min/mean/max ticks per scope over the samples still in the ring.
+ *
+ * 2018 (c) Korg
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <unistd.h>
+
+#include "profile.h"
+
+static void usage(const char *name) {
+  fprintf(stderr,
+          "usage: %s [options] ring.bin ...\n"
+          "  -c          comma separated output\n"
+          "  -z hz       tick rate, overrides the rate recorded in the ring\n",
+          name);
+}
+
+typedef struct scope_stats {
+  uint32_t count;
+  uint32_t min;
+  uint32_t max;
+  double sum;
+} scope_stats_t;
+
+static int dump(const char *path, uint32_t csv, uint32_t hz_override) {
+  FILE *fp = fopen(path, "rb");
+  if (fp == NULL) {
+    perror(path);
+    return -1;
+  }
+
+  // Header first, the capacity of the ring tells how many samples follow
+  prof_ring_t header;
+  const size_t header_size = offsetof(prof_ring_t, samples);
+  if (fread(&header, 1, header_size, fp) != header_size || header.magic != PROF_MAGIC) {
+    fprintf(stderr, "%s: not a profile ring, or no scope was reached\n", path);
+    fclose(fp);
+    return -1;
+  }
+  if (header.capacity == 0 || (header.capacity & (header.capacity - 1)) || header.scopes > PROF_MAX_SCOPES) {
+    fprintf(stderr, "%s: corrupt ring header\n", path);
+    fclose(fp);
+    return -1;
+  }
+
+  prof_sample_t *samples = (prof_sample_t *)malloc(header.capacity * sizeof(prof_sample_t));
+  const uint32_t kept = (header.head < header.capacity) ? header.head : header.capacity;
+  if (samples == NULL || fread(samples, sizeof(prof_sample_t), header.capacity, fp) < kept) {
+    fprintf(stderr, "%s: truncated ring\n", path);
+    free(samples);
+    fclose(fp);
+    return -1;
+  }
+  fclose(fp);
+
+  scope_stats_t stats[PROF_MAX_SCOPES];
+  memset(stats, 0, sizeof(stats));
+  for (uint32_t i = header.head - kept; i != header.head; ++i) {
+    const prof_sample_t *s = &samples[i & (header.capacity - 1)];
+    if (s->scope >= header.scopes)
+      continue;
+    scope_stats_t *st = &stats[s->scope];
+    st->min = (st->count == 0 || s->ticks < st->min) ? s->ticks : st->min;
+    st->max = (s->ticks > st->max) ? s->ticks : st->max;
+    st->sum += s->ticks;
+    ++st->count;
+  }
+  free(samples);
+
+  const uint32_t hz = hz_override ? hz_override : header.hz;
+  const double us = 1e6 / hz;
+
+  if (!csv) {
+    printf("%s: %u samples, %u kept, %u ticks/s\n", path, (unsigned)header.head, (unsigned)kept, (unsigned)hz);
+    printf("  %-16s %8s %10s %10s %10s %10s\n", "scope", "count", "min", "mean", "max", "max us");
+  }
+  for (uint32_t i = 0; i < header.scopes; ++i) {
+    const scope_stats_t *st = &stats[i];
+    char name[PROF_NAME_SIZE];
+    memcpy(name, header.names[i], PROF_NAME_SIZE);
+    name[PROF_NAME_SIZE - 1] = '\0';
+    const double mean = st->count ? st->sum / st->count : 0.0;
+    if (csv)
+      printf("%s,%s,%u,%u,%.1f,%u,%.3f\n", path, name, (unsigned)st->count, (unsigned)st->min, mean,
+             (unsigned)st->max, st->max * us);
+    else
+      printf("  %-16s %8u %10u %10.1f %10u %10.3f\n", name, (unsigned)st->count, (unsigned)st->min, mean,
+             (unsigned)st->max, st->max * us);
+  }
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  uint32_t csv = 0;
+  uint32_t hz = 0;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "cz:h")) != -1) {
+    switch (opt) {
+    case 'c': csv = 1; break;
+    case 'z': hz = (uint32_t)strtoul(optarg, NULL, 0); break;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  if (optind >= argc) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  if (csv)
+    printf("ring,scope,count,min,mean,max,max_us\n");
+  int ret = 0;
+  for (int i = optind; i < argc; ++i)
+    if (dump(argv[i], csv, hz) != 0)
+      ret = 1;
+  return ret;
+}
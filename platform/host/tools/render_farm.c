@@ -0,0 +1,410 @@
+/*
+ * File: render_farm.c
+ *
+ * Parallel render of the unit test matrix.
+ *
+ * Shards units x parameter sweeps into jobs run on all cores. Each worker owns a job queue and steals from the others
+ * when it runs dry, so that slow units (long delay lines, reverbs) do not leave cores idle at the end of the run.
+ * Units keep their state in globals, so every job renders a private instance of its unit (see unit_host_open_instance).
+ * Results are collected in one report, in job order regardless of scheduling, with an output hash for each job.
+ *
+ * 2018 (c) Korg
+ *
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <ftw.h>
+
+#include "api_host.h"
+#include "unit_host.h"
+#include "event_script.h"
+#include "render_job.h"
+
+#define FARM_MAX_THREADS (256)
+
+typedef struct knob {
+  const char *name;
+  uint8_t index;
+} knob_t;
+
+/* Swept parameters of each module, indexes as in userosc.h and usermodfx.h/userdelfx.h/userrevfx.h */
+static const knob_t s_osc_knobs[] = {{"shape", k_user_osc_param_shape}, {"shiftshape", k_user_osc_param_shiftshape}};
+static const knob_t s_modfx_knobs[] = {{"time", 0}, {"depth", 1}};
+static const knob_t s_fx_knobs[] = {{"time", 0}, {"depth", 1}, {"shift_depth", 3}};
+
+typedef struct farm_unit {
+  char *path;
+  uint32_t module;
+} farm_unit_t;
+
+typedef struct farm_job {
+  uint32_t unit;
+  /** Swept knob, in the knob list of the unit module */
+  uint32_t knob;
+  float value;
+  int status;
+  render_result_t result;
+  /** Time from unit load to render end */
+  double ns;
+} farm_job_t;
+
+/* Job indexes of one worker, the owner pops from the back and thieves take from the front */
+typedef struct farm_queue {
+  pthread_mutex_t lock;
+  uint32_t *jobs;
+  uint32_t head;
+  uint32_t tail;
+} farm_queue_t;
+
+typedef struct farm {
+  farm_unit_t *units;
+  uint32_t unit_count;
+  farm_job_t *jobs;
+  uint32_t job_count;
+  farm_queue_t *queues;
+  uint32_t threads;
+  uint32_t length;
+  uint32_t steals;
+  pthread_mutex_t steal_lock;
+} farm_t;
+
+typedef struct worker {
+  farm_t *farm;
+  uint32_t id;
+} worker_t;
+
+static farm_unit_t *s_scan_units;
+static uint32_t s_scan_count;
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void usage(const char *name) {
+  fprintf(stderr,
+          "usage: %s [options] [unit.so ...]\n"
+          "  -d dir      render all units found under dir when none are given (default: build/units)\n"
+          "  -j threads  worker threads (default: online cores)\n"
+          "  -n steps    parameter values swept per knob, at least 2 (default: 5)\n"
+          "  -l seconds  render length per job (default: 1)\n"
+          "  -c out.csv  write the per job report as CSV\n"
+          "  -q          print the summary only\n",
+          name);
+}
+
+static const knob_t *module_knobs(uint32_t module, uint32_t *count) {
+  switch (module) {
+  case k_user_module_osc:
+    *count = sizeof(s_osc_knobs) / sizeof(s_osc_knobs[0]);
+    return s_osc_knobs;
+  case k_user_module_modfx:
+    *count = sizeof(s_modfx_knobs) / sizeof(s_modfx_knobs[0]);
+    return s_modfx_knobs;
+  default:
+    *count = sizeof(s_fx_knobs) / sizeof(s_fx_knobs[0]);
+    return s_fx_knobs;
+  }
+}
+
+static int add_unit(farm_unit_t **units, uint32_t *count, const char *path) {
+  farm_unit_t *u = (farm_unit_t *)realloc(*units, (*count + 1) * sizeof(farm_unit_t));
+  if (u == NULL)
+    return -1;
+  *units = u;
+  u[*count].path = strdup(path);
+  u[*count].module = k_num_user_modules;
+  ++*count;
+  return 0;
+}
+
+static int scan_entry(const char *path, const struct stat *st, int flag, struct FTW *ftw) {
+  (void)st;
+  (void)ftw;
+  const size_t len = strlen(path);
+  if (flag == FTW_F && len > 3 && strcmp(path + len - 3, ".so") == 0)
+    return add_unit(&s_scan_units, &s_scan_count, path);
+  return 0;
+}
+
+static int compare_units(const void *a, const void *b) {
+  return strcmp(((const farm_unit_t *)a)->path, ((const farm_unit_t *)b)->path);
+}
+
+/* Knob values of a job: the swept knob at its value, the others centered */
+static int build_script(event_script_t *s, const farm_unit_t *unit, const farm_job_t *job, uint32_t length) {
+  uint32_t count;
+  const knob_t *knobs = module_knobs(unit->module, &count);
+  const uint32_t osc = (unit->module == k_user_module_osc);
+
+  for (uint32_t k = 0; k < count; ++k) {
+    const double x = (k == job->knob) ? job->value : 0.5;
+    const int32_t value = osc ? (int32_t)lrint(x * 1023.0) : (int32_t)lrint(x * 2147483647.0);
+    if (event_script_add(s, 0, k_user_event_param, knobs[k].index, value) != 0)
+      return -1;
+  }
+
+  if (osc && (event_script_add(s, 0, k_user_event_note_on, 60, 100) != 0
+              || event_script_add(s, length * 3 / 4, k_user_event_note_off, 60, 0) != 0))
+    return -1;
+
+  s->length = length;
+  return 0;
+}
+
+static void run_job(farm_t *farm, farm_job_t *job) {
+  const farm_unit_t *unit = &farm->units[job->unit];
+  const double t0 = now_ns();
+
+  unit_host_t u;
+  if (unit_host_open_instance(&u, unit->path, 0) != 0) {
+    job->status = -1;
+    return;
+  }
+
+  event_script_t script;
+  event_script_init(&script);
+
+  render_job_t rj;
+  render_job_init(&rj);
+  rj.script = &script;
+  rj.input.type = k_render_input_noise;
+
+  job->status = build_script(&script, unit, job, farm->length);
+  if (job->status == 0)
+    job->status = render_job_run(&u, &rj, &job->result);
+
+  event_script_free(&script);
+  unit_host_close(&u);
+  job->ns = now_ns() - t0;
+}
+
+static int pop_own(farm_queue_t *q, uint32_t *job) {
+  int ret = -1;
+  pthread_mutex_lock(&q->lock);
+  if (q->head < q->tail) {
+    *job = q->jobs[--q->tail];
+    ret = 0;
+  }
+  pthread_mutex_unlock(&q->lock);
+  return ret;
+}
+
+static int steal(farm_queue_t *q, uint32_t *job) {
+  int ret = -1;
+  pthread_mutex_lock(&q->lock);
+  if (q->head < q->tail) {
+    *job = q->jobs[q->head++];
+    ret = 0;
+  }
+  pthread_mutex_unlock(&q->lock);
+  return ret;
+}
+
+static void *worker_main(void *arg) {
+  const worker_t *w = (const worker_t *)arg;
+  farm_t *farm = w->farm;
+  uint32_t job = 0;
+
+  for (;;) {
+    if (pop_own(&farm->queues[w->id], &job) == 0) {
+      run_job(farm, &farm->jobs[job]);
+      continue;
+    }
+
+    // Queues only drain, so a full pass without a steal means the run is over
+    uint32_t i = 1;
+    for (; i < farm->threads; ++i)
+      if (steal(&farm->queues[(w->id + i) % farm->threads], &job) == 0)
+        break;
+    if (i == farm->threads)
+      break;
+
+    pthread_mutex_lock(&farm->steal_lock);
+    ++farm->steals;
+    pthread_mutex_unlock(&farm->steal_lock);
+    run_job(farm, &farm->jobs[job]);
+  }
+
+  return NULL;
+}
+
+static double db(double x) {
+  return 20 * log10(x + 1e-30);
+}
+
+int main(int argc, char **argv) {
+  const char *dir = "build/units";
+  const char *csv_path = NULL;
+  long threads = sysconf(_SC_NPROCESSORS_ONLN);
+  uint32_t steps = 5;
+  double seconds = 1.0;
+  uint32_t quiet = 0;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "d:j:n:l:c:qh")) != -1) {
+    switch (opt) {
+    case 'd': dir = optarg; break;
+    case 'j': threads = atol(optarg); break;
+    case 'n': steps = (uint32_t)atoi(optarg); break;
+    case 'l': seconds = atof(optarg); break;
+    case 'c': csv_path = optarg; break;
+    case 'q': quiet = 1; break;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  if (threads < 1 || threads > FARM_MAX_THREADS || steps < 2 || seconds <= 0) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  farm_t farm;
+  memset(&farm, 0, sizeof(farm));
+  farm.threads = (uint32_t)threads;
+  farm.length = (uint32_t)(seconds * UNIT_HOST_FS);
+  pthread_mutex_init(&farm.steal_lock, NULL);
+
+  for (int i = optind; i < argc; ++i)
+    if (add_unit(&farm.units, &farm.unit_count, argv[i]) != 0)
+      return 1;
+  if (farm.unit_count == 0) {
+    if (nftw(dir, scan_entry, 16, FTW_PHYS) != 0) {
+      perror(dir);
+      return 1;
+    }
+    farm.units = s_scan_units;
+    farm.unit_count = s_scan_count;
+    qsort(farm.units, farm.unit_count, sizeof(farm_unit_t), compare_units);
+  }
+  if (farm.unit_count == 0) {
+    fprintf(stderr, "%s: no units\n", dir);
+    return 1;
+  }
+
+  // Module of each unit, for its knobs
+  for (uint32_t i = 0; i < farm.unit_count; ++i) {
+    unit_host_t u;
+    if (unit_host_open(&u, farm.units[i].path, 0) != 0)
+      return 1;
+    farm.units[i].module = unit_host_module(&u);
+    unit_host_close(&u);
+  }
+
+  for (uint32_t i = 0; i < farm.unit_count; ++i) {
+    uint32_t count;
+    module_knobs(farm.units[i].module, &count);
+    farm.job_count += count * steps;
+  }
+
+  farm.jobs = (farm_job_t *)calloc(farm.job_count, sizeof(farm_job_t));
+  farm.queues = (farm_queue_t *)calloc(farm.threads, sizeof(farm_queue_t));
+  if (farm.jobs == NULL || farm.queues == NULL)
+    return 1;
+
+  uint32_t n = 0;
+  for (uint32_t i = 0; i < farm.unit_count; ++i) {
+    uint32_t count;
+    module_knobs(farm.units[i].module, &count);
+    for (uint32_t k = 0; k < count; ++k)
+      for (uint32_t s = 0; s < steps; ++s, ++n) {
+        farm.jobs[n].unit = i;
+        farm.jobs[n].knob = k;
+        farm.jobs[n].value = (float)s / (steps - 1);
+      }
+  }
+
+  // Jobs of a unit are dealt round robin, spreading its cost over all workers
+  for (uint32_t t = 0; t < farm.threads; ++t) {
+    farm_queue_t *q = &farm.queues[t];
+    pthread_mutex_init(&q->lock, NULL);
+    q->jobs = (uint32_t *)malloc((farm.job_count / farm.threads + 1) * sizeof(uint32_t));
+    if (q->jobs == NULL)
+      return 1;
+    for (uint32_t j = t; j < farm.job_count; j += farm.threads)
+      q->jobs[q->tail++] = j;
+  }
+
+  worker_t workers[FARM_MAX_THREADS];
+  pthread_t tids[FARM_MAX_THREADS];
+  const double t0 = now_ns();
+  for (uint32_t t = 0; t < farm.threads; ++t) {
+    workers[t].farm = &farm;
+    workers[t].id = t;
+    if (pthread_create(&tids[t], NULL, worker_main, &workers[t]) != 0) {
+      fprintf(stderr, "cannot start worker %u\n", (unsigned)t);
+      return 1;
+    }
+  }
+  for (uint32_t t = 0; t < farm.threads; ++t)
+    pthread_join(tids[t], NULL);
+  const double wall_ns = now_ns() - t0;
+
+  FILE *csv = NULL;
+  if (csv_path != NULL) {
+    csv = fopen(csv_path, "w");
+    if (csv == NULL) {
+      perror(csv_path);
+      return 1;
+    }
+    fprintf(csv, "unit,module,knob,value,status,peak_dbfs,rms_dbfs,ns_block_mean,ns_block_max,nonfinite,hash\n");
+  }
+
+  uint32_t failed = 0, nonfinite = 0;
+  double cpu_ns = 0;
+  for (uint32_t j = 0; j < farm.job_count; ++j) {
+    const farm_job_t *job = &farm.jobs[j];
+    const farm_unit_t *unit = &farm.units[job->unit];
+    const render_result_t *r = &job->result;
+    uint32_t count;
+    const knob_t *knob = &module_knobs(unit->module, &count)[job->knob];
+    const double mean_ns = r->blocks ? r->total_ns / r->blocks : 0.0;
+
+    failed += (job->status != 0);
+    nonfinite += (r->nonfinite != 0);
+    cpu_ns += job->ns;
+
+    if (!quiet || job->status != 0 || r->nonfinite)
+      printf("%-48s %-11s %.3f %s peak %7.2f dBFS rms %7.2f dBFS %8.0f/%8.0f ns/block %016llx%s\n",
+             unit->path, knob->name, job->value, unit_host_module_name(unit->module),
+             db(r->peak), db(r->rms), mean_ns, r->max_ns, (unsigned long long)r->hash,
+             (job->status != 0) ? " FAILED" : r->nonfinite ? " NONFINITE" : "");
+    if (csv != NULL)
+      fprintf(csv, "%s,%s,%s,%.6f,%d,%.2f,%.2f,%.0f,%.0f,%u,%016llx\n",
+              unit->path, unit_host_module_name(unit->module), knob->name, job->value, job->status,
+              db(r->peak), db(r->rms), mean_ns, r->max_ns, (unsigned)r->nonfinite, (unsigned long long)r->hash);
+  }
+
+  if (csv != NULL && fclose(csv) != 0) {
+    perror(csv_path);
+    return 1;
+  }
+
+  printf("%u units, %u jobs of %u frames on %u threads: %u failed, %u with non-finite output\n",
+         (unsigned)farm.unit_count, (unsigned)farm.job_count, (unsigned)farm.length, (unsigned)farm.threads,
+         (unsigned)failed, (unsigned)nonfinite);
+  printf("  %.2f s job time, %.2f s wall time, %.2f jobs in flight on average, %u jobs stolen\n",
+         cpu_ns * 1e-9, wall_ns * 1e-9, cpu_ns / wall_ns, (unsigned)farm.steals);
+
+  for (uint32_t t = 0; t < farm.threads; ++t) {
+    pthread_mutex_destroy(&farm.queues[t].lock);
+    free(farm.queues[t].jobs);
+  }
+  for (uint32_t i = 0; i < farm.unit_count; ++i)
+    free(farm.units[i].path);
+  free(farm.queues);
+  free(farm.jobs);
+  free(farm.units);
+  return (failed || nonfinite) ? 1 : 0;
+}
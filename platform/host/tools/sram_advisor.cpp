@@ -0,0 +1,406 @@
+/*
+ * File: sram_advisor.cpp
+ *
+ * SRAM or SDRAM placement of the data of effect units, from the accesses of a representative render.
+ *
+ * The unit is built with MEMTRACE=1 (see mem_trace.h), and its zero-initialized objects are read from the symbol table
+ * of the shared object. Only these can be moved between the fast SRAM of the unit and the NOLOAD .sdram section.
+ * Loads and stores of the unit code are counted per object while rendering, the init hook excepted. The objects kept in
+ * SRAM are those that avoid the most SDRAM accesses within the given SRAM budget, a 0/1 knapsack over 4 byte words.
+ *
+ * The recommendation can be written as a header of section attributes, to be used in the unit as
+ *   static float s_delay_ram[LEN] __place(s_delay_ram);
+ *
+ * 2018 (c) Korg
+ *
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dlfcn.h>
+#include <link.h>
+#include <elf.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <cxxabi.h>
+
+#include <algorithm>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "api_host.h"
+#include "unit_host.h"
+#include "event_script.h"
+#include "render_job.h"
+#include "mem_trace.h"
+
+struct Object {
+  std::string name;   // demangled
+  std::string id;     // identifier of the __place() macro
+  uintptr_t addr;     // load address once the unit is open, link address before
+  uint32_t size;
+  bool sdram;
+  uint64_t loads;
+  uint64_t stores;
+  bool keep;          // recommended for SRAM
+
+  uint64_t accesses() const { return loads + stores; }
+};
+
+static std::vector<Object> s_objects;
+static uintptr_t s_lo, s_hi;
+
+static std::string demangle(const char *symbol) {
+  int status = 0;
+  char *d = abi::__cxa_demangle(symbol, NULL, NULL, &status);
+  if (d == NULL || status != 0)
+    return symbol;
+  const std::string s(d);
+  free(d);
+  return s;
+}
+
+/* Identifier from a symbol: "dsp::s_taps" -> "dsp_s_taps", function statics "s_buf.3" -> "s_buf" */
+static std::string identifier(const std::string &name) {
+  std::string id;
+  for (size_t i = 0; i < name.size(); ++i) {
+    const char c = name[i];
+    if (c == '.')
+      break;
+    if (c == ':') {
+      if (i + 1 < name.size() && name[i + 1] == ':')
+        ++i;
+      id += '_';
+    }
+    else
+      id += (isalnum((unsigned char)c) || c == '_') ? c : '_';
+  }
+  return id;
+}
+
+/* Zero-initialized objects of the unit, from the ELF symbol table */
+static int load_objects(const char *path) {
+  const int fd = open(path, O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0) {
+    perror(path);
+    if (fd >= 0)
+      close(fd);
+    return -1;
+  }
+  void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    perror(path);
+    return -1;
+  }
+
+  const uint8_t *base = (const uint8_t *)map;
+  const Elf64_Ehdr *eh = (const Elf64_Ehdr *)base;
+  if ((size_t)st.st_size < sizeof(*eh) || memcmp(eh->e_ident, ELFMAG, SELFMAG) != 0 || eh->e_ident[EI_CLASS] != ELFCLASS64) {
+    fprintf(stderr, "%s: not a 64-bit ELF shared object\n", path);
+    munmap(map, st.st_size);
+    return -1;
+  }
+  const Elf64_Shdr *sh = (const Elf64_Shdr *)(base + eh->e_shoff);
+  const char *shstr = (const char *)(base + sh[eh->e_shstrndx].sh_offset);
+
+  for (uint32_t s = 0; s < eh->e_shnum; ++s) {
+    if (sh[s].sh_type != SHT_SYMTAB)
+      continue;
+    const Elf64_Sym *syms = (const Elf64_Sym *)(base + sh[s].sh_offset);
+    const char *str = (const char *)(base + sh[sh[s].sh_link].sh_offset);
+    const uint32_t count = (uint32_t)(sh[s].sh_size / sizeof(Elf64_Sym));
+    bool crt = false;
+    for (uint32_t i = 0; i < count; ++i) {
+      const Elf64_Sym &sym = syms[i];
+      const char *name = str + sym.st_name;
+      // Locals follow the file symbol of their source, skip those of the C runtime
+      if (ELF64_ST_TYPE(sym.st_info) == STT_FILE) {
+        crt = strncmp(name, "crt", 3) == 0;
+        continue;
+      }
+      if (ELF64_ST_TYPE(sym.st_info) != STT_OBJECT || sym.st_size == 0 || sym.st_shndx == SHN_UNDEF
+          || sym.st_shndx >= eh->e_shnum || (crt && ELF64_ST_BIND(sym.st_info) == STB_LOCAL))
+        continue;
+      if (strncmp(name, "_ZGV", 4) == 0 || strncmp(name, "__", 2) == 0)
+        continue;
+      const char *section = shstr + sh[sym.st_shndx].sh_name;
+      const bool sdram = strcmp(section, ".sdram") == 0;
+      if (!sdram && strcmp(section, ".bss") != 0)
+        continue;
+      Object o;
+      o.name = demangle(name);
+      o.id = identifier(o.name);
+      o.addr = sym.st_value;
+      o.size = (uint32_t)sym.st_size;
+      o.sdram = sdram;
+      o.loads = o.stores = 0;
+      o.keep = false;
+      s_objects.push_back(o);
+    }
+  }
+  munmap(map, st.st_size);
+  return 0;
+}
+
+static bool by_addr(const Object &a, const Object &b) { return a.addr < b.addr; }
+static bool by_accesses(const Object &a, const Object &b) {
+  return (a.accesses() != b.accesses()) ? a.accesses() > b.accesses() : a.size < b.size;
+}
+
+static void count_access(void *, uintptr_t addr, uint32_t, uint32_t store) {
+  if (addr < s_lo || addr >= s_hi)
+    return;
+  // Last object starting at or before addr
+  size_t lo = 0, hi = s_objects.size();
+  while (hi - lo > 1) {
+    const size_t mid = (lo + hi) / 2;
+    if (s_objects[mid].addr <= addr)
+      lo = mid;
+    else
+      hi = mid;
+  }
+  Object &o = s_objects[lo];
+  if (addr >= o.addr && addr < o.addr + o.size) {
+    if (store)
+      ++o.stores;
+    else
+      ++o.loads;
+  }
+}
+
+/* Accesses of the init hook are not representative, counting starts once it returns */
+static void (*s_init)(uint32_t platform, uint32_t api);
+
+static void traced_init(uint32_t platform, uint32_t api) {
+  s_init(platform, api);
+  for (size_t i = 0; i < s_objects.size(); ++i)
+    s_objects[i].loads = s_objects[i].stores = 0;
+}
+
+/*
+ * Objects kept in SRAM: most accesses within budget bytes, in 4 byte words. Objects the render did not access stay
+ * where they are, e.g. state of the param hook when the script has no param events.
+ */
+static void place(uint32_t budget) {
+  uint32_t words = budget / 4;
+  const size_t n = s_objects.size();
+  for (size_t i = 0; i < n; ++i) {
+    const uint32_t w = (s_objects[i].size + 3) / 4;
+    if (s_objects[i].accesses() == 0 && !s_objects[i].sdram) {
+      s_objects[i].keep = true;
+      words = (w < words) ? words - w : 0;
+    }
+  }
+  std::vector<uint64_t> best(words + 1, 0);
+  std::vector<std::vector<bool> > take(n, std::vector<bool>(words + 1, false));
+  for (size_t i = 0; i < n; ++i) {
+    const uint32_t w = (s_objects[i].size + 3) / 4;
+    const uint64_t v = s_objects[i].accesses();
+    if (v == 0 || w > words)
+      continue;
+    for (uint32_t c = words; c >= w; --c)
+      if (best[c - w] + v > best[c]) {
+        best[c] = best[c - w] + v;
+        take[i][c] = true;
+      }
+  }
+  uint32_t c = words;
+  for (size_t i = n; i-- > 0; )
+    if (take[i][c]) {
+      s_objects[i].keep = true;
+      c -= (s_objects[i].size + 3) / 4;
+    }
+}
+
+static int write_header(const char *path, const char *unit, uint32_t budget) {
+  FILE *fp = fopen(path, "w");
+  if (fp == NULL) {
+    perror(path);
+    return -1;
+  }
+  const char *file = strrchr(path, '/');
+  file = (file != NULL) ? file + 1 : path;
+  std::string guard = "__";
+  for (const char *c = file; *c != '\0'; ++c)
+    guard += isalnum((unsigned char)*c) ? *c : '_';
+  const char *name = strrchr(unit, '/');
+
+  fprintf(fp, "/*\n * File: %s\n *\n", file);
+  fprintf(fp, " * Generated by sram_advisor from a render of %s, with %u bytes of SRAM for data.\n",
+          (name != NULL) ? name + 1 : unit, (unsigned)budget);
+  fprintf(fp, " * Objects are kept in SRAM by default, __sdram ones are moved to SDRAM.\n *\n */\n\n");
+  fprintf(fp, "#ifndef %s\n#define %s\n\n", guard.c_str(), guard.c_str());
+  fprintf(fp, "#define __place(name) __place_##name\n\n");
+  std::set<std::string> ids;
+  for (size_t i = 0; i < s_objects.size(); ++i) {
+    const Object &o = s_objects[i];
+    // Function statics of the same name, the most accessed one decides
+    if (!ids.insert(o.id).second)
+      continue;
+    fprintf(fp, "/* %s: %u bytes, %llu accesses */\n", o.name.c_str(), (unsigned)o.size,
+            (unsigned long long)o.accesses());
+    if (o.keep)
+      fprintf(fp, "#define __place_%s\n", o.id.c_str());
+    else
+      fprintf(fp, "#define __place_%s __attribute__((section(\".sdram\")))\n", o.id.c_str());
+  }
+  fprintf(fp, "\n#endif // %s\n", guard.c_str());
+  fclose(fp);
+  return 0;
+}
+
+static void usage(const char *name) {
+  fprintf(stderr,
+          "usage: %s [options] unit.so\n"
+          "  unit built with MEMTRACE=1, an effect\n"
+          "  -b bytes    SRAM available for data (default: SRAM of the module)\n"
+          "  -e script   event script\n"
+          "  -i input    silence, impulse, noise or sine (default: noise)\n"
+          "  -l seconds  render length when the script has no end event (default: 4)\n"
+          "  -w states   SDRAM wait states per access (default: 6)\n"
+          "  -o file.h   write the placement as a header of section attributes\n",
+          name);
+}
+
+int main(int argc, char **argv) {
+  int32_t budget = -1;
+  const char *script_path = NULL;
+  const char *header = NULL;
+  uint32_t input = k_render_input_noise;
+  float seconds = 4.f;
+  uint32_t wait_states = 6;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "b:e:i:l:w:o:h")) != -1) {
+    switch (opt) {
+    case 'b': budget = atoi(optarg); break;
+    case 'e': script_path = optarg; break;
+    case 'i':
+      for (input = 0; input < k_render_input_buffer; ++input)
+        if (strcmp(optarg, render_input_name(input)) == 0)
+          break;
+      if (input == k_render_input_buffer) {
+        usage(argv[0]);
+        return 1;
+      }
+      break;
+    case 'l': seconds = (float)atof(optarg); break;
+    case 'w': wait_states = (uint32_t)atoi(optarg); break;
+    case 'o': header = optarg; break;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if (optind != argc - 1) {
+    usage(argv[0]);
+    return 1;
+  }
+  const char *path = argv[optind];
+
+  if (load_objects(path) != 0)
+    return 1;
+
+  unit_host_t u;
+  if (unit_host_open(&u, path, 0) != 0)
+    return 1;
+  const uint32_t module = unit_host_module(&u);
+  if (module == k_user_module_osc) {
+    fprintf(stderr, "%s: oscillators have no SDRAM\n", path);
+    unit_host_close(&u);
+    return 1;
+  }
+  if (budget < 0)
+    budget = (module == k_user_module_modfx) ? 6 * 1024 : 12 * 1024;
+
+  struct link_map *map = NULL;
+  if (dlinfo(u.handle, RTLD_DI_LINKMAP, &map) != 0 || map == NULL) {
+    fprintf(stderr, "%s: %s\n", path, dlerror());
+    unit_host_close(&u);
+    return 1;
+  }
+  if (s_objects.empty()) {
+    fprintf(stderr, "%s: no zero-initialized objects\n", path);
+    unit_host_close(&u);
+    return 1;
+  }
+  for (size_t i = 0; i < s_objects.size(); ++i)
+    s_objects[i].addr += map->l_addr;
+  std::sort(s_objects.begin(), s_objects.end(), by_addr);
+  s_lo = s_objects.front().addr;
+  s_hi = s_objects.back().addr + s_objects.back().size;
+
+  event_script_t script;
+  event_script_init(&script);
+  if (script_path != NULL && event_script_load(&script, script_path, module) != 0) {
+    unit_host_close(&u);
+    return 1;
+  }
+
+  render_job_t job;
+  render_job_init(&job);
+  job.script = (script_path != NULL) ? &script : NULL;
+  job.length = (script_path != NULL && script.length) ? 0 : (uint32_t)(seconds * 48000.f);
+  job.input.type = input;
+
+  s_init = u.init;
+  if (s_init != NULL)
+    u.init = traced_init;
+  render_result_t r;
+  mem_trace_set(count_access, NULL);
+  const int status = render_job_run(&u, &job, &r);
+  mem_trace_set(NULL, NULL);
+  event_script_free(&script);
+  unit_host_close(&u);
+  if (status != 0) {
+    fprintf(stderr, "%s: nothing to render\n", path);
+    return 1;
+  }
+
+  uint64_t total = 0;
+  for (size_t i = 0; i < s_objects.size(); ++i)
+    total += s_objects[i].accesses();
+  if (total == 0) {
+    fprintf(stderr, "%s: no traced accesses, unit not built with MEMTRACE=1?\n", path);
+    return 1;
+  }
+
+  place((uint32_t)budget);
+  std::sort(s_objects.begin(), s_objects.end(), by_accesses);
+
+  printf("%s: %u blocks, %llu accesses to %u objects, %d bytes of SRAM for data\n", path, (unsigned)r.blocks,
+         (unsigned long long)total, (unsigned)s_objects.size(), (int)budget);
+  printf("  %-32s %8s %12s %12s %9s  %-6s %s\n", "object", "bytes", "loads", "stores", "per byte", "now", "advice");
+  uint64_t sdram_now = 0, sdram_advised = 0;
+  uint32_t sram_bytes = 0;
+  for (size_t i = 0; i < s_objects.size(); ++i) {
+    const Object &o = s_objects[i];
+    printf("  %-32s %8u %12llu %12llu %9.1f  %-6s %s\n", o.name.c_str(), (unsigned)o.size,
+           (unsigned long long)o.loads, (unsigned long long)o.stores, (double)o.accesses() / o.size,
+           o.sdram ? "sdram" : "sram", (o.accesses() == 0) ? "-" : o.keep ? "sram" : "sdram");
+    sdram_now += o.sdram ? o.accesses() : 0;
+    sdram_advised += o.keep ? 0 : o.accesses();
+    sram_bytes += o.keep ? (o.size + 3) & ~3U : 0;
+  }
+  const double blocks = r.blocks ? (double)r.blocks : 1.0;
+  printf("  SDRAM accesses per block: %.0f now, %.0f advised, about %.0f cycles of wait states per block saved\n",
+         sdram_now / blocks, sdram_advised / blocks, ((double)sdram_now - (double)sdram_advised) * wait_states / blocks);
+  printf("  %u of %d bytes of SRAM used by the advised placement, unaccessed objects (-) stay where they are\n",
+         (unsigned)sram_bytes, (int)budget);
+
+  if (header != NULL && write_header(header, path, (uint32_t)budget) != 0)
+    return 1;
+  return 0;
+}
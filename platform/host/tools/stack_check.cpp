@@ -0,0 +1,479 @@
+/*
+ * File: stack_check.cpp
+ *
+ * Worst-case stack depth of unit hooks, from the -fstack-usage output of the SDK build and the call graph of its .list
+ * disassembly (objdump -S).
+ *
+ * Frame sizes come from the .su files written next to the objects, and are matched to the functions of the listing by
+ * their demangled names. The .su files name template instances by their template and bindings, which are expanded
+ * first; instances still not matched, such as those with enum arguments, get the largest frame of their template.
+ * Calls are taken from bl/blx instructions and from branches to other functions (tail calls).
+ * The depth of each _hook_* function is its frame plus the deepest chain of its callees. Firmware API functions are
+ * outside the listing and get an assumed frame. Functions of the listing without .su data, library code or names that
+ * could not be matched, get the same assumed frame but leave the depth unbounded, as do indirect calls, recursion and
+ * dynamic frames.
+ *
+ * Loads and stores relative to sp are counted per function along the chain: in hooks and the DSP code they call,
+ * these are mostly register spills, which also cost cycles in the sample loops.
+ *
+ * 2018 (c) Korg
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <cxxabi.h>
+
+#include <map>
+#include <set>
+#include <string>
+
+struct Function {
+  std::string symbol;
+  std::string name;   // qualified name without parameters, key into the .su data
+  std::string generic;   // same without template arguments
+  std::set<std::string> callees;
+  bool indirect;
+  uint32_t sp_accesses;
+  // Frame from the .su data, -1 when there is none
+  long frame;
+  bool dynamic;
+  // Depth of the deepest chain, -1 while being computed
+  long depth;
+  std::string next;   // callee on the deepest chain
+  bool unbounded;
+};
+
+static std::map<std::string, Function> s_funcs;
+
+/* Frame size and qualifier per qualified function name, largest of overloads */
+struct Frame {
+  long bytes;
+  bool dynamic;
+};
+static std::map<std::string, Frame> s_frames;
+static std::map<std::string, Frame> s_generic_frames;
+
+/* Qualified name from a declaration, "void dsp::Foo<4>::bar(float*)" or "dsp::Foo<4>::bar(float*)" -> "dsp::Foo<4>::bar" */
+static std::string qualified_name(const std::string &decl) {
+  int angle = 0;
+  size_t start = 0, end = decl.size();
+  for (size_t i = 0; i < decl.size(); ++i) {
+    const char c = decl[i];
+    if (decl.compare(i, 21, "(anonymous namespace)") == 0) {
+      i += 20;
+      continue;
+    }
+    if (c == '<')
+      ++angle;
+    else if (c == '>')
+      --angle;
+    else if (c == '(' && angle == 0 && i > 0) {
+      // "operator()" keeps its parentheses
+      if (decl.compare(i >= 8 ? i - 8 : 0, 8, "operator") == 0 && decl.compare(i, 2, "()") == 0) {
+        ++i;
+        continue;
+      }
+      end = i;
+      break;
+    }
+    else if (c == ' ' && angle == 0)
+      start = i + 1;
+  }
+  return decl.substr(start, end - start);
+}
+
+static bool is_ident(const char c) {
+  return c == '_' || (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+/* Template arguments as the .su files write them: "dsp::Foo<4u, true>::bar" -> "dsp::Foo<4, true>::bar" */
+static std::string strip_literal_suffixes(const std::string &name) {
+  std::string s;
+  for (size_t i = 0; i < name.size(); ++i) {
+    s += name[i];
+    if (name[i] >= '0' && name[i] <= '9' && (s.size() == 1 || !is_ident(s[s.size() - 2]))) {
+      while (i + 1 < name.size() && name[i + 1] >= '0' && name[i + 1] <= '9')
+        s += name[++i];
+      while (i + 1 < name.size() && (name[i + 1] == 'u' || name[i + 1] == 'l'))
+        ++i;
+    }
+  }
+  return s;
+}
+
+/* Name without template arguments: "dsp::Foo<4, float>::bar" -> "dsp::Foo::bar" */
+static std::string generic_name(const std::string &name) {
+  std::string s;
+  int angle = 0;
+  for (size_t i = 0; i < name.size(); ++i) {
+    if (name[i] == '<')
+      ++angle;
+    else if (name[i] == '>')
+      --angle;
+    else if (angle == 0)
+      s += name[i];
+  }
+  return s;
+}
+
+/* Template parameters replaced by the bindings of a .su declaration:
+ * "dsp::Foo<N, T>::bar" with "unsigned int N = 4; T = float" -> "dsp::Foo<4, float>::bar" */
+static std::string bind_template(const std::string &name, const std::string &bindings) {
+  std::map<std::string, std::string> values;
+  int angle = 0;
+  size_t start = 0;
+  for (size_t i = 0; i <= bindings.size(); ++i) {
+    if (i < bindings.size() && bindings[i] == '<')
+      ++angle;
+    else if (i < bindings.size() && bindings[i] == '>')
+      --angle;
+    else if (i == bindings.size() || (bindings[i] == ';' && angle == 0)) {
+      const std::string binding = bindings.substr(start, i - start);
+      const size_t eq = binding.find(" = ");
+      if (eq != std::string::npos) {
+        size_t p = eq;
+        while (p > 0 && is_ident(binding[p - 1]))
+          --p;
+        values[binding.substr(p, eq - p)] = binding.substr(eq + 3);
+      }
+      start = i + 1;
+      while (start < bindings.size() && bindings[start] == ' ')
+        ++start;
+    }
+  }
+
+  std::string s;
+  angle = 0;
+  for (size_t i = 0; i < name.size(); ) {
+    if (name[i] == '<' || name[i] == '>') {
+      angle += (name[i] == '<') ? 1 : -1;
+      s += name[i++];
+      continue;
+    }
+    if (!is_ident(name[i])) {
+      s += name[i++];
+      continue;
+    }
+    size_t j = i;
+    while (j < name.size() && is_ident(name[j]))
+      ++j;
+    const std::string ident = name.substr(i, j - i);
+    std::map<std::string, std::string>::const_iterator v = values.find(ident);
+    s += (angle > 0 && v != values.end()) ? v->second : ident;
+    i = j;
+  }
+  return s;
+}
+
+static void add_frame(std::map<std::string, Frame> &frames, const std::string &name, const long bytes,
+                      const bool dynamic) {
+  std::map<std::string, Frame>::iterator it = frames.find(name);
+  if (it == frames.end()) {
+    Frame f = {bytes, dynamic};
+    frames[name] = f;
+  }
+  else {
+    it->second.bytes = (bytes > it->second.bytes) ? bytes : it->second.bytes;
+    it->second.dynamic = it->second.dynamic || dynamic;
+  }
+}
+
+static std::string demangle(const std::string &symbol) {
+  int status = 0;
+  char *d = abi::__cxa_demangle(symbol.c_str(), NULL, NULL, &status);
+  if (d == NULL || status != 0)
+    return symbol;
+  const std::string s(d);
+  free(d);
+  return s;
+}
+
+/* .su line: "file.cpp:12:6:void dsp::Foo<N>::bar(float*) [with int N = 4]\t24\tstatic" */
+static int load_su(const char *path) {
+  FILE *fp = fopen(path, "r");
+  if (fp == NULL) {
+    perror(path);
+    return -1;
+  }
+  char line[2048];
+  while (fgets(line, sizeof(line), fp) != NULL) {
+    line[strcspn(line, "\r\n")] = '\0';
+    char *tab = strchr(line, '\t');
+    if (tab == NULL)
+      continue;
+    *tab = '\0';
+    const long bytes = strtol(tab + 1, NULL, 10);
+    char *qualifier = strchr(tab + 1, '\t');
+    const bool dynamic = qualifier != NULL && strstr(qualifier, "dynamic") != NULL
+      && strstr(qualifier, "bounded") == NULL;
+
+    // Skip "file:line:column:"
+    char *decl = line;
+    for (int i = 0; i < 3 && decl != NULL; ++i) {
+      decl = strchr(decl, ':');
+      if (decl != NULL)
+        ++decl;
+    }
+    if (decl == NULL)
+      continue;
+
+    // Same spelling of anonymous namespaces as the demangler
+    std::string d(decl);
+    for (size_t p = d.find("{anonymous}"); p != std::string::npos; p = d.find("{anonymous}", p))
+      d.replace(p, 11, "(anonymous namespace)");
+
+    std::string name;
+    const size_t with = d.rfind(" [with ");
+    if (with != std::string::npos && d[d.size() - 1] == ']')
+      name = bind_template(qualified_name(d.substr(0, with)), d.substr(with + 7, d.size() - with - 8));
+    else
+      name = qualified_name(d);
+    add_frame(s_frames, name, bytes, dynamic);
+    add_frame(s_generic_frames, generic_name(name), bytes, dynamic);
+  }
+  fclose(fp);
+  return 0;
+}
+
+/* .su files given directly or found in given directories */
+static int load_su_path(const char *path) {
+  const size_t n = strlen(path);
+  if (n > 3 && strcmp(path + n - 3, ".su") == 0)
+    return load_su(path);
+
+  DIR *dir = opendir(path);
+  if (dir == NULL) {
+    perror(path);
+    return -1;
+  }
+  int ret = 0;
+  for (struct dirent *e = readdir(dir); e != NULL; e = readdir(dir)) {
+    const size_t len = strlen(e->d_name);
+    if (len > 3 && strcmp(e->d_name + len - 3, ".su") == 0) {
+      const std::string file = std::string(path) + "/" + e->d_name;
+      if (load_su(file.c_str()) != 0)
+        ret = -1;
+    }
+  }
+  closedir(dir);
+  return ret;
+}
+
+/* Symbol between angle brackets of an operand: "20000100 <_ZN3dsp3FooEv>" or "<f+0x1c>" */
+static std::string operand_symbol(const char *args) {
+  const char *lt = strchr(args, '<');
+  const char *gt = (lt != NULL) ? strrchr(lt, '>') : NULL;
+  if (lt == NULL || gt == NULL)
+    return "";
+  std::string s(lt + 1, gt - lt - 1);
+  const size_t plus = s.find('+');
+  if (plus != std::string::npos)
+    s.erase(plus);
+  return s;
+}
+
+static int load_listing(const char *path) {
+  FILE *fp = fopen(path, "r");
+  if (fp == NULL) {
+    perror(path);
+    return -1;
+  }
+  char line[2048];
+  Function *f = NULL;
+  while (fgets(line, sizeof(line), fp) != NULL) {
+    line[strcspn(line, "\r\n")] = '\0';
+
+    unsigned long addr;
+    char name[1024];
+    if (line[0] != ' ' && sscanf(line, "%lx <%1023[^>]>:", &addr, name) == 2 && strstr(line, ">:") != NULL) {
+      f = &s_funcs[name];
+      f->symbol = name;
+      f->name = strip_literal_suffixes(qualified_name(demangle(name)));
+      f->generic = generic_name(f->name);
+      f->indirect = false;
+      f->sp_accesses = 0;
+      f->frame = -1;
+      f->dynamic = false;
+      f->depth = -2;
+      f->unbounded = false;
+      continue;
+    }
+
+    // Instruction: "2000001a:\t2a00      \tcmp\tr2, #0"
+    char *colon = strchr(line, ':');
+    if (f == NULL || colon == NULL || colon[1] != '\t' || strspn(line, " 0123456789abcdef") != (size_t)(colon - line))
+      continue;
+    char *fields[3] = {NULL, NULL, NULL};
+    uint32_t nf = 0;
+    for (char *p = colon + 1; p != NULL && nf < 3; ) {
+      p += strspn(p, "\t");
+      if (*p == '\0')
+        break;
+      fields[nf++] = p;
+      p = strchr(p, '\t');
+      if (p != NULL)
+        *p++ = '\0';
+    }
+    if (nf < 3)
+      continue;
+    std::string op = fields[1];
+    const char *args = fields[2];
+    const size_t dot = op.find('.');
+    if (dot != std::string::npos)
+      op.erase(dot);
+
+    if (op == "bl" || op == "blx") {
+      const std::string callee = operand_symbol(args);
+      if (args[0] == 'r' || callee.empty())
+        f->indirect = true;
+      else
+        f->callees.insert(callee);
+    }
+    else if (op[0] == 'b' && op != "bic" && op != "bfi" && op != "bfc" && op != "bkpt" && op != "bx") {
+      // Branches to another function are tail calls
+      const std::string target = operand_symbol(args);
+      if (!target.empty() && target != f->symbol)
+        f->callees.insert(target);
+    }
+    if (strstr(args, "[sp") != NULL || ((op == "ldr" || op == "str" || op == "vldr" || op == "vstr") && strstr(args, ", sp") != NULL))
+      ++f->sp_accesses;
+  }
+  fclose(fp);
+  return 0;
+}
+
+static long s_external_bytes = 64;
+
+static long depth(Function &f) {
+  if (f.depth >= 0)
+    return f.depth;
+  if (f.depth == -1) {
+    // Recursion, the cycle is not counted again
+    f.unbounded = true;
+    return 0;
+  }
+  f.depth = -1;
+
+  if (f.frame < 0) {
+    const Frame *frame = NULL;
+    std::map<std::string, Frame>::const_iterator it = s_frames.find(f.name);
+    if (it != s_frames.end())
+      frame = &it->second;
+    else if (f.generic != f.name && (it = s_generic_frames.find(f.generic)) != s_generic_frames.end())
+      frame = &it->second;
+    if (frame != NULL) {
+      f.frame = frame->bytes;
+      f.dynamic = frame->dynamic;
+    }
+  }
+  // Library and assembly functions have no .su data, same assumption as for the firmware, but a name that failed to
+  // match may hide a frame of any size
+  const long frame = (f.frame >= 0) ? f.frame : s_external_bytes;
+
+  long deepest = 0;
+  bool unbounded = f.indirect || f.dynamic || f.frame < 0;
+  for (std::set<std::string>::const_iterator c = f.callees.begin(); c != f.callees.end(); ++c) {
+    std::map<std::string, Function>::iterator it = s_funcs.find(*c);
+    long d;
+    if (it == s_funcs.end()) {
+      d = s_external_bytes;
+    }
+    else {
+      d = depth(it->second);
+      unbounded = unbounded || it->second.unbounded;
+    }
+    if (d > deepest || f.next.empty()) {
+      deepest = (d > deepest) ? d : deepest;
+      f.next = *c;
+    }
+  }
+
+  f.unbounded = f.unbounded || unbounded;
+  f.depth = frame + deepest;
+  return f.depth;
+}
+
+static void usage(const char *name) {
+  fprintf(stderr,
+          "usage: %s [options] unit.list objdir|file.su ...\n"
+          "  -b bytes    fail when a hook needs more stack (default: 1024)\n"
+          "  -x bytes    stack assumed for functions outside the listing (default: 64)\n"
+          "  -v          list every function of the chains\n",
+          name);
+}
+
+int main(int argc, char **argv) {
+  long budget = 1024;
+  uint32_t verbose = 0;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "b:x:vh")) != -1) {
+    switch (opt) {
+    case 'b': budget = atol(optarg); break;
+    case 'x': s_external_bytes = atol(optarg); break;
+    case 'v': verbose = 1; break;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  if (argc - optind < 2) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  if (load_listing(argv[optind]) != 0)
+    return 1;
+  for (int i = optind + 1; i < argc; ++i)
+    if (load_su_path(argv[i]) != 0)
+      return 1;
+  if (s_frames.empty()) {
+    fprintf(stderr, "no stack usage data, objects built without -fstack-usage?\n");
+    return 1;
+  }
+
+  int ret = 0;
+  uint32_t hooks = 0;
+  for (std::map<std::string, Function>::iterator it = s_funcs.begin(); it != s_funcs.end(); ++it) {
+    Function &hook = it->second;
+    if (hook.symbol.compare(0, 6, "_hook_") != 0)
+      continue;
+    ++hooks;
+    const long d = depth(hook);
+    const bool over = d > budget;
+    printf("%-16s %6ld bytes%s%s\n", hook.symbol.c_str(), d, hook.unbounded ? " or more" : "",
+           over ? ", over budget" : "");
+
+    // Deepest chain
+    for (const Function *f = &hook; f != NULL; ) {
+      if (verbose || f->sp_accesses || f->frame < 0 || f == &hook)
+        printf("  %6ld %6ld  %-40s %u sp accesses%s%s%s\n", f->depth, (f->frame >= 0) ? f->frame : s_external_bytes,
+               f->name.c_str(), (unsigned)f->sp_accesses, (f->frame < 0) ? ", no stack usage data, assumed" : "",
+               f->dynamic ? ", dynamic" : "", f->indirect ? ", indirect calls" : "");
+      if (f->next.empty())
+        break;
+      std::map<std::string, Function>::const_iterator n = s_funcs.find(f->next);
+      if (n == s_funcs.end()) {
+        printf("  %6ld %6s  %-40s outside the listing, assumed\n", s_external_bytes, "", f->next.c_str());
+        break;
+      }
+      f = &n->second;
+    }
+    if (over)
+      ret = 1;
+  }
+
+  if (hooks == 0) {
+    fprintf(stderr, "%s: no _hook_* functions\n", argv[optind]);
+    return 1;
+  }
+  if (ret)
+    printf("stack budget of %ld bytes exceeded\n", budget);
+  return ret;
+}
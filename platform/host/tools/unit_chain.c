@@ -0,0 +1,249 @@
+/*
+ * File: unit_chain.c
+ *
+ * Offline renderer of a whole patch: oscillator -> modulation -> delay -> reverb effects.
+ *
+ * Drives the chain of units block by block from one event script per stage, and reports the processing time of
+ * each stage and of the whole chain per block, to budget a full patch rather than single units.
+ *
+ * 2018 (c) Korg
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "api_host.h"
+#include "unit_host.h"
+#include "voice_host.h"
+#include "chain_host.h"
+#include "event_script.h"
+#include "render_job.h"
+#include "wav_io.h"
+
+static void usage(const char *name) {
+  fprintf(stderr,
+          "usage: %s [options] unit.so ...\n"
+          "  units take the slot of their module, at most one per slot\n"
+          "  -e [module=]script  event script of a stage, osc by default\n"
+          "  -o out.wav          write output as 32-bit float WAV\n"
+          "  -l seconds          render length when no script has an end event (default: 2)\n"
+          "  -b frames           block size, 1 to %u (default: %u)\n"
+          "  -x                  split blocks at event offsets, making all events sample accurate\n"
+          "  -v voices           oscillator voices, 1 to %u (default: 1)\n"
+          "  -p policy           voice stealing: oldest, quietest, lowest, highest or none (default: oldest)\n"
+          "  -L                  feed the sub timbre bus with the main timbre, as layered patches\n"
+          "  -i input            input without oscillator: silence, impulse, noise or sine (default: noise)\n"
+          "  -s seed             seed of the firmware random sources (default: %u)\n"
+          "  -t bpm              tempo (default: 120)\n",
+          name, UNIT_HOST_MAX_FRAMES, UNIT_HOST_MAX_FRAMES, VOICE_HOST_MAX_VOICES, API_HOST_DEFAULT_SEED);
+}
+
+static uint32_t parse_stage(const char *name, size_t len) {
+  for (uint32_t s = 0; s < k_num_chain_stages; ++s) {
+    const char *module = unit_host_module_name(chain_host_stage_module(s));
+    if (strlen(module) == len && strncmp(module, name, len) == 0)
+      return s;
+  }
+  return k_num_chain_stages;
+}
+
+int main(int argc, char **argv) {
+  const char *script_paths[k_num_chain_stages] = {NULL, NULL, NULL, NULL};
+  const char *out_path = NULL;
+  double seconds = 2.0;
+  uint32_t frames = UNIT_HOST_MAX_FRAMES;
+  uint32_t flags = 0;
+  uint32_t voices = 1;
+  uint32_t policy = k_voice_steal_oldest;
+  uint32_t sub = k_chain_sub_silent;
+  uint32_t input = k_render_input_noise;
+  uint32_t seed = API_HOST_DEFAULT_SEED;
+  float bpm = 120.f;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "e:o:l:b:xv:p:Li:s:t:h")) != -1) {
+    switch (opt) {
+    case 'e': {
+      const char *eq = strchr(optarg, '=');
+      const uint32_t stage = (eq != NULL) ? parse_stage(optarg, (size_t)(eq - optarg)) : k_chain_osc;
+      if (stage == k_num_chain_stages) {
+        usage(argv[0]);
+        return 1;
+      }
+      script_paths[stage] = (eq != NULL) ? eq + 1 : optarg;
+      break;
+    }
+    case 'o': out_path = optarg; break;
+    case 'l': seconds = atof(optarg); break;
+    case 'b': frames = (uint32_t)atoi(optarg); break;
+    case 'x': flags |= k_unit_host_split; break;
+    case 'v': voices = (uint32_t)atoi(optarg); break;
+    case 'p':
+      for (policy = 0; policy < k_num_voice_steal_policies; ++policy)
+        if (strcmp(optarg, voice_host_policy_name(policy)) == 0)
+          break;
+      if (policy == k_num_voice_steal_policies) {
+        usage(argv[0]);
+        return 1;
+      }
+      break;
+    case 'L': sub = k_chain_sub_main; break;
+    case 'i':
+      for (input = 0; input < k_render_input_buffer; ++input)
+        if (strcmp(optarg, render_input_name(input)) == 0)
+          break;
+      if (input == k_render_input_buffer) {
+        usage(argv[0]);
+        return 1;
+      }
+      break;
+    case 's': seed = (uint32_t)strtoul(optarg, NULL, 0); break;
+    case 't': bpm = (float)atof(optarg); break;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  if (optind == argc || frames == 0 || frames > UNIT_HOST_MAX_FRAMES || voices == 0
+      || voices > VOICE_HOST_MAX_VOICES) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  chain_host_t ch;
+  chain_host_reset(&ch);
+  ch.sub = sub;
+  ch.input.type = input;
+
+  const char *unit_paths[k_num_chain_stages] = {NULL, NULL, NULL, NULL};
+  for (int i = optind; i < argc; ++i) {
+    const uint32_t loaded = ch.stages;
+    if (chain_host_load(&ch, argv[i], voices) != 0) {
+      chain_host_close(&ch);
+      return 1;
+    }
+    for (uint32_t s = 0; s < k_num_chain_stages; ++s)
+      if ((ch.stages & ~loaded) & (1U << s))
+        unit_paths[s] = argv[i];
+  }
+
+  for (uint32_t s = k_chain_modfx; s < k_num_chain_stages; ++s)
+    if (ch.stages & (1U << s))
+      ch.fx[s].flags = flags;
+  if (ch.stages & (1U << k_chain_osc))
+    for (uint32_t i = 0; i < ch.voices.count; ++i)
+      ch.voices.voices[i].unit.flags = flags;
+
+  // Units of different instruments are not meant to run together
+  uint32_t platform = 0;
+  for (uint32_t s = 0; s < k_num_chain_stages; ++s) {
+    if (!(ch.stages & (1U << s)))
+      continue;
+    const uint32_t target = (s == k_chain_osc) ? ch.voices.voices[0].unit.target : ch.fx[s].target;
+    if (platform && (target & USER_TARGET_PLATFORM_MASK) != platform)
+      fprintf(stderr, "warning: %s targets another platform\n", unit_paths[s]);
+    platform = platform ? platform : (target & USER_TARGET_PLATFORM_MASK);
+  }
+  if (platform == k_user_target_prologue && (ch.stages & (1U << k_chain_delfx)) && (ch.stages & (1U << k_chain_revfx)))
+    fprintf(stderr, "warning: prologue runs either a delay or a reverb effect, not both\n");
+
+  event_script_t scripts[k_num_chain_stages];
+  uint32_t length = 0;
+  for (uint32_t s = 0; s < k_num_chain_stages; ++s) {
+    event_script_init(&scripts[s]);
+    if (script_paths[s] == NULL)
+      continue;
+    if (!(ch.stages & (1U << s))) {
+      fprintf(stderr, "%s: no %s unit in the chain\n", script_paths[s],
+              unit_host_module_name(chain_host_stage_module(s)));
+      return 1;
+    }
+    if (event_script_load(&scripts[s], script_paths[s], chain_host_stage_module(s)) != 0)
+      return 1;
+    length = (scripts[s].length > length) ? scripts[s].length : length;
+  }
+  if (length == 0)
+    length = (uint32_t)(seconds * UNIT_HOST_FS);
+
+  wav_writer_t wav;
+  if (out_path != NULL && wav_open_write(&wav, out_path, 2, UNIT_HOST_FS) != 0)
+    return 1;
+
+  api_host_seed(seed);
+  api_host_set_bpmf(bpm);
+  chain_host_init(&ch);
+  ch.voices.policy = policy;
+
+  static user_event_t events[k_num_chain_stages][UNIT_HOST_MAX_EVENTS];
+  const user_event_t *stage_events[k_num_chain_stages];
+  uint32_t counts[k_num_chain_stages];
+  uint32_t cursors[k_num_chain_stages] = {0, 0, 0, 0};
+  for (uint32_t s = 0; s < k_num_chain_stages; ++s)
+    stage_events[s] = events[s];
+
+  float yn[2 * UNIT_HOST_MAX_FRAMES];
+  double total_ns[k_num_chain_stages] = {0}, max_ns[k_num_chain_stages] = {0};
+  double chain_total_ns = 0, chain_max_ns = 0;
+  double peak = 0, sum2 = 0;
+  uint32_t blocks = 0;
+
+  for (uint32_t pos = 0; pos < length; pos += frames) {
+    const uint32_t n = (length - pos < frames) ? length - pos : frames;
+    for (uint32_t s = 0; s < k_num_chain_stages; ++s)
+      counts[s] = event_script_block(&scripts[s], &cursors[s], pos, n, events[s], UNIT_HOST_MAX_EVENTS);
+
+    chain_host_render(&ch, stage_events, counts, yn, n);
+
+    double block_ns = 0;
+    for (uint32_t s = 0; s < k_num_chain_stages; ++s) {
+      total_ns[s] += ch.ns[s];
+      max_ns[s] = (ch.ns[s] > max_ns[s]) ? ch.ns[s] : max_ns[s];
+      block_ns += ch.ns[s];
+    }
+    chain_total_ns += block_ns;
+    chain_max_ns = (block_ns > chain_max_ns) ? block_ns : chain_max_ns;
+    ++blocks;
+
+    for (uint32_t i = 0; i < 2 * n; ++i) {
+      const double a = fabs(yn[i]);
+      peak = (a > peak) ? a : peak;
+      sum2 += (double)yn[i] * yn[i];
+    }
+
+    if (out_path != NULL && wav_write(&wav, yn, n) != 0) {
+      fprintf(stderr, "%s: write error\n", out_path);
+      return 1;
+    }
+  }
+
+  if (out_path != NULL && wav_close(&wav) != 0)
+    return 1;
+
+  const double period_ns = 1e9 * frames / UNIT_HOST_FS;
+  const double rms = sqrt(sum2 / (2.0 * length));
+  printf("chain: %u frames in %u blocks of %u\n", (unsigned)length, (unsigned)blocks, (unsigned)frames);
+  printf("  peak %.2f dBFS, rms %.2f dBFS\n", 20 * log10(peak + 1e-30), 20 * log10(rms + 1e-30));
+  for (uint32_t s = 0; s < k_num_chain_stages; ++s) {
+    if (!(ch.stages & (1U << s)))
+      continue;
+    printf("  %-6s %8.0f ns/block mean %8.0f max, %5.1f%% of the chain  %s",
+           unit_host_module_name(chain_host_stage_module(s)), total_ns[s] / blocks, max_ns[s],
+           chain_total_ns > 0 ? 100.0 * total_ns[s] / chain_total_ns : 0.0, unit_paths[s]);
+    if (s == k_chain_osc)
+      printf(", %u voices", (unsigned)ch.voices.count);
+    printf("\n");
+  }
+  printf("  total  %8.0f ns/block mean %8.0f max, %.2f%% of the %.0f ns block period mean, %.2f%% max\n",
+         chain_total_ns / blocks, chain_max_ns, 100.0 * chain_total_ns / blocks / period_ns, period_ns,
+         100.0 * chain_max_ns / period_ns);
+
+  for (uint32_t s = 0; s < k_num_chain_stages; ++s)
+    event_script_free(&scripts[s]);
+  chain_host_close(&ch);
+  return 0;
+}
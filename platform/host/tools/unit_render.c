@@ -0,0 +1,267 @@
+/*
+ * File: unit_render.c
+ *
+ * Offline renderer for units built as native shared objects.
+ *
+ * Drives a unit block by block from an event script (see event_script.h) and writes the output to a WAV file, so that
+ * renders with heavy automation are reproducible. Reports levels and host processing time per block.
+ *
+ * 2018 (c) Korg
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "api_host.h"
+#include "unit_host.h"
+#include "voice_host.h"
+#include "event_script.h"
+#include "render_job.h"
+#include "wav_io.h"
+
+static void usage(const char *name) {
+  fprintf(stderr,
+          "usage: %s [options] unit.so\n"
+          "  -e script   event script\n"
+          "  -o out.wav  write output as 32-bit float WAV\n"
+          "  -l seconds  render length when the script has no end event (default: 2)\n"
+          "  -b frames   block size, 1 to %u (default: %u)\n"
+          "  -x          split blocks at event offsets, making all events sample accurate\n"
+          "  -i input    effect input: silence, impulse, noise, sine or a WAV file (default: impulse)\n"
+          "  -m module   osc, modfx, delfx or revfx, for units without target information\n"
+          "  -v voices   oscillators: play polyphonically with 1 to %u instances\n"
+          "  -p policy   voice stealing: oldest, quietest, lowest, highest or none (default: oldest)\n"
+          "  -w          render idle voices too, for worst case load\n"
+          "  -s seed     seed of the firmware random sources (default: %u)\n"
+          "  -t bpm      tempo (default: 120)\n"
+          "  -P ring.bin write the PROF_SCOPE samples of a unit built with PROFILE=1, see prof_dump\n",
+          name, UNIT_HOST_MAX_FRAMES, UNIT_HOST_MAX_FRAMES, VOICE_HOST_MAX_VOICES, API_HOST_DEFAULT_SEED);
+}
+
+static uint32_t parse_module(const char *name) {
+  if (strcmp(name, "osc") == 0) return k_user_module_osc;
+  if (strcmp(name, "modfx") == 0) return k_user_module_modfx;
+  if (strcmp(name, "delfx") == 0) return k_user_module_delfx;
+  if (strcmp(name, "revfx") == 0) return k_user_module_revfx;
+  return k_num_user_modules;
+}
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int main(int argc, char **argv) {
+  const char *script_path = NULL;
+  const char *out_path = NULL;
+  const char *input_path = NULL;
+  uint32_t input = k_render_input_impulse;
+  double seconds = 2.0;
+  uint32_t frames = UNIT_HOST_MAX_FRAMES;
+  uint32_t flags = 0;
+  uint32_t target = 0;
+  uint32_t seed = API_HOST_DEFAULT_SEED;
+  float bpm = 120.f;
+  uint32_t voices = 0;
+  uint32_t policy = k_voice_steal_oldest;
+  uint32_t render_idle = 0;
+  const char *profile_path = NULL;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "e:o:l:b:xi:m:v:p:ws:t:P:h")) != -1) {
+    switch (opt) {
+    case 'e': script_path = optarg; break;
+    case 'o': out_path = optarg; break;
+    case 'l': seconds = atof(optarg); break;
+    case 'b': frames = (uint32_t)atoi(optarg); break;
+    case 'x': flags |= k_unit_host_split; break;
+    case 'i':
+      for (input = 0; input < k_render_input_buffer; ++input)
+        if (strcmp(optarg, render_input_name(input)) == 0)
+          break;
+      if (input == k_render_input_buffer)
+        input_path = optarg;
+      break;
+    case 'm':
+      target = parse_module(optarg);
+      if (target == k_num_user_modules) {
+        usage(argv[0]);
+        return 1;
+      }
+      target |= k_user_target_prologue;
+      break;
+    case 'v': voices = (uint32_t)atoi(optarg); break;
+    case 'p':
+      for (policy = 0; policy < k_num_voice_steal_policies; ++policy)
+        if (strcmp(optarg, voice_host_policy_name(policy)) == 0)
+          break;
+      if (policy == k_num_voice_steal_policies) {
+        usage(argv[0]);
+        return 1;
+      }
+      break;
+    case 'w': render_idle = 1; break;
+    case 's': seed = (uint32_t)strtoul(optarg, NULL, 0); break;
+    case 't': bpm = (float)atof(optarg); break;
+    case 'P': profile_path = optarg; break;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  if (optind != argc - 1 || frames == 0 || frames > UNIT_HOST_MAX_FRAMES) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  // Voices are private instances, the first one doubles as the unit for monophonic renders
+  voice_host_t vh;
+  if (voices == 0) {
+    vh.voices = (voice_t *)calloc(1, sizeof(voice_t));
+    vh.count = 1;
+    if (vh.voices == NULL || unit_host_open(&vh.voices[0].unit, argv[optind], target) != 0)
+      return 1;
+  }
+  else if (voice_host_open(&vh, argv[optind], voices, target) != 0)
+    return 1;
+  for (uint32_t i = 0; i < vh.count; ++i)
+    vh.voices[i].unit.flags = flags;
+  unit_host_t *u = &vh.voices[0].unit;
+
+  const uint32_t module = unit_host_module(u);
+  const uint32_t channels = unit_host_channels(u);
+
+  event_script_t script;
+  event_script_init(&script);
+  if (script_path != NULL && event_script_load(&script, script_path, module) != 0)
+    return 1;
+
+  const uint32_t length = script.length ? script.length : (uint32_t)(seconds * UNIT_HOST_FS);
+
+  render_input_t in;
+  render_input_init(&in, input);
+  float *in_data = NULL;
+  if (input == k_render_input_buffer) {
+    uint32_t in_rate = 0;
+    in_data = wav_read(input_path, &in.channels, &in.frames, &in_rate);
+    if (in_data == NULL)
+      return 1;
+    in.data = in_data;
+    if (in_rate != UNIT_HOST_FS)
+      fprintf(stderr, "%s: %u Hz input played at %u Hz\n", input_path, (unsigned)in_rate, UNIT_HOST_FS);
+  }
+
+  wav_writer_t wav;
+  if (out_path != NULL && wav_open_write(&wav, out_path, channels, UNIT_HOST_FS) != 0)
+    return 1;
+
+  api_host_seed(seed);
+  api_host_set_bpmf(bpm);
+  if (voices) {
+    voice_host_init(&vh);
+    vh.policy = policy;
+    vh.render_idle = render_idle;
+  }
+  else
+    unit_host_init(u);
+
+  int32_t osc_yn[UNIT_HOST_MAX_FRAMES];
+  float xn[2 * UNIT_HOST_MAX_FRAMES], sub_xn[2 * UNIT_HOST_MAX_FRAMES];
+  float yn[2 * UNIT_HOST_MAX_FRAMES], sub_yn[2 * UNIT_HOST_MAX_FRAMES];
+  user_event_t events[UNIT_HOST_MAX_EVENTS];
+
+  const unit_host_io_t io = {osc_yn, xn, yn, sub_xn, sub_yn, xn};
+
+  uint32_t cursor = 0;
+  double peak = 0, sum2 = 0, total_ns = 0, max_ns = 0;
+  uint32_t blocks = 0;
+  double voice_ns[VOICE_HOST_MAX_VOICES];
+  double voice_total_ns[VOICE_HOST_MAX_VOICES] = {0};
+  uint32_t max_active = 0;
+
+  for (uint32_t pos = 0; pos < length; pos += frames) {
+    const uint32_t n = (length - pos < frames) ? length - pos : frames;
+    const uint32_t count = event_script_block(&script, &cursor, pos, n, events, UNIT_HOST_MAX_EVENTS);
+
+    if (module != k_user_module_osc) {
+      render_input_fill(&in, pos, xn, n);
+      memcpy(sub_xn, xn, 2 * n * sizeof(float));
+    }
+
+    const double t0 = now_ns();
+    if (voices)
+      voice_host_render(&vh, events, count, osc_yn, n, voice_ns);
+    else
+      unit_host_render(u, &io, events, count, n);
+    const double dt = now_ns() - t0;
+    if (voices) {
+      for (uint32_t i = 0; i < voices; ++i)
+        voice_total_ns[i] += voice_ns[i];
+      const uint32_t active = voice_host_active(&vh);
+      max_active = (active > max_active) ? active : max_active;
+    }
+    total_ns += dt;
+    max_ns = (dt > max_ns) ? dt : max_ns;
+    ++blocks;
+
+    // Main timbre output of modulation effects, in-place output otherwise
+    const float *out = (module == k_user_module_modfx) ? yn : xn;
+    if (module == k_user_module_osc) {
+      for (uint32_t i = 0; i < n; ++i)
+        yn[i] = osc_yn[i] * (1.f / 2147483648.f);
+      out = yn;
+    }
+
+    for (uint32_t i = 0; i < n * channels; ++i) {
+      const double a = fabs(out[i]);
+      peak = (a > peak) ? a : peak;
+      sum2 += (double)out[i] * out[i];
+    }
+
+    if (out_path != NULL && wav_write(&wav, out, n) != 0) {
+      fprintf(stderr, "%s: write error\n", out_path);
+      return 1;
+    }
+  }
+
+  if (out_path != NULL && wav_close(&wav) != 0)
+    return 1;
+
+  const double rms = sqrt(sum2 / ((double)length * channels + 1e-30));
+  printf("%s: %s, %u frames in %u blocks of %u\n", argv[optind], unit_host_module_name(module),
+         (unsigned)length, (unsigned)blocks, (unsigned)frames);
+  printf("  peak %.2f dBFS, rms %.2f dBFS\n", 20 * log10(peak + 1e-30), 20 * log10(rms + 1e-30));
+  printf("  %.0f ns/block mean, %.0f ns/block max\n", blocks ? total_ns / blocks : 0.0, max_ns);
+  if (voices) {
+    printf("  %u voices, %s stealing: %u notes stolen, %u dropped, %u voices active at most\n",
+           (unsigned)voices, voice_host_policy_name(policy), (unsigned)vh.steals, (unsigned)vh.dropped,
+           (unsigned)max_active);
+    printf("  ns/block per voice:");
+    for (uint32_t i = 0; i < voices; ++i)
+      printf(" %.0f", blocks ? voice_total_ns[i] / blocks : 0.0);
+    printf("\n");
+  }
+  if (u->dropped)
+    printf("  %u events dropped\n", (unsigned)u->dropped);
+
+  int ret = 0;
+  if (profile_path != NULL && unit_host_dump_profile(u, profile_path) != 0)
+    ret = 1;
+
+  event_script_free(&script);
+  if (voices)
+    voice_host_close(&vh);
+  else {
+    unit_host_close(u);
+    free(vh.voices);
+  }
+  free(in_data);
+  return ret;
+}
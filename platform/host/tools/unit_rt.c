@@ -0,0 +1,415 @@
+/*
+ * File: unit_rt.c
+ *
+ * Real-time deadline simulation of units built as native shared objects.
+ *
+ * Runs the cycle/process hook of a unit at the block rate of the instruments, 48kHz / frames, on a SCHED_FIFO
+ * thread, and checks each block against a wall-clock deadline. Host processing time is scaled to the clock of the
+ * target MCU, 84MHz for STM32F401 and 180MHz for STM32F446 as in $(PLATFORM)/$(MODULE).mk, so that the deadline is
+ * the block period of the instrument. Reports deadline misses, a histogram of the slack left per block, and the
+ * events that preceded the worst blocks. Host wakeup latency is not scaled: blocks the host itself finishes or starts
+ * after the block period are counted apart, and don't weigh on the deadline of the unit. Output goes to a null sink or to a WAV file written after the run.
+ *
+ * 2018 (c) Korg
+ *
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+
+#include "api_host.h"
+#include "unit_host.h"
+#include "event_script.h"
+#include "render_job.h"
+#include "wav_io.h"
+
+#define RT_HISTORY_BLOCKS (4)
+#define RT_MAX_SPIKES     (10)
+#define RT_SLACK_BINS     (20)
+
+/* Events of a recent block, for spike reports */
+typedef struct rt_block_events {
+  uint32_t block;
+  uint32_t count;
+  user_event_t events[UNIT_HOST_MAX_EVENTS];
+} rt_block_events_t;
+
+typedef struct rt_spike {
+  uint32_t block;
+  /** Scaled processing time over the block period */
+  double load;
+  uint32_t count;
+  /** Events of the spike block and the ones before it, block relative to the spike in offset high bits */
+  user_event_t events[UNIT_HOST_MAX_EVENTS];
+  int8_t ago[UNIT_HOST_MAX_EVENTS];
+} rt_spike_t;
+
+typedef struct rt_sim {
+  unit_host_t unit;
+  const event_script_t *script;
+  render_input_t input;
+  uint32_t length;
+  uint32_t frames;
+  /** Host ns to target ns */
+  double scale;
+  double period_ns;
+  /** Blocks over this load are reported as spikes */
+  double spike_load;
+  float *out;
+
+  uint32_t blocks;
+  uint32_t misses;
+  /** Blocks the host finished after the block period */
+  uint32_t overruns;
+  uint32_t late_starts;
+  double total_ns;
+  double max_ns;
+  double max_latency_ns;
+  /** Slack in 5% steps of the period from 0 to 100%, misses in the first bin */
+  uint32_t slack_hist[RT_SLACK_BINS + 1];
+  rt_block_events_t history[RT_HISTORY_BLOCKS];
+  rt_spike_t spikes[RT_MAX_SPIKES];
+  uint32_t spike_count;
+} rt_sim_t;
+
+static void usage(const char *name) {
+  fprintf(stderr,
+          "usage: %s [options] unit.so\n"
+          "  -e script   event script\n"
+          "  -o out.wav  write output as 32-bit float WAV after the run (default: null sink)\n"
+          "  -l seconds  run length when the script has no end event (default: 10)\n"
+          "  -b frames   block size, 1 to %u (default: %u)\n"
+          "  -c mhz      target core clock (default: 84 for STM32F401 oscillators, 180 for STM32F446)\n"
+          "  -H mhz      host speed as the clock of an equivalent Cortex-M4 (default: calibrated)\n"
+          "  -k load     report blocks over this fraction of the period as spikes (default: 0.8)\n"
+          "  -i input    effect input: silence, impulse, noise or sine (default: noise)\n"
+          "  -P prio     SCHED_FIFO priority (default: maximum - 1)\n"
+          "  -s seed     seed of the firmware random sources (default: %u)\n",
+          name, UNIT_HOST_MAX_FRAMES, UNIT_HOST_MAX_FRAMES, API_HOST_DEFAULT_SEED);
+}
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void sleep_until(double t) {
+  struct timespec ts;
+  ts.tv_sec = (time_t)(t * 1e-9);
+  ts.tv_nsec = (long)(t - ts.tv_sec * 1e9);
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+    ;
+}
+
+/* Core clock of the MCU running the unit, see $(PLATFORM)/$(MODULE).mk */
+static double target_mhz(uint32_t target) {
+  const uint32_t platform = target & USER_TARGET_PLATFORM_MASK;
+  const uint32_t f401 = (target & USER_TARGET_MODULE_MASK) == k_user_module_osc
+    && (platform == k_user_target_prologue || platform == k_user_target_miniloguexd);
+  return f401 ? 84.0 : 180.0;
+}
+
+/*
+ * Host speed in Cortex-M4 MHz from a chain of dependent multiply-accumulates, which the Cortex-M4 runs in 3 cycles
+ * each (vmla.f32). Host pipelines overlap independent work far better than the Cortex-M4, so this undershoots the
+ * speed of the host on most unit code: measurements on hardware should be preferred through -H.
+ */
+static double calibrate_mhz(void) {
+  static const uint32_t k_iterations = 1U << 22;
+  volatile float seed_a = 0.999f, seed_b = 1e-3f;
+  const float a = seed_a, b = seed_b;
+  float x = 0.f;
+  double best = 1e30;
+
+  for (uint32_t pass = 0; pass < 5; ++pass) {
+    const double t0 = now_ns();
+    for (uint32_t i = 0; i < k_iterations; ++i) {
+      x = x * a + b;
+      x = x * a + b;
+      x = x * a + b;
+      x = x * a + b;
+    }
+    const double dt = now_ns() - t0;
+    best = (dt < best) ? dt : best;
+  }
+
+  volatile float sink = x;
+  (void)sink;
+  // Four 3 cycle accumulates and 3 cycles of loop overhead per iteration
+  return (15.0 * k_iterations) / best * 1e3;
+}
+
+static void record_spike(rt_sim_t *sim, uint32_t block, double load) {
+  uint32_t slot = sim->spike_count;
+  if (slot == RT_MAX_SPIKES) {
+    // Replace the mildest spike
+    slot = 0;
+    for (uint32_t i = 1; i < RT_MAX_SPIKES; ++i)
+      if (sim->spikes[i].load < sim->spikes[slot].load)
+        slot = i;
+    if (sim->spikes[slot].load >= load)
+      return;
+  }
+  else
+    ++sim->spike_count;
+
+  rt_spike_t *s = &sim->spikes[slot];
+  s->block = block;
+  s->load = load;
+  s->count = 0;
+  for (int ago = RT_HISTORY_BLOCKS - 1; ago >= 0; --ago) {
+    if ((uint32_t)ago > block)
+      continue;
+    const rt_block_events_t *h = &sim->history[(block - ago) % RT_HISTORY_BLOCKS];
+    for (uint32_t i = 0; i < h->count && s->count < UNIT_HOST_MAX_EVENTS; ++i) {
+      s->events[s->count] = h->events[i];
+      s->ago[s->count++] = (int8_t)ago;
+    }
+  }
+}
+
+static void *rt_main(void *arg) {
+  rt_sim_t *sim = (rt_sim_t *)arg;
+  const uint32_t module = unit_host_module(&sim->unit);
+  const uint32_t channels = unit_host_channels(&sim->unit);
+  const double deadline_ns = sim->period_ns / sim->scale;
+
+  int32_t osc_yn[UNIT_HOST_MAX_FRAMES];
+  float xn[2 * UNIT_HOST_MAX_FRAMES], sub_xn[2 * UNIT_HOST_MAX_FRAMES];
+  float yn[2 * UNIT_HOST_MAX_FRAMES], sub_yn[2 * UNIT_HOST_MAX_FRAMES];
+  const unit_host_io_t io = {osc_yn, xn, yn, sub_xn, sub_yn, xn};
+  uint32_t cursor = 0;
+
+  // Blocks are released at the real block period, processing time is checked against its scaled budget
+  const double start = now_ns() + sim->period_ns;
+  for (uint32_t pos = 0, block = 0; pos < sim->length; pos += sim->frames, ++block) {
+    const uint32_t n = (sim->length - pos < sim->frames) ? sim->length - pos : sim->frames;
+    const double release = start + block * sim->period_ns;
+
+    rt_block_events_t *h = &sim->history[block % RT_HISTORY_BLOCKS];
+    h->block = block;
+    h->count = (sim->script != NULL)
+      ? event_script_block(sim->script, &cursor, pos, n, h->events, UNIT_HOST_MAX_EVENTS) : 0;
+    if (module != k_user_module_osc) {
+      render_input_fill(&sim->input, pos, xn, n);
+      memcpy(sub_xn, xn, 2 * n * sizeof(float));
+    }
+
+    sleep_until(release);
+    const double t0 = now_ns();
+    unit_host_render(&sim->unit, &io, h->events, h->count, n);
+    const double t1 = now_ns();
+
+    const double latency = t0 - release;
+    const double dt = t1 - t0;
+    const double load = dt / deadline_ns;
+    sim->total_ns += dt;
+    sim->max_ns = (dt > sim->max_ns) ? dt : sim->max_ns;
+    sim->max_latency_ns = (latency > sim->max_latency_ns) ? latency : sim->max_latency_ns;
+    sim->overruns += (t1 - release > sim->period_ns);
+    sim->late_starts += (latency > sim->period_ns);
+    ++sim->blocks;
+
+    if (load > 1.0) {
+      ++sim->misses;
+      ++sim->slack_hist[0];
+    }
+    else
+      ++sim->slack_hist[1 + (uint32_t)((1.0 - load) * RT_SLACK_BINS * 0.9999)];
+    if (load > sim->spike_load)
+      record_spike(sim, block, load);
+
+    if (sim->out != NULL) {
+      const float *out = (module == k_user_module_modfx) ? yn : xn;
+      if (module == k_user_module_osc) {
+        for (uint32_t i = 0; i < n; ++i)
+          yn[i] = osc_yn[i] * (1.f / 2147483648.f);
+        out = yn;
+      }
+      memcpy(sim->out + (size_t)pos * channels, out, n * channels * sizeof(float));
+    }
+  }
+
+  return NULL;
+}
+
+static const char *event_name(uint8_t type) {
+  switch (type) {
+  case k_user_event_param:     return "param";
+  case k_user_event_value:     return "value";
+  case k_user_event_note_on:   return "note_on";
+  case k_user_event_note_off:  return "note_off";
+  case k_user_event_pitch:     return "pitch";
+  case k_user_event_shape_lfo: return "shape_lfo";
+  default:                     return "?";
+  }
+}
+
+static int compare_spikes(const void *a, const void *b) {
+  const double la = ((const rt_spike_t *)a)->load, lb = ((const rt_spike_t *)b)->load;
+  return (la < lb) - (la > lb);
+}
+
+int main(int argc, char **argv) {
+  const char *script_path = NULL;
+  const char *out_path = NULL;
+  double seconds = 10.0;
+  uint32_t frames = UNIT_HOST_MAX_FRAMES;
+  double mhz = 0, host_mhz = 0;
+  double spike_load = 0.8;
+  uint32_t input = k_render_input_noise;
+  int prio = sched_get_priority_max(SCHED_FIFO) - 1;
+  uint32_t seed = API_HOST_DEFAULT_SEED;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "e:o:l:b:c:H:k:i:P:s:h")) != -1) {
+    switch (opt) {
+    case 'e': script_path = optarg; break;
+    case 'o': out_path = optarg; break;
+    case 'l': seconds = atof(optarg); break;
+    case 'b': frames = (uint32_t)atoi(optarg); break;
+    case 'c': mhz = atof(optarg); break;
+    case 'H': host_mhz = atof(optarg); break;
+    case 'k': spike_load = atof(optarg); break;
+    case 'i':
+      for (input = 0; input < k_render_input_buffer; ++input)
+        if (strcmp(optarg, render_input_name(input)) == 0)
+          break;
+      if (input == k_render_input_buffer) {
+        usage(argv[0]);
+        return 1;
+      }
+      break;
+    case 'P': prio = atoi(optarg); break;
+    case 's': seed = (uint32_t)strtoul(optarg, NULL, 0); break;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  if (optind != argc - 1 || frames == 0 || frames > UNIT_HOST_MAX_FRAMES || mhz < 0 || host_mhz < 0) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  static rt_sim_t sim;
+  if (unit_host_open(&sim.unit, argv[optind], 0) != 0)
+    return 1;
+  const uint32_t module = unit_host_module(&sim.unit);
+  const uint32_t channels = unit_host_channels(&sim.unit);
+
+  event_script_t script;
+  event_script_init(&script);
+  if (script_path != NULL && event_script_load(&script, script_path, module) != 0)
+    return 1;
+
+  if (mhz == 0)
+    mhz = target_mhz(sim.unit.target);
+  if (host_mhz == 0)
+    host_mhz = calibrate_mhz();
+
+  sim.script = &script;
+  render_input_init(&sim.input, input);
+  sim.length = script.length ? script.length : (uint32_t)(seconds * UNIT_HOST_FS);
+  sim.frames = frames;
+  sim.scale = host_mhz / mhz;
+  sim.period_ns = 1e9 * frames / UNIT_HOST_FS;
+  sim.spike_load = spike_load;
+  if (out_path != NULL) {
+    sim.out = (float *)calloc((size_t)sim.length * channels, sizeof(float));
+    if (sim.out == NULL)
+      return 1;
+  }
+
+  // Page faults and preemption would show up as misses
+  const int locked = (mlockall(MCL_CURRENT | MCL_FUTURE) == 0);
+
+  api_host_seed(seed);
+  unit_host_init(&sim.unit);
+
+  pthread_attr_t attr;
+  struct sched_param param;
+  param.sched_priority = prio;
+  pthread_attr_init(&attr);
+  pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+  pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+  pthread_attr_setschedparam(&attr, &param);
+
+  pthread_t tid;
+  int fifo = 1;
+  if (pthread_create(&tid, &attr, rt_main, &sim) != 0) {
+    // Without CAP_SYS_NICE or an rtprio limit, run with default scheduling
+    fifo = 0;
+    if (pthread_create(&tid, NULL, rt_main, &sim) != 0) {
+      fprintf(stderr, "cannot start the render thread\n");
+      return 1;
+    }
+  }
+  pthread_join(tid, NULL);
+  pthread_attr_destroy(&attr);
+
+  if (out_path != NULL) {
+    wav_writer_t wav;
+    if (wav_open_write(&wav, out_path, channels, UNIT_HOST_FS) != 0 || wav_write(&wav, sim.out, sim.length) != 0
+        || wav_close(&wav) != 0) {
+      fprintf(stderr, "%s: write error\n", out_path);
+      return 1;
+    }
+  }
+
+  const double deadline_ns = sim.period_ns / sim.scale;
+  printf("%s: %s, %u blocks of %u frames every %.0f ns\n", argv[optind], unit_host_module_name(module),
+         (unsigned)sim.blocks, (unsigned)frames, sim.period_ns);
+  printf("  %s scheduling%s, target %.0f MHz, host %.0f Cortex-M4 MHz: %.0f ns host budget per block\n",
+         fifo ? "SCHED_FIFO" : "default (SCHED_FIFO not permitted)", locked ? ", memory locked" : "",
+         mhz, host_mhz, deadline_ns);
+  printf("  %.0f ns/block mean, %.0f max, scaled to target %.1f%% mean, %.1f%% max of the period\n",
+         sim.total_ns / sim.blocks, sim.max_ns, 100.0 * sim.total_ns / sim.blocks / deadline_ns,
+         100.0 * sim.max_ns / deadline_ns);
+  printf("  %u deadline misses (%.3f%%)\n", (unsigned)sim.misses, 100.0 * sim.misses / sim.blocks);
+  printf("  host: %u blocks finished late, %u late starts, %.0f ns worst wakeup latency\n",
+         (unsigned)sim.overruns, (unsigned)sim.late_starts, sim.max_latency_ns);
+
+  printf("  slack histogram, %% of the period left:\n");
+  printf("    %8s %8u\n", "miss", (unsigned)sim.slack_hist[0]);
+  for (uint32_t b = 1; b <= RT_SLACK_BINS; ++b) {
+    if (sim.slack_hist[b] == 0)
+      continue;
+    const uint32_t bar = (uint32_t)(50.0 * sim.slack_hist[b] / sim.blocks + 0.5);
+    printf("    %3u-%3u%% %8u ", (unsigned)((b - 1) * 100 / RT_SLACK_BINS), (unsigned)(b * 100 / RT_SLACK_BINS),
+           (unsigned)sim.slack_hist[b]);
+    for (uint32_t i = 0; i < bar; ++i)
+      putchar('#');
+    putchar('\n');
+  }
+
+  qsort(sim.spikes, sim.spike_count, sizeof(rt_spike_t), compare_spikes);
+  if (sim.spike_count)
+    printf("  worst blocks over %.0f%% of the period, with the events of the %u blocks up to them:\n",
+           100.0 * spike_load, RT_HISTORY_BLOCKS);
+  for (uint32_t i = 0; i < sim.spike_count; ++i) {
+    const rt_spike_t *s = &sim.spikes[i];
+    printf("    block %u at %.3f s: %.1f%%%s\n", (unsigned)s->block,
+           (double)s->block * frames / UNIT_HOST_FS, 100.0 * s->load, (s->load > 1.0) ? " MISS" : "");
+    for (uint32_t e = 0; e < s->count; ++e)
+      printf("      block %-3d +%-2u %-9s %3u %d\n", -(int)s->ago[e], (unsigned)s->events[e].offset,
+             event_name(s->events[e].type), (unsigned)s->events[e].index, (int)s->events[e].value);
+  }
+
+  free(sim.out);
+  event_script_free(&script);
+  unit_host_close(&sim.unit);
+  return sim.misses ? 2 : 0;
+}
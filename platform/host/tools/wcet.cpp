@@ -0,0 +1,1219 @@
+/*
+ * File: wcet.cpp
+ *
+ * Static worst-case execution time analysis of unit hooks from the .list output of the SDK build (objdump -S).
+ *
+ * Builds the control flow graph of each _hook_* function, and of the functions they call, from the disassembly.
+ * Loops are bounded by the 64 frame contract of the cycle/process hooks unless given explicit bounds, and collapsed
+ * innermost first. The worst case is the longest path through the resulting graph, in Cortex-M4 cycles:
+ *  - Instruction timings of the Cortex-M4 and its FPU, with the worst pipeline refill on taken branches.
+ *  - Wait states of loads and stores whose address is known to be in flash (firmware tables) or SDRAM (__sdram
+ *    buffers), from literal pool and movw/movt constants tracked through registers.
+ *  - Accesses through pointers of unknown origin are assumed to hit SRAM, with a second bound assuming SDRAM.
+ *  - Firmware API functions are outside the listing, their cost is assumed.
+ * Caches, the flash accelerator and bus contention are not modeled: results bound the worst case of the modeled
+ * timings only, and are meant to compare code versions and find what dominates.
+ *
+ * 2018 (c) Korg
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+static const uint32_t k_refill = 3;
+
+enum Region {
+  k_region_unknown = 0,
+  k_region_sram,
+  k_region_flash,
+  k_region_sdram,
+  // Register holding no address, or not yet visited by the dataflow
+  k_region_none
+};
+
+enum Kind {
+  k_kind_plain = 0,
+  k_kind_branch,
+  k_kind_call,
+  k_kind_indirect_call,
+  k_kind_return,
+  k_kind_indirect_jump,
+  k_kind_table_jump
+};
+
+struct Insn {
+  uint32_t addr;
+  std::string op;    // mnemonic without width suffix
+  std::string base;  // mnemonic without width, data type and condition suffixes
+  std::string args;
+  std::string src;   // last source line printed before the instruction
+  Kind kind;
+  bool cond;
+  uint32_t target;
+  bool has_target;
+};
+
+struct Config {
+  double mhz;
+  uint32_t flash_ws;
+  uint32_t sdram_ws;
+  uint32_t frames;
+  uint32_t external_cycles;
+  std::map<uint32_t, uint32_t> loop_bounds;
+  std::map<std::string, uint32_t> external_costs;
+};
+
+struct Edge {
+  int to;
+  uint32_t penalty;
+};
+
+struct Block {
+  uint32_t first;  // instruction indexes
+  uint32_t last;
+  std::vector<Edge> succ;
+  bool ret;
+  // Cycles with unknown accesses in SRAM, and count of unknown accesses
+  uint64_t cycles;
+  uint32_t unknown;
+  uint64_t callee_cycles[2];
+};
+
+/* Node of a loop level: block, or loop collapsed into a single node */
+struct Node {
+  int block;  // -1 for loops
+  int loop;
+  std::vector<Edge> succ;
+  bool ret;
+};
+
+struct Loop {
+  int header;  // block
+  std::vector<int> blocks;
+  uint32_t bound;
+  bool contract;
+  // Node ids of members at collapse time, header node first
+  std::vector<int> members;
+  int node;
+  uint64_t iteration[2];
+  uint64_t exit[2];
+};
+
+struct Function {
+  std::string name;
+  uint32_t addr;
+  std::vector<Insn> insns;
+  std::vector<Block> blocks;
+  std::vector<Node> nodes;
+  std::vector<Loop> loops;
+  int top;  // entry node of the fully collapsed graph
+  int state;  // 0: not analyzed, 1: in progress, 2: done, -1: failed
+  std::string error;
+  uint64_t wcet[2];
+  std::set<std::string> externals;
+  std::set<std::string> callees;
+};
+
+static std::vector<Function> s_funcs;
+static std::map<uint32_t, int> s_func_at;
+static std::map<uint32_t, uint32_t> s_literals;
+static Config s_config;
+
+/*===========================================================================*/
+/* Listing parser.                                                           */
+/*===========================================================================*/
+
+static bool is_cond(const std::string &s) {
+  static const char *conds[] = {"eq", "ne", "cs", "cc", "hs", "lo", "mi", "pl", "vs", "vc", "hi", "ls", "ge", "lt",
+                                "gt", "le", NULL};
+  for (const char **c = conds; *c != NULL; ++c)
+    if (s == *c)
+      return true;
+  return false;
+}
+
+static uint32_t parse_hex(const char *s, bool *ok) {
+  char *end;
+  const unsigned long v = strtoul(s, &end, 16);
+  *ok = (end != s);
+  return (uint32_t)v;
+}
+
+static Region region_of(uint32_t addr) {
+  if ((addr >> 24) == 0x08)
+    return k_region_flash;
+  if ((addr >> 28) == 0x2)
+    return k_region_sram;
+  if ((addr >> 28) == 0xC)
+    return k_region_sdram;
+  return k_region_unknown;
+}
+
+/* Mnemonic families, condition suffix allowed after the family when listed with a trailing '?' */
+static bool family(const std::string &base, const char *name) {
+  const size_t n = strlen(name);
+  if (base.compare(0, n, name) != 0)
+    return false;
+  const std::string rest = base.substr(n);
+  return rest.empty() || is_cond(rest) || rest == "s" || (rest.size() == 4 && is_cond(rest.substr(0, 2)));
+}
+
+static void classify(Insn &in) {
+  const std::string &b = in.base;
+  in.kind = k_kind_plain;
+  in.cond = false;
+
+  if (b == "b" || (b.size() == 3 && b[0] == 'b' && is_cond(b.substr(1)))) {
+    in.kind = k_kind_branch;
+    in.cond = (b.size() == 3);
+  }
+  else if (b == "cbz" || b == "cbnz") {
+    in.kind = k_kind_branch;
+    in.cond = true;
+  }
+  else if (b == "bl" || b == "blx") {
+    in.kind = (in.args.size() && in.args[0] == 'r') ? k_kind_indirect_call : k_kind_call;
+  }
+  else if (b == "bx" || (b.size() == 4 && b.compare(0, 2, "bx") == 0 && is_cond(b.substr(2)))) {
+    in.kind = (in.args.compare(0, 2, "lr") == 0) ? k_kind_return : k_kind_indirect_jump;
+    in.cond = (b.size() == 4);
+  }
+  else if (b == "tbb" || b == "tbh") {
+    in.kind = k_kind_table_jump;
+  }
+  else if ((family(b, "pop") || family(b, "ldm") || family(b, "ldmia") || family(b, "ldmfd"))
+           && in.args.find("pc}") != std::string::npos) {
+    in.kind = k_kind_return;
+    in.cond = (b != "pop" && b != "ldm" && b != "ldmia" && b != "ldmfd");
+  }
+  else if (family(b, "ldr") && in.args.compare(0, 3, "pc,") == 0) {
+    in.kind = k_kind_indirect_jump;
+  }
+  else if ((family(b, "mov") || family(b, "add")) && in.args.compare(0, 3, "pc,") == 0) {
+    in.kind = k_kind_indirect_jump;
+  }
+
+  if (in.kind == k_kind_branch || in.kind == k_kind_call) {
+    // Target is the first hexadecimal operand, after the register of cbz/cbnz
+    const char *p = in.args.c_str();
+    if (b == "cbz" || b == "cbnz") {
+      p = strchr(p, ',');
+      p = (p != NULL) ? p + 1 : in.args.c_str();
+    }
+    while (*p == ' ')
+      ++p;
+    bool ok;
+    in.target = parse_hex(p, &ok);
+    in.has_target = ok;
+    if (!ok && in.kind == k_kind_call)
+      in.kind = k_kind_indirect_call;
+  }
+}
+
+static int parse_listing(const char *path) {
+  FILE *fp = fopen(path, "r");
+  if (fp == NULL) {
+    perror(path);
+    return -1;
+  }
+
+  char line[1024];
+  std::string src;
+  Function *f = NULL;
+
+  while (fgets(line, sizeof(line), fp) != NULL) {
+    line[strcspn(line, "\r\n")] = '\0';
+
+    // Symbol: "20000010 <_hook_cycle>:"
+    unsigned long addr;
+    char name[512];
+    if (sscanf(line, "%lx <%511[^>]>:", &addr, name) == 2 && strstr(line, ">:") != NULL && line[0] != ' ') {
+      s_funcs.push_back(Function());
+      f = &s_funcs.back();
+      f->name = name;
+      f->addr = (uint32_t)addr;
+      f->state = 0;
+      f->top = -1;
+      src.clear();
+      continue;
+    }
+
+    // Instruction: "2000001a:\t2a00      \tcmp\tr2, #0"
+    char *colon = strchr(line, ':');
+    char *tab = (colon != NULL) ? strchr(colon, '\t') : NULL;
+    bool ok = false;
+    const uint32_t iaddr = (colon != NULL && colon != line) ? parse_hex(line, &ok) : 0;
+    if (!ok || tab == NULL || colon[1] != '\t' || strspn(line, " 0123456789abcdef") != (size_t)(colon - line)) {
+      // Source line, kept for annotations
+      const char *p = line;
+      while (isspace((unsigned char)*p))
+        ++p;
+      if (*p && strcmp(p, "...") != 0 && p[strlen(p) - 1] != ':')
+        src = p;
+      continue;
+    }
+
+    // Fields: address, encoding, mnemonic, operands
+    char *fields[4] = {NULL, NULL, NULL, NULL};
+    uint32_t nf = 0;
+    for (char *p = colon + 1; p != NULL && nf < 4; ) {
+      p += strspn(p, "\t");
+      if (*p == '\0')
+        break;
+      fields[nf++] = p;
+      p = strchr(p, '\t');
+      if (p != NULL)
+        *p++ = '\0';
+    }
+    if (nf < 2)
+      continue;
+
+    const char *enc = fields[0];
+    std::string op = fields[1];
+    std::string args = (nf > 2) ? fields[2] : "";
+    if (nf > 3) {
+      args += "\t";
+      args += fields[3];
+    }
+
+    if (op == ".word" || op == ".short" || op == ".byte") {
+      bool vok;
+      const char *v = args.c_str();
+      if (strncmp(v, "0x", 2) == 0)
+        v += 2;
+      const uint32_t value = parse_hex(v, &vok);
+      if (op == ".word" && vok)
+        s_literals[iaddr] = value;
+      else if (op == ".word") {
+        // Undecoded encodings of literals, "c0420000 \t.word\t..." kept from the raw bytes
+        s_literals[iaddr] = parse_hex(enc, &vok);
+      }
+      continue;
+    }
+
+    if (f == NULL)
+      continue;
+
+    Insn in;
+    in.addr = iaddr;
+    const size_t w = op.rfind(".n");
+    if (w != std::string::npos && w + 2 == op.size())
+      op.erase(w);
+    else if (op.size() > 2 && op.compare(op.size() - 2, 2, ".w") == 0)
+      op.erase(op.size() - 2);
+    in.op = op;
+    in.base = op.substr(0, op.find('.'));
+    in.args = args;
+    in.src = src;
+    in.target = 0;
+    in.has_target = false;
+    classify(in);
+    f->insns.push_back(in);
+  }
+
+  fclose(fp);
+
+  for (size_t i = 0; i < s_funcs.size(); ++i)
+    s_func_at[s_funcs[i].addr] = (int)i;
+  return 0;
+}
+
+/*===========================================================================*/
+/* Cycle model.                                                              */
+/*===========================================================================*/
+
+/* Words transferred by a register list: "{r4, r5, lr}", "{s16-s21}", "{d8}" */
+static uint32_t list_words(const std::string &args) {
+  const size_t open = args.find('{'), close = args.find('}');
+  if (open == std::string::npos || close == std::string::npos)
+    return 1;
+  uint32_t n = 0;
+  const std::string list = args.substr(open + 1, close - open - 1);
+  for (size_t p = 0; p < list.size(); ) {
+    size_t q = list.find(',', p);
+    if (q == std::string::npos)
+      q = list.size();
+    std::string item = list.substr(p, q - p);
+    item.erase(0, item.find_first_not_of(' '));
+    const size_t dash = item.find('-');
+    const uint32_t words = (item[0] == 'd') ? 2 : 1;
+    if (dash != std::string::npos) {
+      const int a = atoi(item.c_str() + 1), b = atoi(item.c_str() + dash + 2);
+      n += (uint32_t)(b - a + 1) * words;
+    }
+    else
+      n += words;
+    p = q + 1;
+  }
+  return n ? n : 1;
+}
+
+static bool is_load_store(const std::string &b) {
+  return family(b, "ldr") || family(b, "str") || b.compare(0, 3, "ldr") == 0 || b.compare(0, 3, "str") == 0
+    || b.compare(0, 3, "ldm") == 0 || b.compare(0, 3, "stm") == 0 || b.compare(0, 4, "vldr") == 0
+    || b.compare(0, 4, "vstr") == 0 || b.compare(0, 4, "vldm") == 0 || b.compare(0, 4, "vstm") == 0;
+}
+
+/* Base cycles of an instruction, branches not taken */
+static uint32_t insn_cycles(const Insn &in) {
+  const std::string &b = in.base;
+
+  if (in.kind == k_kind_call || in.kind == k_kind_indirect_call)
+    return 1 + k_refill;
+  if (in.kind == k_kind_return)
+    return (b.compare(0, 2, "bx") == 0) ? 1 + k_refill : 1 + list_words(in.args) + k_refill;
+  if (in.kind == k_kind_indirect_jump)
+    return 2 + k_refill;
+  if (in.kind == k_kind_table_jump)
+    return 2 + k_refill;
+  if (in.kind == k_kind_branch)
+    return 1;
+
+  if (b.compare(0, 4, "vdiv") == 0 || b.compare(0, 5, "vsqrt") == 0)
+    return 14;
+  if (family(b, "vmla") || family(b, "vmls") || family(b, "vnmla") || family(b, "vnmls") || family(b, "vfma")
+      || family(b, "vfms") || family(b, "vfnma") || family(b, "vfnms"))
+    return 3;
+  if (b.compare(0, 4, "vldr") == 0 || b.compare(0, 4, "vstr") == 0)
+    return 2;
+  if (b.compare(0, 4, "vldm") == 0 || b.compare(0, 4, "vstm") == 0 || b.compare(0, 5, "vpush") == 0
+      || b.compare(0, 4, "vpop") == 0)
+    return 1 + list_words(in.args);
+  if (family(b, "sdiv") || family(b, "udiv"))
+    return 12;
+  if (family(b, "mla") || family(b, "mls"))
+    return 2;
+  if (b.compare(0, 4, "ldrd") == 0 || b.compare(0, 4, "strd") == 0)
+    return 3;
+  if (b.compare(0, 3, "ldm") == 0 || b.compare(0, 3, "stm") == 0 || family(b, "push") || family(b, "pop"))
+    return 1 + list_words(in.args);
+  if (b.compare(0, 3, "ldr") == 0 || b.compare(0, 3, "str") == 0)
+    return 2;
+  return 1;
+}
+
+/* Register number of "r0".."r12", "sl", "fp", "ip", "sp", "lr", "pc", -1 otherwise */
+static int reg_index(const char *s) {
+  if (s[0] == 'r' && isdigit((unsigned char)s[1]))
+    return atoi(s + 1);
+  static const char *names[] = {"sb", "sl", "fp", "ip", "sp", "lr", "pc"};
+  static const int index[] = {9, 10, 11, 12, 13, 14, 15};
+  for (int i = 0; i < 7; ++i)
+    if (strncmp(s, names[i], 2) == 0)
+      return index[i];
+  return -1;
+}
+
+/* Operand registers: destination, first source, memory base */
+static void operands(const Insn &in, int *rd, int *rn, int *base) {
+  *rd = *rn = *base = -1;
+  const char *p = in.args.c_str();
+  *rd = reg_index(p);
+  const char *comma = strchr(p, ',');
+  if (comma != NULL) {
+    const char *q = comma + 1;
+    while (*q == ' ')
+      ++q;
+    *rn = reg_index(q);
+  }
+  const char *bracket = strchr(p, '[');
+  if (bracket != NULL)
+    *base = reg_index(bracket + 1);
+  else if (in.base.compare(0, 3, "ldm") == 0 || in.base.compare(0, 3, "stm") == 0
+           || in.base.compare(0, 4, "vldm") == 0 || in.base.compare(0, 4, "vstm") == 0)
+    *base = reg_index(p);
+}
+
+/* PC relative literal address from the listing comment: "; (20000080 <f+0x80>)" or "@ (...)" */
+static bool literal_value(const Insn &in, uint32_t *value) {
+  const size_t c = in.args.find("(");
+  if (in.args.find("[pc") == std::string::npos || c == std::string::npos)
+    return false;
+  bool ok;
+  const uint32_t addr = parse_hex(in.args.c_str() + c + 1, &ok);
+  std::map<uint32_t, uint32_t>::const_iterator it = s_literals.find(addr);
+  if (!ok || it == s_literals.end())
+    return false;
+  *value = it->second;
+  return true;
+}
+
+static bool immediate(const Insn &in, uint32_t *value) {
+  const size_t h = in.args.find('#');
+  if (h == std::string::npos)
+    return false;
+  *value = (uint32_t)strtol(in.args.c_str() + h + 1, NULL, 0);
+  return true;
+}
+
+struct RegState {
+  uint8_t region[16];
+  uint32_t value[16];
+  bool known[16];
+};
+
+/* Update register regions after an instruction, and return the region of its memory access */
+static Region step(RegState &s, const Insn &in) {
+  int rd, rn, base;
+  operands(in, &rd, &rn, &base);
+  const std::string &b = in.base;
+  Region access = k_region_none;
+
+  if (is_load_store(b) || b.compare(0, 4, "push") == 0 || b.compare(0, 3, "pop") == 0
+      || b.compare(0, 5, "vpush") == 0 || b.compare(0, 4, "vpop") == 0) {
+    if (base == 15 || base == 13 || b.compare(0, 4, "push") == 0 || b.compare(0, 3, "pop") == 0
+        || b.compare(0, 5, "vpush") == 0 || b.compare(0, 4, "vpop") == 0)
+      access = k_region_sram;
+    else if (base >= 0)
+      access = (s.region[base] == k_region_none) ? k_region_unknown : (Region)s.region[base];
+  }
+
+  const bool writes_rd = rd >= 0 && b.compare(0, 3, "str") != 0 && b.compare(0, 3, "stm") != 0
+    && b.compare(0, 3, "cmp") != 0 && b.compare(0, 3, "cmn") != 0 && b.compare(0, 3, "tst") != 0
+    && b.compare(0, 3, "teq") != 0 && b.compare(0, 4, "push") != 0 && b[0] != 'v' && b[0] != 'b'
+    && b.compare(0, 2, "it") != 0 && b.compare(0, 3, "cbz") != 0 && b.compare(0, 4, "cbnz") != 0;
+
+  uint32_t v;
+  if (in.kind == k_kind_call || in.kind == k_kind_indirect_call) {
+    // Caller saved registers
+    static const int clobbered[] = {0, 1, 2, 3, 12, 14};
+    for (int i = 0; i < 6; ++i) {
+      s.region[clobbered[i]] = k_region_unknown;
+      s.known[clobbered[i]] = false;
+    }
+  }
+  else if (b.compare(0, 3, "ldm") == 0 || b.compare(0, 3, "pop") == 0) {
+    // Loaded registers of the list
+    const size_t open = in.args.find('{');
+    for (size_t p = open; p != std::string::npos && p < in.args.size(); p = in.args.find_first_of(",-", p + 1)) {
+      const size_t q = in.args.find_first_not_of(" ,-{", p);
+      const int r = (q != std::string::npos) ? reg_index(in.args.c_str() + q) : -1;
+      if (r >= 0 && r < 13) {
+        s.region[r] = k_region_unknown;
+        s.known[r] = false;
+      }
+    }
+  }
+  else if (b == "vmov" && rd >= 0) {
+    s.region[rd] = k_region_unknown;
+    s.known[rd] = false;
+  }
+  else if (writes_rd && rd < 13) {
+    if (b.compare(0, 3, "ldr") == 0 && base == 15 && literal_value(in, &v)) {
+      s.region[rd] = region_of(v);
+      s.value[rd] = v;
+      s.known[rd] = true;
+    }
+    else if (b.compare(0, 4, "movw") == 0 && immediate(in, &v)) {
+      s.value[rd] = v & 0xFFFF;
+      s.known[rd] = true;
+      s.region[rd] = k_region_unknown;
+    }
+    else if (b.compare(0, 4, "movt") == 0 && immediate(in, &v) && s.known[rd]) {
+      s.value[rd] = (s.value[rd] & 0xFFFF) | (v << 16);
+      s.region[rd] = region_of(s.value[rd]);
+    }
+    else if ((family(b, "add") || family(b, "sub") || family(b, "mov") || family(b, "adds") || family(b, "subs"))
+             && rn >= 0 && rn < 13 && s.region[rn] != k_region_none && s.region[rn] != k_region_unknown) {
+      // Address arithmetic keeps the region of its base
+      s.region[rd] = s.region[rn];
+      s.known[rd] = false;
+    }
+    else if ((family(b, "add") || family(b, "sub")) && rn >= 0 && strchr(in.args.c_str(), ',') != NULL
+             && strchr(strchr(in.args.c_str(), ',') + 1, ',') == NULL) {
+      // Two operand form "add rd, rm" keeps the region of rd
+      s.known[rd] = false;
+    }
+    else {
+      s.region[rd] = k_region_unknown;
+      s.known[rd] = false;
+    }
+  }
+
+  return access;
+}
+
+/*===========================================================================*/
+/* Control flow graph.                                                       */
+/*===========================================================================*/
+
+static int analyze(int fi);
+
+static bool build_blocks(Function &f) {
+  const uint32_t n = (uint32_t)f.insns.size();
+  if (n == 0) {
+    f.error = "no instructions";
+    return false;
+  }
+
+  std::map<uint32_t, uint32_t> index;
+  for (uint32_t i = 0; i < n; ++i)
+    index[f.insns[i].addr] = i;
+
+  std::vector<bool> leader(n, false);
+  leader[0] = true;
+  for (uint32_t i = 0; i < n; ++i) {
+    const Insn &in = f.insns[i];
+    if (in.kind == k_kind_table_jump) {
+      char buf[64];
+      snprintf(buf, sizeof(buf), "jump table at %08x", (unsigned)in.addr);
+      f.error = buf;
+      return false;
+    }
+    if (in.kind == k_kind_branch || in.kind == k_kind_return || in.kind == k_kind_indirect_jump) {
+      if (i + 1 < n)
+        leader[i + 1] = true;
+      if (in.kind == k_kind_branch && in.has_target && index.count(in.target))
+        leader[index[in.target]] = true;
+    }
+  }
+
+  std::vector<int> block_of(n, -1);
+  for (uint32_t i = 0; i < n; ++i) {
+    if (leader[i]) {
+      Block b;
+      b.first = i;
+      b.ret = false;
+      b.cycles = 0;
+      b.unknown = 0;
+      b.callee_cycles[0] = b.callee_cycles[1] = 0;
+      f.blocks.push_back(b);
+    }
+    f.blocks.back().last = i;
+    block_of[i] = (int)f.blocks.size() - 1;
+  }
+
+  for (size_t bi = 0; bi < f.blocks.size(); ++bi) {
+    Block &b = f.blocks[bi];
+    const Insn &in = f.insns[b.last];
+    const bool falls = (in.kind != k_kind_branch && in.kind != k_kind_return && in.kind != k_kind_indirect_jump)
+      || in.cond;
+
+    if (in.kind == k_kind_branch && in.has_target) {
+      if (index.count(in.target)) {
+        Edge e = {block_of[index[in.target]], k_refill};
+        b.succ.push_back(e);
+      }
+      else if (!in.cond) {
+        // Tail call
+        b.ret = true;
+      }
+      else {
+        f.error = "conditional branch out of the function";
+        return false;
+      }
+    }
+    if (in.kind == k_kind_return)
+      b.ret = true;
+    if (in.kind == k_kind_indirect_jump) {
+      f.error = "indirect jump";
+      return false;
+    }
+    if (falls) {
+      if (b.last + 1 < n) {
+        Edge e = {block_of[b.last + 1], 0};
+        b.succ.push_back(e);
+      }
+      else
+        b.ret = true;
+    }
+  }
+  return true;
+}
+
+static uint64_t call_cost(Function &f, const Insn &in, int bound) {
+  if (in.kind == k_kind_indirect_call) {
+    f.externals.insert("indirect call");
+    return s_config.external_cycles;
+  }
+
+  std::map<uint32_t, int>::const_iterator it = s_func_at.find(in.target);
+  if (it == s_func_at.end() || s_funcs[it->second].insns.empty()) {
+    // Firmware API, outside of the listing
+    const size_t lt = in.args.find('<'), gt = in.args.find('>');
+    const std::string name = (lt != std::string::npos && gt != std::string::npos)
+      ? in.args.substr(lt + 1, gt - lt - 1) : in.args;
+    std::map<std::string, uint32_t>::const_iterator c = s_config.external_costs.find(name);
+    f.externals.insert(name);
+    return (c != s_config.external_costs.end()) ? c->second : s_config.external_cycles;
+  }
+
+  if (analyze(it->second) != 0) {
+    f.error = "callee " + s_funcs[it->second].name + ": " + s_funcs[it->second].error;
+    return 0;
+  }
+  const Function &callee = s_funcs[it->second];
+  f.callees.insert(callee.name);
+  f.externals.insert(callee.externals.begin(), callee.externals.end());
+  return callee.wcet[bound];
+}
+
+/* Block costs with a region dataflow over the function */
+static bool block_costs(Function &f) {
+  const size_t nb = f.blocks.size();
+  std::vector<RegState> in_state(nb);
+  std::vector<bool> visited(nb, false);
+
+  RegState entry;
+  for (int r = 0; r < 16; ++r) {
+    entry.region[r] = k_region_unknown;
+    entry.known[r] = false;
+    entry.value[r] = 0;
+  }
+  entry.region[13] = k_region_sram;
+  in_state[0] = entry;
+  visited[0] = true;
+
+  std::vector<int> work(1, 0);
+  while (!work.empty()) {
+    const int bi = work.back();
+    work.pop_back();
+    RegState s = in_state[bi];
+    for (uint32_t i = f.blocks[bi].first; i <= f.blocks[bi].last; ++i)
+      step(s, f.insns[i]);
+    for (size_t e = 0; e < f.blocks[bi].succ.size(); ++e) {
+      const int to = f.blocks[bi].succ[e].to;
+      if (!visited[to]) {
+        in_state[to] = s;
+        visited[to] = true;
+        work.push_back(to);
+        continue;
+      }
+      bool changed = false;
+      RegState &t = in_state[to];
+      for (int r = 0; r < 16; ++r) {
+        if (t.region[r] != s.region[r] && t.region[r] != k_region_unknown) {
+          t.region[r] = k_region_unknown;
+          changed = true;
+        }
+        if (t.known[r] && (!s.known[r] || s.value[r] != t.value[r])) {
+          t.known[r] = false;
+          changed = true;
+        }
+      }
+      if (changed)
+        work.push_back(to);
+    }
+  }
+
+  for (size_t bi = 0; bi < nb; ++bi) {
+    Block &b = f.blocks[bi];
+    RegState s = in_state[bi];
+    for (uint32_t i = b.first; i <= b.last; ++i) {
+      const Insn &in = f.insns[i];
+      uint32_t words = 1;
+      if (in.base.compare(0, 3, "ldm") == 0 || in.base.compare(0, 3, "stm") == 0
+          || in.base.compare(0, 4, "vldm") == 0 || in.base.compare(0, 4, "vstm") == 0)
+        words = list_words(in.args);
+      else if (in.base.compare(0, 4, "ldrd") == 0 || in.base.compare(0, 4, "strd") == 0
+               || (in.base.compare(0, 4, "vldr") == 0 && in.args[0] == 'd')
+               || (in.base.compare(0, 4, "vstr") == 0 && in.args[0] == 'd'))
+        words = 2;
+
+      b.cycles += insn_cycles(in);
+      switch (step(s, in)) {
+      case k_region_flash:   b.cycles += (uint64_t)words * s_config.flash_ws; break;
+      case k_region_sdram:   b.cycles += (uint64_t)words * s_config.sdram_ws; break;
+      case k_region_unknown: b.unknown += words; break;
+      default: break;
+      }
+
+      if (in.kind == k_kind_call || in.kind == k_kind_indirect_call
+          || (in.kind == k_kind_branch && !in.cond && b.ret && i == b.last)) {
+        b.callee_cycles[0] += call_cost(f, in, 0);
+        b.callee_cycles[1] += call_cost(f, in, 1);
+        if (!f.error.empty())
+          return false;
+      }
+    }
+  }
+  return true;
+}
+
+/* Dominator sets as bit vectors, blocks unreachable from the entry dominated by nothing */
+static std::vector<std::vector<bool> > dominators(const Function &f) {
+  const size_t nb = f.blocks.size();
+  std::vector<std::vector<int> > pred(nb);
+  for (size_t b = 0; b < nb; ++b)
+    for (size_t e = 0; e < f.blocks[b].succ.size(); ++e)
+      pred[f.blocks[b].succ[e].to].push_back((int)b);
+
+  std::vector<std::vector<bool> > dom(nb, std::vector<bool>(nb, true));
+  dom[0].assign(nb, false);
+  dom[0][0] = true;
+
+  for (bool changed = true; changed; ) {
+    changed = false;
+    for (size_t b = 1; b < nb; ++b) {
+      std::vector<bool> d(nb, !pred[b].empty());
+      for (size_t p = 0; p < pred[b].size(); ++p)
+        for (size_t i = 0; i < nb; ++i)
+          d[i] = d[i] && dom[pred[b][p]][i];
+      d[b] = true;
+      if (d != dom[b]) {
+        dom[b] = d;
+        changed = true;
+      }
+    }
+  }
+  return dom;
+}
+
+static bool find_loops(Function &f) {
+  const size_t nb = f.blocks.size();
+  const std::vector<std::vector<bool> > dom = dominators(f);
+
+  std::map<int, std::set<int> > bodies;
+  for (size_t b = 0; b < nb; ++b) {
+    for (size_t e = 0; e < f.blocks[b].succ.size(); ++e) {
+      const int h = f.blocks[b].succ[e].to;
+      if (f.insns[f.blocks[h].first].addr > f.insns[f.blocks[b].last].addr)
+        continue;
+      if (!dom[b][h]) {
+        f.error = "irreducible loop";
+        return false;
+      }
+      // Natural loop of the back edge
+      std::set<int> &body = bodies[h];
+      body.insert(h);
+      std::vector<int> stack;
+      if (body.insert((int)b).second)
+        stack.push_back((int)b);
+      while (!stack.empty()) {
+        const int x = stack.back();
+        stack.pop_back();
+        for (size_t p = 0; p < nb; ++p)
+          for (size_t pe = 0; pe < f.blocks[p].succ.size(); ++pe)
+            if (f.blocks[p].succ[pe].to == x && body.insert((int)p).second)
+              stack.push_back((int)p);
+      }
+    }
+  }
+
+  for (std::map<int, std::set<int> >::const_iterator it = bodies.begin(); it != bodies.end(); ++it) {
+    Loop l;
+    l.header = it->first;
+    l.blocks.assign(it->second.begin(), it->second.end());
+    const uint32_t addr = f.insns[f.blocks[l.header].first].addr;
+    std::map<uint32_t, uint32_t>::const_iterator bound = s_config.loop_bounds.find(addr);
+    l.contract = (bound == s_config.loop_bounds.end());
+    l.bound = l.contract ? s_config.frames : bound->second;
+    l.node = -1;
+    f.loops.push_back(l);
+  }
+
+  // Innermost first
+  std::sort(f.loops.begin(), f.loops.end(), [](const Loop &a, const Loop &b) {
+    return a.blocks.size() < b.blocks.size();
+  });
+  return true;
+}
+
+/*===========================================================================*/
+/* Longest paths.                                                            */
+/*===========================================================================*/
+
+static uint64_t node_cost(const Function &f, int n, int bound) {
+  const Node &node = f.nodes[n];
+  if (node.block >= 0) {
+    const Block &b = f.blocks[node.block];
+    return b.cycles + (bound ? (uint64_t)b.unknown * s_config.sdram_ws : 0) + b.callee_cycles[bound];
+  }
+  const Loop &l = f.loops[node.loop];
+  return l.bound * l.iteration[bound] + l.exit[bound];
+}
+
+/*
+ * Longest path from a node within a set of members. Edges to the sink node (loop header) end an iteration, edges
+ * leaving the members end the path when exits count.
+ */
+static uint64_t longest(const Function &f, int n, const std::set<int> &members, int sink, bool exits, int bound,
+                        std::map<int, uint64_t> &memo, std::map<int, int> *choice) {
+  std::map<int, uint64_t>::const_iterator it = memo.find(n);
+  if (it != memo.end())
+    return it->second;
+
+  const Node &node = f.nodes[n];
+  uint64_t best = 0;
+  int best_edge = -2;
+  bool any = false;
+  if (node.ret && exits) {
+    any = true;
+    best_edge = -1;
+  }
+  for (size_t e = 0; e < node.succ.size(); ++e) {
+    const int to = node.succ[e].to;
+    uint64_t v;
+    if (to == sink)
+      v = exits ? 0 : node.succ[e].penalty;
+    else if (!members.count(to))
+      v = exits ? node.succ[e].penalty : 0;
+    else
+      v = node.succ[e].penalty + longest(f, to, members, sink, exits, bound, memo, choice);
+    if ((to == sink && exits) || (!members.count(to) && to != sink && !exits))
+      continue;
+    if (!any || v > best) {
+      best = v;
+      best_edge = (int)e;
+      any = true;
+    }
+  }
+
+  const uint64_t total = node_cost(f, n, bound) + best;
+  memo[n] = total;
+  if (choice != NULL)
+    (*choice)[n] = best_edge;
+  return total;
+}
+
+static bool collapse(Function &f) {
+  const size_t nb = f.blocks.size();
+  std::vector<int> rep(nb);
+
+  for (size_t b = 0; b < nb; ++b) {
+    Node n;
+    n.block = (int)b;
+    n.loop = -1;
+    n.ret = f.blocks[b].ret;
+    f.nodes.push_back(n);
+    rep[b] = (int)b;
+  }
+  for (size_t b = 0; b < nb; ++b)
+    f.nodes[b].succ = f.blocks[b].succ;
+
+  for (size_t li = 0; li < f.loops.size(); ++li) {
+    Loop &l = f.loops[li];
+    std::set<int> members;
+    for (size_t i = 0; i < l.blocks.size(); ++i)
+      members.insert(rep[l.blocks[i]]);
+    const int header = rep[l.header];
+    l.members.assign(1, header);
+    for (std::set<int>::const_iterator it = members.begin(); it != members.end(); ++it)
+      if (*it != header)
+        l.members.push_back(*it);
+
+    for (int bound = 0; bound < 2; ++bound) {
+      std::map<int, uint64_t> memo_iter, memo_exit;
+      // Iteration: header back to the header, without the header as an inner member
+      std::set<int> inner = members;
+      l.iteration[bound] = longest(f, header, inner, header, false, bound, memo_iter, NULL);
+      l.exit[bound] = longest(f, header, inner, header, true, bound, memo_exit, NULL);
+    }
+
+    Node n;
+    n.block = -1;
+    n.loop = (int)li;
+    n.ret = false;
+    for (std::set<int>::const_iterator it = members.begin(); it != members.end(); ++it) {
+      const Node &m = f.nodes[*it];
+      n.ret = n.ret || m.ret;
+      for (size_t e = 0; e < m.succ.size(); ++e)
+        if (!members.count(m.succ[e].to))
+          n.succ.push_back(m.succ[e]);
+    }
+    l.node = (int)f.nodes.size();
+    f.nodes.push_back(n);
+
+    for (size_t b = 0; b < nb; ++b)
+      if (members.count(rep[b]))
+        rep[b] = l.node;
+    // Edges into the loop now reach the collapsed node
+    for (size_t k = 0; k < f.nodes.size(); ++k)
+      for (size_t e = 0; e < f.nodes[k].succ.size(); ++e)
+        if (members.count(f.nodes[k].succ[e].to) && !members.count((int)k))
+          f.nodes[k].succ[e].to = l.node;
+  }
+
+  f.top = rep[0];
+  return true;
+}
+
+static int analyze(int fi) {
+  Function &f = s_funcs[fi];
+  if (f.state == 2)
+    return 0;
+  if (f.state == -1)
+    return -1;
+  if (f.state == 1) {
+    f.error = "recursion";
+    return -1;
+  }
+  f.state = 1;
+
+  if (!build_blocks(f) || !block_costs(f) || !find_loops(f) || !collapse(f)) {
+    f.state = -1;
+    return -1;
+  }
+
+  std::set<int> all;
+  for (size_t n = 0; n < f.nodes.size(); ++n)
+    all.insert((int)n);
+  for (int bound = 0; bound < 2; ++bound) {
+    std::map<int, uint64_t> memo;
+    f.wcet[bound] = longest(f, f.top, all, -1, true, bound, memo, NULL);
+  }
+
+  f.state = 2;
+  return 0;
+}
+
+/*===========================================================================*/
+/* Worst-case path report.                                                   */
+/*===========================================================================*/
+
+struct Hot {
+  int block;
+  uint64_t executions;
+  uint64_t cycles;
+};
+
+struct Decision {
+  int block;
+  uint64_t executions;
+  uint64_t delta;
+  bool taken;
+};
+
+/* Walk the worst-case path of a set of members, multiplying executions through loops */
+static void walk(const Function &f, int start, const std::set<int> &members, int sink, bool exits, uint64_t mult,
+                 std::map<int, Hot> &hot, std::vector<Decision> &decisions) {
+  std::map<int, uint64_t> memo;
+  std::map<int, int> choice;
+  longest(f, start, members, sink, exits, 0, memo, &choice);
+
+  for (int n = start; n >= 0 && members.count(n); ) {
+    const Node &node = f.nodes[n];
+    if (node.block >= 0) {
+      const Block &b = f.blocks[node.block];
+      Hot &h = hot[node.block];
+      h.block = node.block;
+      h.executions += mult;
+      h.cycles += mult * (b.cycles + b.callee_cycles[0]);
+    }
+    else {
+      const Loop &l = f.loops[node.loop];
+      std::set<int> inner(l.members.begin(), l.members.end());
+      walk(f, l.members[0], inner, l.members[0], false, mult * l.bound, hot, decisions);
+      walk(f, l.members[0], inner, l.members[0], true, mult, hot, decisions);
+    }
+
+    const int e = choice[n];
+    if (e < 0)
+      break;
+
+    // Refill of a taken branch, on the block it leaves or on the header of a loop left through it
+    const int from = (node.block >= 0) ? node.block : f.loops[node.loop].header;
+    Hot &h = hot[from];
+    h.block = from;
+    h.cycles += mult * node.succ[e].penalty;
+
+    // Conditional branches where the worst case takes the costlier side
+    if (node.block >= 0 && node.succ.size() == 2) {
+      uint64_t v[2];
+      bool valid[2];
+      for (int k = 0; k < 2; ++k) {
+        const int to = node.succ[k].to;
+        valid[k] = true;
+        if (to == sink)
+          v[k] = exits ? 0 : node.succ[k].penalty, valid[k] = !exits;
+        else if (!members.count(to))
+          v[k] = node.succ[k].penalty, valid[k] = exits;
+        else
+          v[k] = node.succ[k].penalty + memo[to];
+      }
+      if (valid[0] && valid[1] && v[0] != v[1]) {
+        Decision d;
+        d.block = node.block;
+        d.executions = mult;
+        d.delta = (v[0] > v[1]) ? v[0] - v[1] : v[1] - v[0];
+        d.taken = (node.succ[e].penalty != 0);
+        decisions.push_back(d);
+      }
+    }
+
+    const int to = node.succ[e].to;
+    if (to == sink || !members.count(to))
+      break;
+    n = to;
+  }
+}
+
+static void report(const Function &f, double period_us) {
+  const double us = f.wcet[0] / s_config.mhz;
+  printf("%s: %llu cycles, %.2f us at %.0f MHz", f.name.c_str(), (unsigned long long)f.wcet[0], us, s_config.mhz);
+  if (f.name == "_hook_cycle" || f.name == "_hook_process")
+    printf(", %.1f%% of the %u frame block period", 100.0 * us / period_us, (unsigned)s_config.frames);
+  printf("\n");
+  if (f.wcet[1] != f.wcet[0])
+    printf("  %llu cycles with accesses of unknown region in SDRAM\n", (unsigned long long)f.wcet[1]);
+
+  for (size_t i = 0; i < f.loops.size(); ++i) {
+    const Loop &l = f.loops[i];
+    printf("  loop %08x: bound %u (%s), %llu cycles per iteration\n", (unsigned)f.insns[f.blocks[l.header].first].addr,
+           (unsigned)l.bound, l.contract ? "frame contract" : "given", (unsigned long long)l.iteration[0]);
+  }
+  for (std::set<std::string>::const_iterator it = f.externals.begin(); it != f.externals.end(); ++it) {
+    std::map<std::string, uint32_t>::const_iterator c = s_config.external_costs.find(*it);
+    printf("  %s: outside the listing, %u cycles assumed\n", it->c_str(),
+           (unsigned)((c != s_config.external_costs.end()) ? c->second : s_config.external_cycles));
+  }
+
+  std::set<int> all;
+  for (size_t n = 0; n < f.nodes.size(); ++n)
+    all.insert((int)n);
+  std::map<int, Hot> hot_map;
+  std::vector<Decision> decisions;
+  walk(f, f.top, all, -1, true, 1, hot_map, decisions);
+
+  std::vector<Hot> hot;
+  for (std::map<int, Hot>::const_iterator it = hot_map.begin(); it != hot_map.end(); ++it)
+    hot.push_back(it->second);
+  std::sort(hot.begin(), hot.end(), [](const Hot &a, const Hot &b) { return a.cycles > b.cycles; });
+  printf("  hottest blocks of the worst case:\n");
+  for (size_t i = 0; i < hot.size() && i < 8; ++i) {
+    const Block &b = f.blocks[hot[i].block];
+    const Insn &first = f.insns[b.first];
+    printf("    %08x-%08x %8llu cycles %5.1f%% %6llux  %s\n", (unsigned)first.addr, (unsigned)f.insns[b.last].addr,
+           (unsigned long long)hot[i].cycles, f.wcet[0] ? 100.0 * hot[i].cycles / f.wcet[0] : 0.0,
+           (unsigned long long)hot[i].executions, first.src.c_str());
+  }
+
+  // Same branch on the iteration and exit paths of a loop
+  std::map<std::pair<int, bool>, Decision> merged;
+  for (size_t i = 0; i < decisions.size(); ++i) {
+    const std::pair<int, bool> key(decisions[i].block, decisions[i].taken);
+    std::map<std::pair<int, bool>, Decision>::iterator it = merged.find(key);
+    if (it == merged.end())
+      merged[key] = decisions[i];
+    else {
+      it->second.executions += decisions[i].executions;
+      it->second.delta = std::max(it->second.delta, decisions[i].delta);
+    }
+  }
+  decisions.clear();
+  for (std::map<std::pair<int, bool>, Decision>::const_iterator it = merged.begin(); it != merged.end(); ++it)
+    decisions.push_back(it->second);
+
+  std::sort(decisions.begin(), decisions.end(), [](const Decision &a, const Decision &b) {
+    return a.delta * a.executions > b.delta * b.executions;
+  });
+  if (!decisions.empty())
+    printf("  branches deciding the worst case:\n");
+  for (size_t i = 0; i < decisions.size() && i < 5; ++i) {
+    const Decision &d = decisions[i];
+    const Insn &in = f.insns[f.blocks[d.block].last];
+    printf("    %08x %-6s %s, +%llu cycles x%llu over the other side  %s\n", (unsigned)in.addr, in.op.c_str(),
+           d.taken ? "taken" : "not taken", (unsigned long long)d.delta, (unsigned long long)d.executions,
+           in.src.c_str());
+  }
+}
+
+static void usage(const char *name) {
+  fprintf(stderr,
+          "usage: %s [options] unit.list [function ...]\n"
+          "  functions default to all _hook_* symbols\n"
+          "  -c mhz          core clock (default: 180)\n"
+          "  -f states       flash wait states of firmware table loads (default: 5)\n"
+          "  -s states       SDRAM wait states per word (default: 6)\n"
+          "  -n frames       loop bound of the frame contract (default: 64)\n"
+          "  -L addr=bound   bound of the loop with header at addr, hexadecimal\n"
+          "  -x name=cycles  cost of a function outside the listing\n"
+          "  -X cycles       default cost of functions outside the listing (default: 100)\n"
+          "  -b cycles       fail when a cycle/process hook exceeds this bound\n",
+          name);
+}
+
+int main(int argc, char **argv) {
+  s_config.mhz = 180.0;
+  s_config.flash_ws = 5;
+  s_config.sdram_ws = 6;
+  s_config.frames = 64;
+  s_config.external_cycles = 100;
+  uint64_t budget = 0;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "c:f:s:n:L:x:X:b:h")) != -1) {
+    switch (opt) {
+    case 'c': s_config.mhz = atof(optarg); break;
+    case 'f': s_config.flash_ws = (uint32_t)atoi(optarg); break;
+    case 's': s_config.sdram_ws = (uint32_t)atoi(optarg); break;
+    case 'n': s_config.frames = (uint32_t)atoi(optarg); break;
+    case 'L':
+    case 'x': {
+      char *eq = strchr(optarg, '=');
+      if (eq == NULL) {
+        usage(argv[0]);
+        return 1;
+      }
+      *eq = '\0';
+      if (opt == 'L')
+        s_config.loop_bounds[(uint32_t)strtoul(optarg, NULL, 16)] = (uint32_t)atoi(eq + 1);
+      else
+        s_config.external_costs[optarg] = (uint32_t)atoi(eq + 1);
+      break;
+    }
+    case 'X': s_config.external_cycles = (uint32_t)atoi(optarg); break;
+    case 'b': budget = strtoull(optarg, NULL, 0); break;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  if (optind >= argc || s_config.mhz <= 0 || s_config.frames == 0) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  if (parse_listing(argv[optind]) != 0)
+    return 1;
+
+  std::vector<int> entries;
+  for (int i = optind + 1; i < argc; ++i) {
+    size_t f = 0;
+    for (; f < s_funcs.size() && s_funcs[f].name != argv[i]; ++f)
+      ;
+    if (f == s_funcs.size()) {
+      fprintf(stderr, "%s: no function %s\n", argv[optind], argv[i]);
+      return 1;
+    }
+    entries.push_back((int)f);
+  }
+  if (entries.empty())
+    for (size_t f = 0; f < s_funcs.size(); ++f)
+      if (s_funcs[f].name.compare(0, 6, "_hook_") == 0)
+        entries.push_back((int)f);
+  if (entries.empty()) {
+    fprintf(stderr, "%s: no _hook_* functions\n", argv[optind]);
+    return 1;
+  }
+
+  const double period_us = 1e6 * s_config.frames / 48000.0;
+  int ret = 0;
+  for (size_t i = 0; i < entries.size(); ++i) {
+    const Function &f = s_funcs[entries[i]];
+    if (analyze(entries[i]) != 0) {
+      printf("%s: not analyzable: %s\n", f.name.c_str(), f.error.c_str());
+      ret = 1;
+      continue;
+    }
+    report(f, period_us);
+    if (budget && (f.name == "_hook_cycle" || f.name == "_hook_process") && f.wcet[0] > budget) {
+      printf("  over the %llu cycle budget\n", (unsigned long long)budget);
+      ret = 1;
+    }
+  }
+
+  return ret;
+}
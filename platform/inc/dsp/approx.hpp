@@ -0,0 +1,381 @@
+#pragma once
+/*
+    BSD 3-Clause License
+
+    Copyright (c) 2018, KORG INC.
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice, this
+      list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    * Neither the name of the copyright holder nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+    FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+    DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//*/
+
+/**
+ * @file    approx.hpp
+ * @brief   Minimax polynomial approximations with compile time selectable order.
+ *
+ * @addtogroup dsp DSP
+ * @{
+ *
+ */
+
+#include <stdint.h>
+
+#include "float_math.h"
+
+/**
+ * Common DSP Utilities
+ */
+namespace dsp {
+
+  /**
+   * Minimax polynomial approximations.
+   *
+   * Higher orders trade cycles for accuracy. Coefficients are generated with the
+   * Remez solver of platform/host/tools/minimax.cpp and errors below are before
+   * single precision rounding, see the fmath host tool for measured figures.
+   *
+   * Scalar versions are branch-free so that loops over them can be pipelined and
+   * vectorized. Block versions process 4 independent values per iteration and
+   * support in-place operation.
+   */
+  namespace approx {
+
+    /**
+     * Polynomial evaluation in Horner form, coefficients lowest degree first.
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    float horner(const float x, const float c0) {
+      (void)x;
+      return c0;
+    }
+
+    template <typename... Coeffs>
+    inline __attribute__((optimize("Ofast"),always_inline))
+    float horner(const float x, const float c0, const Coeffs... cn) {
+      return c0 + x * horner(x, cn...);
+    }
+
+    /*===========================================================================*/
+    /* Coefficients.                                                             */
+    /*===========================================================================*/
+
+    /**
+     * sin(x)/x for x^2 in [0, (pi/2)^2], kOrder is the degree of the odd sine polynomial.
+     */
+    template <uint32_t kOrder>
+    struct SinPoly {
+      static_assert(kOrder != kOrder, "Supported sine orders: 3, 5, 7, 9");
+    };
+
+    /** Max relative error 7.2e-3 */
+    template <> struct SinPoly<3> {
+      static inline __attribute__((optimize("Ofast"),always_inline))
+      float eval(const float x2) {
+        return horner(x2, 9.927877290e-01f, -1.462102902e-01f);
+      }
+    };
+
+    /** Max relative error 1.1e-4 */
+    template <> struct SinPoly<5> {
+      static inline __attribute__((optimize("Ofast"),always_inline))
+      float eval(const float x2) {
+        return horner(x2, 9.998918213e-01f, -1.659601165e-01f, 7.602903343e-03f);
+      }
+    };
+
+    /** Max relative error 9.4e-7 */
+    template <> struct SinPoly<7> {
+      static inline __attribute__((optimize("Ofast"),always_inline))
+      float eval(const float x2) {
+        return horner(x2, 9.999990609e-01f, -1.666555409e-01f, 8.311899801e-03f, -1.848814029e-04f);
+      }
+    };
+
+    /** Max relative error 5.3e-9 */
+    template <> struct SinPoly<9> {
+      static inline __attribute__((optimize("Ofast"),always_inline))
+      float eval(const float x2) {
+        return horner(x2, 9.999999947e-01f, -1.666665668e-01f, 8.333025139e-03f, -1.980741873e-04f,
+                      2.601903068e-06f);
+      }
+    };
+
+    /**
+     * 2^x for x in [0, 1), kOrder is the polynomial degree.
+     */
+    template <uint32_t kOrder>
+    struct Exp2Poly {
+      static_assert(kOrder != kOrder, "Supported base 2 exponential orders: 2, 3, 4, 5, 6");
+    };
+
+    /** Max relative error 1.7e-3 */
+    template <> struct Exp2Poly<2> {
+      static inline __attribute__((optimize("Ofast"),always_inline))
+      float eval(const float x) {
+        return horner(x, 1.001724763e+00f, 6.576362757e-01f, 3.371894346e-01f);
+      }
+    };
+
+    /** Max relative error 7.5e-5 */
+    template <> struct Exp2Poly<3> {
+      static inline __attribute__((optimize("Ofast"),always_inline))
+      float eval(const float x) {
+        return horner(x, 9.999252186e-01f, 6.958335405e-01f, 2.260671554e-01f, 7.802452264e-02f);
+      }
+    };
+
+    /** Max relative error 2.6e-6 */
+    template <> struct Exp2Poly<4> {
+      static inline __attribute__((optimize("Ofast"),always_inline))
+      float eval(const float x) {
+        return horner(x, 1.000002593e+00f, 6.930038345e-01f, 2.414427569e-01f, 5.201146061e-02f,
+                      1.353416792e-02f);
+      }
+    };
+
+    /** Max relative error 7.5e-8 */
+    template <> struct Exp2Poly<5> {
+      static inline __attribute__((optimize("Ofast"),always_inline))
+      float eval(const float x) {
+        return horner(x, 9.999999251e-01f, 6.931530732e-01f, 2.401536170e-01f, 5.582631805e-02f,
+                      8.989340090e-03f, 1.877576675e-03f);
+      }
+    };
+
+    /** Max relative error 1.9e-9 */
+    template <> struct Exp2Poly<6> {
+      static inline __attribute__((optimize("Ofast"),always_inline))
+      float eval(const float x) {
+        return horner(x, 1.000000002e+00f, 6.931469838e-01f, 2.402298363e-01f, 5.548334198e-02f,
+                      9.678840996e-03f, 1.243968783e-03f, 2.170225546e-04f);
+      }
+    };
+
+    /**
+     * log2(1+t)/t for t in [sqrt(1/2)-1, sqrt(2)-1], kOrder is the degree of t*P(t).
+     */
+    template <uint32_t kOrder>
+    struct Log2Poly {
+      static_assert(kOrder != kOrder, "Supported base 2 logarithm orders: 2 to 8");
+    };
+
+    /** Max relative error 2.0e-2 */
+    template <> struct Log2Poly<2> {
+      static inline __attribute__((optimize("Ofast"),always_inline))
+      float eval(const float t) {
+        return horner(t, 1.470303862e+00f, -6.931078877e-01f);
+      }
+    };
+
+    /** Max relative error 2.6e-3 */
+    template <> struct Log2Poly<3> {
+      static inline __attribute__((optimize("Ofast"),always_inline))
+      float eval(const float t) {
+        return horner(t, 1.444177046e+00f, -7.511347335e-01f, 4.496096978e-01f);
+      }
+    };
+
+    /** Max relative error 3.5e-4 */
+    template <> struct Log2Poly<4> {
+      static inline __attribute__((optimize("Ofast"),always_inline))
+      float eval(const float t) {
+        return horner(t, 1.442270432e+00f, -7.242969532e-01f, 5.112727403e-01f, -3.277707707e-01f);
+      }
+    };
+
+    /** Max relative error 5.0e-5 */
+    template <> struct Log2Poly<5> {
+      static inline __attribute__((optimize("Ofast"),always_inline))
+      float eval(const float t) {
+        return horner(t, 1.442646251e+00f, -7.205549723e-01f, 4.853065147e-01f, -3.908924424e-01f,
+                      2.547518727e-01f);
+      }
+    };
+
+    /** Max relative error 7.4e-6 */
+    template <> struct Log2Poly<6> {
+      static inline __attribute__((optimize("Ofast"),always_inline))
+      float eval(const float t) {
+        return horner(t, 1.442701618e+00f, -7.212063898e-01f, 4.798118554e-01f, -3.664917049e-01f,
+                      3.181999099e-01f, -2.061910545e-01f);
+      }
+    };
+
+    /** Max relative error 1.1e-6 */
+    template <> struct Log2Poly<7> {
+      static inline __attribute__((optimize("Ofast"),always_inline))
+      float eval(const float t) {
+        return horner(t, 1.442696447e+00f, -7.213635760e-01f, 4.806267683e-01f, -3.593716436e-01f,
+                      2.956995207e-01f, -2.693202167e-01f, 1.716245618e-01f);
+      }
+    };
+
+    /** Max relative error 1.7e-7 */
+    template <> struct Log2Poly<8> {
+      static inline __attribute__((optimize("Ofast"),always_inline))
+      float eval(const float t) {
+        return horner(t, 1.442694962e+00f, -7.213527881e-01f, 4.809232423e-01f, -3.602396397e-01f,
+                      2.870986995e-01f, -2.488768647e-01f, 2.340423706e-01f, -1.458116887e-01f);
+      }
+    };
+
+    /*===========================================================================*/
+    /* Scalar Functions.                                                         */
+    /*===========================================================================*/
+
+    /**
+     * Sine
+     *
+     * @param x Angle in radians, in [-pi, pi]
+     * @return sin(x)
+     */
+    template <uint32_t kOrder>
+    inline __attribute__((optimize("Ofast"),always_inline))
+    float sin(const float x) {
+      // Fold onto [-pi/2, pi/2] using sin(pi - x) = sin(x)
+      const float r = (si_fabsf(x) > M_PI_2) ? si_copysignf(M_PI, x) - x : x;
+      return r * SinPoly<kOrder>::eval(r * r);
+    }
+
+    /**
+     * Base 2 exponential
+     *
+     * @param x Exponent, clipped to [-126, 126]
+     * @return 2^x
+     */
+    template <uint32_t kOrder>
+    inline __attribute__((optimize("Ofast"),always_inline))
+    float exp2(const float x) {
+      const float xc = clipminmaxf(-126.f, x, 126.f);
+      // Truncation of a positive value rounds down
+      const int32_t xi = (int32_t)(xc + 127.f) - 127;
+      union { float f; uint32_t i; } y = { Exp2Poly<kOrder>::eval(xc - (float)xi) };
+      y.i += (uint32_t)xi << 23;
+      return y.f;
+    }
+
+    /**
+     * Base 2 logarithm
+     *
+     * @param x Value, positive and normal
+     * @return log2(x)
+     */
+    template <uint32_t kOrder>
+    inline __attribute__((optimize("Ofast"),always_inline))
+    float log2(const float x) {
+      // Split into 2^e * m with m in [sqrt(1/2), sqrt(2))
+      union { float f; uint32_t i; } m = { x };
+      const uint32_t offset = m.i - 0x3F3504F3;
+      const int32_t e = (int32_t)offset >> 23;
+      m.i = (offset & 0x007FFFFF) + 0x3F3504F3;
+      const float t = m.f - 1.f;
+      return (float)e + t * Log2Poly<kOrder>::eval(t);
+    }
+
+    /**
+     * Hyperbolic tangent
+     *
+     * @param x Value
+     * @return tanh(x)
+     * @note Evaluated as (2^(2x/ln2) - 1) / (2^(2x/ln2) + 1), kOrder selects the exponential order.
+     */
+    template <uint32_t kOrder>
+    inline __attribute__((optimize("Ofast"),always_inline))
+    float tanh(const float x) {
+      // tanh(9) rounds to 1 in single precision
+      const float t = exp2<kOrder>(2.88539008f * clipminmaxf(-9.f, x, 9.f));
+      return (t - 1.f) / (t + 1.f);
+    }
+
+    /*===========================================================================*/
+    /* Block Functions.                                                          */
+    /*===========================================================================*/
+
+    /**
+     * Apply a scalar function to a block, 4 independent evaluations per iteration.
+     *
+     * @param x Input buffer
+     * @param y Output buffer, may be the same as x
+     * @param frames Number of values
+     */
+    template <float (*F)(float)>
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void block(const float *x, float *y, const uint32_t frames) {
+      uint32_t i = 0;
+      for (; i + 4 <= frames; i += 4) {
+        const float y0 = F(x[i]);
+        const float y1 = F(x[i+1]);
+        const float y2 = F(x[i+2]);
+        const float y3 = F(x[i+3]);
+        y[i] = y0;
+        y[i+1] = y1;
+        y[i+2] = y2;
+        y[i+3] = y3;
+      }
+      for (; i < frames; ++i)
+        y[i] = F(x[i]);
+    }
+
+    /**
+     * Block sine, see sin(float)
+     */
+    template <uint32_t kOrder>
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void sin(const float *x, float *y, const uint32_t frames) {
+      block<sin<kOrder> >(x, y, frames);
+    }
+
+    /**
+     * Block base 2 exponential, see exp2(float)
+     */
+    template <uint32_t kOrder>
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void exp2(const float *x, float *y, const uint32_t frames) {
+      block<exp2<kOrder> >(x, y, frames);
+    }
+
+    /**
+     * Block base 2 logarithm, see log2(float)
+     */
+    template <uint32_t kOrder>
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void log2(const float *x, float *y, const uint32_t frames) {
+      block<log2<kOrder> >(x, y, frames);
+    }
+
+    /**
+     * Block hyperbolic tangent, see tanh(float)
+     */
+    template <uint32_t kOrder>
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void tanh(const float *x, float *y, const uint32_t frames) {
+      block<tanh<kOrder> >(x, y, frames);
+    }
+
+  }
+}
+
+/** @} */
@@ -0,0 +1,276 @@
+#pragma once
+/*
+    BSD 3-Clause License
+
+    Copyright (c) 2018, KORG INC.
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice, this
+      list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    * Neither the name of the copyright holder nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+    FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+    DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//*/
+
+/**
+ * @file    chorus.hpp
+ * @brief   Multi-voice chorus, flanger and ensemble.
+ *
+ * @addtogroup dsp DSP
+ * @{
+ *
+ */
+
+#include "float_math.h"
+#include "int_math.h"
+#include "delayline.hpp"
+#include "simplelfo.hpp"
+#include "smoother.hpp"
+
+/**
+ * Common DSP Utilities
+ */
+namespace dsp {
+
+  /**
+   * Multi-voice modulated delay for chorus, flanger and ensemble effects,
+   * processing the main and sub timbres of a modulation effect in a single pass.
+   *
+   * Main and sub inputs are summed to mono and written as one float pair per frame
+   * into a DualDelayLine, so a single interpolated read per voice serves both timbres.
+   * Voices are panned across the stereo field.
+   *
+   * Voice delays are modulated by a bank of two shared LFOs, a slow one and a fast one
+   * (for ensemble style vibrato), with phases spread across voices. LFOs are evaluated
+   * once per block and the resulting delays interpolated linearly across the block.
+   *
+   * - Chorus: 2-4 voices, 5-20ms delay, a few ms of slow modulation, no feedback.
+   * - Flanger: 1 voice, 1-5ms delay, slow modulation, feedback.
+   * - Ensemble: 3 voices, ~10ms delay, slow modulation and fast vibrato.
+   *
+   * @tparam kVoices Number of voices.
+   */
+  template<uint32_t kVoices = 3>
+  struct Chorus {
+
+    /*===========================================================================*/
+    /* Types and Data Structures.                                                */
+    /*===========================================================================*/
+
+    /*===========================================================================*/
+    /* Constructor / Destructor.                                                 */
+    /*===========================================================================*/
+
+    /**
+     * Default constructor
+     */
+    Chorus(void) :
+      mDelay(480.f),
+      mDepth(0.f),
+      mDepth2(0.f),
+      mFeedback(0.f),
+      mDry(0.5f),
+      mWet(0.5f),
+      mFbZ(f32pair(0.f, 0.f))
+    {
+      setSpread(1.f);
+      for (uint32_t v = 0; v < kVoices; ++v)
+        mDelayZ[v] = mDelay;
+    }
+
+    /*===========================================================================*/
+    /* Public Methods.                                                           */
+    /*===========================================================================*/
+
+    /**
+     * Set the memory area to use as delay line, and reset state.
+     *
+     * @param ram Pointer to memory buffer
+     * @param line_size Size in float pairs of memory buffer
+     *
+     * @note Will round size to next power of two.
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setMemory(f32pair_t *ram, size_t line_size) {
+      mLine.setMemory(ram, line_size);
+      mLine.clear();
+      mFbZ = f32pair(0.f, 0.f);
+    }
+
+    /**
+     * Set base delay.
+     *
+     * @param frames Delay in frames
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setDelay(const float frames) {
+      mDelay = frames;
+    }
+
+    /**
+     * Set slow LFO.
+     *
+     * @param f0 Frequency in Hz
+     * @param depth Modulation depth in frames
+     * @param fsrecip Reciprocal of sampling frequency (1/Fs)
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setModulation(const float f0, const float depth, const float fsrecip) {
+      mLfo.setF0(f0, fsrecip);
+      mDepth = depth;
+    }
+
+    /**
+     * Set fast LFO, for ensemble style vibrato.
+     *
+     * @param f0 Frequency in Hz
+     * @param depth Modulation depth in frames, zero to disable
+     * @param fsrecip Reciprocal of sampling frequency (1/Fs)
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setVibrato(const float f0, const float depth, const float fsrecip) {
+      mLfo2.setF0(f0, fsrecip);
+      mDepth2 = depth;
+    }
+
+    /**
+     * Set feedback, for flanging.
+     *
+     * @param fb Feedback gain in [-0.95, 0.95]
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setFeedback(const float fb) {
+      mFeedback = clipminmaxf(-0.95f, fb, 0.95f);
+    }
+
+    /**
+     * Set stereo spread of voices.
+     *
+     * @param spread 0 for all voices centered, 1 for voices spread from left to right.
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setSpread(const float spread) {
+      const float norm = 1.f / kVoices;
+      for (uint32_t v = 0; v < kVoices; ++v) {
+        const float pan = (kVoices > 1) ? spread * ((float)v / (kVoices - 1) - 0.5f) : 0.f;
+        mGains[v] = f32pair(norm * (1.f - 2.f * clipminf(0.f, pan)),
+                            norm * (1.f + 2.f * clipmaxf(pan, 0.f)));
+      }
+    }
+
+    /**
+     * Set dry and wet levels.
+     *
+     * @param dry Dry level
+     * @param wet Wet level
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setMix(const float dry, const float wet) {
+      mDry = dry;
+      mWet = wet;
+    }
+
+    /**
+     * Process main and sub interleaved stereo frames in one pass.
+     *
+     * @param main_xn Main input buffer, interleaved stereo
+     * @param main_yn Main output buffer, interleaved stereo, can be the same as main_xn
+     * @param sub_xn Sub input buffer, interleaved stereo
+     * @param sub_yn Sub output buffer, interleaved stereo, can be the same as sub_xn
+     * @param frames Number of frames to process
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void process(const float *main_xn, float *main_yn,
+                 const float *sub_xn, float *sub_yn,
+                 const uint32_t frames) {
+      // LFO bank, once per block
+      mLfo.cycle(frames);
+      mLfo2.cycle(frames);
+      const float frames_recip = frames_recipf(frames);
+      const float max_delay = (float)(mLine.mSize - 2);
+      float pos[kVoices];
+      float pos_inc[kVoices];
+      for (uint32_t v = 0; v < kVoices; ++v) {
+        const float off = (float)v / kVoices - 0.5f;
+        const float d = clipminmaxf(1.f,
+                                    mDelay + mDepth * mLfo.sine_bi_off(off) + mDepth2 * mLfo2.sine_bi_off(off),
+                                    max_delay);
+        pos[v] = mDelayZ[v];
+        pos_inc[v] = (d - mDelayZ[v]) * frames_recip;
+        mDelayZ[v] = d;
+      }
+
+      const float dry = mDry;
+      const float wet = mWet;
+      const float fb = mFeedback;
+      f32pair_t fbz = mFbZ;
+      for (uint32_t t = 0; t < frames; ++t) {
+        const float ml = main_xn[2*t], mr = main_xn[2*t+1];
+        const float sl = sub_xn[2*t], sr = sub_xn[2*t+1];
+        mLine.write(f32pair(0.5f * (ml + mr) + fb * fbz.a, 0.5f * (sl + sr) + fb * fbz.b));
+
+        float yml = 0.f, ymr = 0.f, ysl = 0.f, ysr = 0.f;
+        fbz = f32pair(0.f, 0.f);
+        for (uint32_t v = 0; v < kVoices; ++v) {
+          pos[v] += pos_inc[v];
+          const f32pair_t s = mLine.readFrac(pos[v]);
+          const f32pair_t g = mGains[v];
+          yml += g.a * s.a;
+          ymr += g.b * s.a;
+          ysl += g.a * s.b;
+          ysr += g.b * s.b;
+          fbz.a += s.a;
+          fbz.b += s.b;
+        }
+        fbz.a *= (1.f / kVoices);
+        fbz.b *= (1.f / kVoices);
+
+        main_yn[2*t]   = dry * ml + wet * yml;
+        main_yn[2*t+1] = dry * mr + wet * ymr;
+        sub_yn[2*t]    = dry * sl + wet * ysl;
+        sub_yn[2*t+1]  = dry * sr + wet * ysr;
+      }
+      mFbZ = fbz;
+    }
+
+    /*===========================================================================*/
+    /* Member Variables.                                                         */
+    /*===========================================================================*/
+
+    DualDelayLine mLine;
+    SimpleLFO     mLfo;
+    SimpleLFO     mLfo2;
+    f32pair_t     mGains[kVoices];
+    float         mDelayZ[kVoices];
+    float         mDelay;
+    float         mDepth;
+    float         mDepth2;
+    float         mFeedback;
+    float         mDry;
+    float         mWet;
+    f32pair_t     mFbZ;
+  };
+
+}
+
+/** @} */
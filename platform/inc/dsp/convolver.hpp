@@ -0,0 +1,483 @@
+#pragma once
+/*
+    BSD 3-Clause License
+
+    Copyright (c) 2018, KORG INC.
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice, this
+      list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    * Neither the name of the copyright holder nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+    FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+    DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//*/
+
+/**
+ * @file    convolver.hpp
+ * @brief   Partitioned FFT convolution engine.
+ *
+ * @addtogroup dsp DSP
+ * @{
+ *
+ */
+
+#include "float_math.h"
+#include "int_math.h"
+#include "buffer_ops.h"
+#include "fft.hpp"
+
+/**
+ * Common DSP Utilities
+ */
+namespace dsp {
+
+  /**
+   * Stereo convolution with a long mono impulse response.
+   *
+   * The impulse response is split into segments of growing partition sizes,
+   * each one convolved with uniformly partitioned overlap-save FFT convolution:
+   *
+   * - Head segment: partitions of kBlockSize samples covering [0, 2L1), computed every block.
+   * - Tail segment k (1..kTails): partitions of Lk = kBlockSize * kRatio^k samples covering [2Lk, 2Lk+1),
+   *   the last one extending to the end of the impulse response.
+   *
+   * Tail transforms are computed in the background: the work for one tail
+   * partition period is split in steps (input transform stages, spectral
+   * multiply-accumulates, inverse transform stages) statically scheduled
+   * over the Lk / kBlockSize blocks of the period, so that the cost per block stays
+   * close to the average rather than peaking once per period.
+   *
+   * Impulse response spectra, frequency domain delay lines and transform buffers
+   * live in a caller provided memory area, typically a __sdram buffer sized with memorySize().
+   * Left and right channels are carried as the real and imaginary parts of a single
+   * complex signal, which is exact for a real impulse response.
+   *
+   * Overall latency is kBlockSize frames (see k_latency) regardless of the impulse response length.
+   *
+   * @tparam kBlockSize Head partition size in frames, power of two.
+   * @tparam kRatio Partition size ratio between consecutive segments, power of two.
+   * @tparam kTails Number of tail segments.
+   */
+  template<uint32_t kBlockSize = 32, uint32_t kRatio = 8, uint32_t kTails = 2>
+  struct Convolver {
+
+    /*===========================================================================*/
+    /* Types and Data Structures.                                                */
+    /*===========================================================================*/
+
+    static_assert((kBlockSize & (kBlockSize - 1)) == 0, "kBlockSize must be a power of two.");
+    static_assert(kRatio > 1 && (kRatio & (kRatio - 1)) == 0, "kRatio must be a power of two.");
+
+    enum {
+      k_segments = kTails + 1,
+      k_latency = kBlockSize,
+    };
+
+    /**
+     * Partition size of given segment, in frames.
+     */
+    static constexpr uint32_t partitionSize(uint32_t seg) {
+      return (seg == 0) ? kBlockSize : kRatio * partitionSize(seg - 1);
+    }
+
+    /**
+     * Offset of given segment in the impulse response, in samples.
+     */
+    static constexpr uint32_t segmentStart(uint32_t seg) {
+      return (seg == 0) ? 0 : 2 * partitionSize(seg);
+    }
+
+    /**
+     * Number of partitions of given segment for an impulse response length.
+     */
+    static constexpr uint32_t partitionCount(uint32_t seg, uint32_t ir_len) {
+      return (ir_len <= segmentStart(seg)) ? 0 :
+        (((seg == kTails || ir_len < segmentStart(seg + 1)) ? ir_len : segmentStart(seg + 1))
+         - segmentStart(seg) + partitionSize(seg) - 1) / partitionSize(seg);
+    }
+
+    /**
+     * Memory used by a segment, in floats: half spectra, frequency domain delay line and two accumulators.
+     */
+    static constexpr size_t segmentSize(uint32_t seg, uint32_t ir_len) {
+      return (partitionCount(seg, ir_len) == 0) ? 0 :
+        partitionCount(seg, ir_len) * 2 * (partitionSize(seg) + 1)
+        + partitionCount(seg, ir_len) * 4 * partitionSize(seg)
+        + 2 * 4 * partitionSize(seg);
+    }
+
+    /**
+     * Memory used by segments [seg, kTails], in floats.
+     */
+    static constexpr size_t segmentsSize(uint32_t seg, uint32_t ir_len) {
+      return (seg > kTails) ? 0 : segmentSize(seg, ir_len) + segmentsSize(seg + 1, ir_len);
+    }
+
+    enum {
+      /** Largest partition size */
+      k_max_partition = partitionSize(kTails),
+      /** Largest transform size in complex points */
+      k_max_fft = 2 * k_max_partition,
+      /** Input history ring size in frames, power of two holding the largest transform window */
+      k_history = 4 * k_max_partition,
+      /** Largest number of blocks per partition period */
+      k_max_slots = k_max_partition / kBlockSize,
+    };
+
+    /**
+     * Memory required for an impulse response length, in floats.
+     *
+     * @param ir_len Impulse response length in samples
+     */
+    static constexpr size_t memorySize(uint32_t ir_len) {
+      return 2 * k_history + FFT::twiddlesSize(k_max_fft) + segmentsSize(0, ir_len);
+    }
+
+    /** @private */
+    struct Segment {
+      FFT       fft;
+      float    *spectra;
+      float    *fdl;
+      float    *acc[2];
+      uint32_t  size;
+      uint32_t  parts;
+      uint32_t  steps;
+      uint32_t  slots;
+      uint32_t  fdlIdx;
+      uint32_t  cur;
+      uint32_t  start;
+      uint16_t  slotEnd[k_max_slots];
+    };
+
+    /*===========================================================================*/
+    /* Constructor / Destructor.                                                 */
+    /*===========================================================================*/
+
+    /**
+     * Default constructor
+     */
+    Convolver(void) :
+      mHistory(0),
+      mHistoryIdx(0),
+      mBlockIdx(0),
+      mFifoIdx(0)
+    {
+      for (uint32_t i = 0; i < k_segments; ++i)
+        mSegments[i].parts = 0;
+    }
+
+    /*===========================================================================*/
+    /* Public Methods.                                                           */
+    /*===========================================================================*/
+
+    /**
+     * Set the memory area and impulse response, and reset state.
+     *
+     * @param ram Pointer to memory buffer, typically in SDRAM
+     * @param ram_size Size in floats of memory buffer
+     * @param ir Mono impulse response
+     * @param ir_len Impulse response length in samples
+     * @return Impulse response length actually used, shorter than ir_len if ram_size is insufficient
+     *
+     * @note Computes impulse response spectra, intended for initialization time only.
+     */
+    uint32_t init(float *ram, size_t ram_size, const float *ir, uint32_t ir_len) {
+      if (memorySize(ir_len) > ram_size) {
+        uint32_t lo = 0, hi = ir_len;
+        while (lo < hi) {
+          const uint32_t mid = (lo + hi + 1) / 2;
+          if (memorySize(mid) <= ram_size)
+            lo = mid;
+          else
+            hi = mid - 1;
+        }
+        ir_len = lo;
+      }
+
+      mHistory = ram;
+      ram += 2 * k_history;
+      float *twiddles = ram;
+      ram += FFT::twiddlesSize(k_max_fft);
+      FFT::computeTwiddles(twiddles, k_max_fft);
+
+      for (uint32_t i = 0; i < k_segments; ++i) {
+        Segment &seg = mSegments[i];
+        const uint32_t l = partitionSize(i);
+        seg.size = l;
+        seg.parts = partitionCount(i, ir_len);
+        seg.start = segmentStart(i);
+        seg.fdlIdx = 0;
+        seg.cur = 0;
+        if (seg.parts == 0)
+          continue;
+        seg.fft.setTwiddles(twiddles, k_max_fft, 2 * l);
+        seg.spectra = ram;
+        ram += seg.parts * 2 * (l + 1);
+        seg.fdl = ram;
+        ram += seg.parts * 4 * l;
+        seg.acc[0] = ram;
+        ram += 4 * l;
+        seg.acc[1] = ram;
+        ram += 4 * l;
+        buf_clr_f32(seg.fdl, seg.parts * 4 * l);
+        buf_clr_f32(seg.acc[0], 8 * l);
+        computeSpectra(seg, ir, (i == kTails || ir_len < segmentStart(i + 1)) ? ir_len : segmentStart(i + 1));
+        schedule(seg);
+      }
+
+      buf_clr_f32(mHistory, 2 * k_history);
+      buf_clr_f32(mFifoIn, 2 * kBlockSize);
+      buf_clr_f32(mFifoOut, 2 * kBlockSize);
+      mHistoryIdx = 0;
+      mBlockIdx = 0;
+      mFifoIdx = 0;
+
+      return ir_len;
+    }
+
+    /**
+     * Process interleaved stereo frames.
+     *
+     * @param xn Input buffer, interleaved stereo
+     * @param yn Output buffer, interleaved stereo, can be the same as xn
+     * @param frames Number of frames to process
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void process(const float *xn, float *yn, uint32_t frames) {
+      while (frames) {
+        uint32_t n = kBlockSize - mFifoIdx;
+        if (n > frames)
+          n = frames;
+        float * __restrict__ fi = mFifoIn + 2 * mFifoIdx;
+        float * __restrict__ fo = mFifoOut + 2 * mFifoIdx;
+        for (uint32_t i = 0; i < 2 * n; ++i) {
+          fi[i] = xn[i];
+          yn[i] = fo[i];
+        }
+        xn += 2 * n;
+        yn += 2 * n;
+        frames -= n;
+        mFifoIdx += n;
+        if (mFifoIdx == kBlockSize) {
+          processBlock();
+          mFifoIdx = 0;
+        }
+      }
+    }
+
+    /**
+     * Process one block of kBlockSize frames from the input FIFO into the output FIFO.
+     */
+    inline __attribute__((optimize("Ofast")))
+    void processBlock(void) {
+      // Tail jobs start at partition boundaries, on the history up to the previous block
+      for (uint32_t i = 1; i < k_segments; ++i) {
+        Segment &seg = mSegments[i];
+        if (seg.parts && (mBlockIdx % seg.slots) == 0) {
+          seg.cur ^= 1;
+          runSteps(seg, 0, 1);
+        }
+      }
+
+      const uint32_t hmask = k_history - 1;
+      for (uint32_t i = 0; i < kBlockSize; ++i) {
+        const uint32_t idx = (mHistoryIdx + i) & hmask;
+        mHistory[2*idx]   = mFifoIn[2*i];
+        mHistory[2*idx+1] = mFifoIn[2*i+1];
+      }
+      mHistoryIdx = (mHistoryIdx + kBlockSize) & hmask;
+
+      buf_clr_f32(mFifoOut, 2 * kBlockSize);
+
+      Segment &head = mSegments[0];
+      if (head.parts) {
+        runSteps(head, 0, head.steps);
+        mix(head.acc[head.cur] + 2 * kBlockSize);
+      }
+
+      for (uint32_t i = 1; i < k_segments; ++i) {
+        Segment &seg = mSegments[i];
+        if (!seg.parts)
+          continue;
+        const uint32_t slot = mBlockIdx % seg.slots;
+        runSteps(seg, (slot == 0) ? 1 : seg.slotEnd[slot - 1], seg.slotEnd[slot]);
+        // Previous period result, delayed by one partition which the segment offset accounts for
+        mix(seg.acc[seg.cur ^ 1] + 2 * (seg.size + slot * kBlockSize));
+      }
+
+      mBlockIdx = (mBlockIdx + 1) % k_max_slots;
+    }
+
+    /*===========================================================================*/
+    /* Member Variables.                                                         */
+    /*===========================================================================*/
+
+    float   *mHistory;
+    uint32_t mHistoryIdx;
+    uint32_t mBlockIdx;
+    uint32_t mFifoIdx;
+    float    mFifoIn[2 * kBlockSize];
+    float    mFifoOut[2 * kBlockSize];
+    Segment  mSegments[k_segments];
+
+  private:
+
+    /*===========================================================================*/
+    /* Private Methods.                                                          */
+    /*===========================================================================*/
+
+    /*
+     * Job steps of a segment, in order:
+     * - 0: copy input window to frequency domain delay line, bit reversed
+     * - [1, n]: forward transform stages
+     * - [n+1, n+P]: spectral multiply-accumulates, one per partition
+     * - n+P+1: accumulator bit reversal
+     * - [n+P+2, 2n+P+1]: inverse transform stages
+     */
+
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void mix(const float *src) {
+      float * __restrict__ dst = mFifoOut;
+      for (uint32_t i = 0; i < 2 * kBlockSize; ++i)
+        dst[i] += src[i];
+    }
+
+    static uint32_t stepCost(const Segment &seg, uint32_t step) {
+      const uint32_t n = seg.fft.stages();
+      const uint32_t pts = 2 * seg.size;
+      if (step == 0 || step == n + seg.parts + 1)
+        return pts; // bit reversal
+      if (step <= n || step > n + seg.parts + 1)
+        return 5 * pts; // pts/2 butterflies
+      return 8 * pts; // complex multiply-accumulates
+    }
+
+    void schedule(Segment &seg) {
+      const uint32_t n = seg.fft.stages();
+      seg.steps = 2 * n + seg.parts + 2;
+      seg.slots = (seg.start == 0) ? 1 : seg.size / kBlockSize;
+      uint32_t total = 0;
+      for (uint32_t s = 0; s < seg.steps; ++s)
+        total += stepCost(seg, s);
+      // Step 0 is always run at period start, assign the others to the slot their cost midpoint falls in
+      uint32_t acc = stepCost(seg, 0);
+      uint32_t slot = 0;
+      for (uint32_t s = 1; s < seg.steps; ++s) {
+        const uint32_t c = stepCost(seg, s);
+        uint32_t target = (uint32_t)(((uint64_t)(acc + c / 2) * seg.slots) / total);
+        if (target >= seg.slots)
+          target = seg.slots - 1;
+        while (slot < target)
+          seg.slotEnd[slot++] = s;
+        acc += c;
+      }
+      while (slot < seg.slots)
+        seg.slotEnd[slot++] = seg.steps;
+    }
+
+    void computeSpectra(Segment &seg, const float *ir, uint32_t end) {
+      const uint32_t l = seg.size;
+      const uint32_t nfft = 2 * l;
+      const float scale = 1.f / nfft;
+      float *buf = seg.acc[0];
+      for (uint32_t p = 0; p < seg.parts; ++p) {
+        const uint32_t off = seg.start + p * l;
+        buf_clr_f32(buf, 2 * nfft);
+        for (uint32_t i = 0; i < l && off + i < end; ++i)
+          buf[2*i] = ir[off + i] * scale;
+        seg.fft.forward(buf);
+        float *h = seg.spectra + p * 2 * (l + 1);
+        for (uint32_t i = 0; i < 2 * (l + 1); ++i)
+          h[i] = buf[i];
+      }
+      buf_clr_f32(buf, 2 * nfft);
+    }
+
+    inline __attribute__((optimize("Ofast")))
+    void runSteps(Segment &seg, uint32_t first, uint32_t last) {
+      const uint32_t n = seg.fft.stages();
+      const uint32_t pts = 2 * seg.size;
+      for (uint32_t s = first; s < last; ++s) {
+        if (s == 0) {
+          seg.fdlIdx = (seg.fdlIdx == 0) ? seg.parts - 1 : seg.fdlIdx - 1;
+          seg.fft.bitReverseCopy(mHistory, k_history - 1,
+                                 (mHistoryIdx - pts) & (k_history - 1),
+                                 seg.fdl + seg.fdlIdx * 2 * pts);
+        }
+        else if (s <= n) {
+          seg.fft.stage(seg.fdl + seg.fdlIdx * 2 * pts, s - 1, false);
+        }
+        else if (s <= n + seg.parts) {
+          const uint32_t p = s - n - 1;
+          uint32_t k = seg.fdlIdx + p;
+          if (k >= seg.parts)
+            k -= seg.parts;
+          mac(seg.acc[seg.cur], seg.fdl + k * 2 * pts, seg.spectra + p * 2 * (seg.size + 1), pts, p == 0);
+        }
+        else if (s == n + seg.parts + 1) {
+          seg.fft.bitReverse(seg.acc[seg.cur]);
+        }
+        else {
+          seg.fft.stage(seg.acc[seg.cur], s - n - seg.parts - 2, true);
+        }
+      }
+    }
+
+    /*
+     * acc (+)= x * h over pts bins, h being the Hermitian half spectrum of a real partition.
+     */
+    static inline __attribute__((optimize("Ofast"),always_inline))
+    void mac(float * __restrict__ acc, const float * __restrict__ x, const float * __restrict__ h,
+             const uint32_t pts, const bool assign) {
+      const uint32_t half = pts / 2;
+      if (assign) {
+        for (uint32_t k = 0; k <= half; ++k) {
+          const float xr = x[2*k], xi = x[2*k+1], hr = h[2*k], hi = h[2*k+1];
+          acc[2*k]   = xr * hr - xi * hi;
+          acc[2*k+1] = xr * hi + xi * hr;
+        }
+        for (uint32_t k = half + 1; k < pts; ++k) {
+          const float xr = x[2*k], xi = x[2*k+1], hr = h[2*(pts-k)], hi = -h[2*(pts-k)+1];
+          acc[2*k]   = xr * hr - xi * hi;
+          acc[2*k+1] = xr * hi + xi * hr;
+        }
+      }
+      else {
+        for (uint32_t k = 0; k <= half; ++k) {
+          const float xr = x[2*k], xi = x[2*k+1], hr = h[2*k], hi = h[2*k+1];
+          acc[2*k]   += xr * hr - xi * hi;
+          acc[2*k+1] += xr * hi + xi * hr;
+        }
+        for (uint32_t k = half + 1; k < pts; ++k) {
+          const float xr = x[2*k], xi = x[2*k+1], hr = h[2*(pts-k)], hi = -h[2*(pts-k)+1];
+          acc[2*k]   += xr * hr - xi * hi;
+          acc[2*k+1] += xr * hi + xi * hr;
+        }
+      }
+    }
+
+  };
+
+}
+
+/** @} */
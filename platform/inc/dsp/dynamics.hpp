@@ -0,0 +1,413 @@
+#pragma once
+/*
+    BSD 3-Clause License
+
+    Copyright (c) 2018, KORG INC.
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice, this
+      list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    * Neither the name of the copyright holder nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+    FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+    DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//*/
+
+/**
+ * @file    dynamics.hpp
+ * @brief   Envelope followers, compressor and limiter.
+ *
+ * @addtogroup dsp DSP
+ * @{
+ *
+ */
+
+#include "float_math.h"
+#include "int_math.h"
+#include "delayline.hpp"
+
+/**
+ * Common DSP Utilities
+ */
+namespace dsp {
+
+  /**
+   * @name Level conversion helpers
+   * @{
+   */
+
+  /** Decibels per unit of base 2 logarithm: 20*log10(2) */
+#define k_dyn_db_per_log2     (6.02059991f)
+  /** Units of base 2 logarithm per decibel */
+#define k_dyn_log2_per_db     (0.16609640f)
+
+  /**
+   * One pole smoothing coefficient for a time constant.
+   *
+   * @param time Time constant in seconds
+   * @param fsrecip Reciprocal of update rate (1/Fs)
+   * @return exp(-1/(time*fs))
+   */
+  static inline __attribute__((optimize("Ofast"),always_inline))
+  float dyn_coeff(const float time, const float fsrecip) {
+    // exp(-x) = 2^(-x/ln(2))
+    return (time <= 0.f) ? 0.f : fastpow2f(-1.44269504f * fsrecip / time);
+  }
+
+  /** @} */
+
+  /**
+   * Peak and RMS envelope follower.
+   */
+  struct EnvelopeFollower {
+
+    /*===========================================================================*/
+    /* Types and Data Structures.                                                */
+    /*===========================================================================*/
+
+    /*===========================================================================*/
+    /* Constructor / Destructor.                                                 */
+    /*===========================================================================*/
+
+    /**
+     * Default constructor
+     */
+    EnvelopeFollower(void) :
+      mAttack(0.f),
+      mRelease(0.f),
+      mEnv(0.f)
+    { }
+
+    /*===========================================================================*/
+    /* Public Methods.                                                           */
+    /*===========================================================================*/
+
+    /**
+     * Reset envelope.
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void reset(void) {
+      mEnv = 0.f;
+    }
+
+    /**
+     * Set attack and release times.
+     *
+     * @param attack Attack time in seconds
+     * @param release Release time in seconds
+     * @param fsrecip Reciprocal of sampling frequency (1/Fs)
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setTimes(const float attack, const float release, const float fsrecip) {
+      mAttack = dyn_coeff(attack, fsrecip);
+      mRelease = dyn_coeff(release, fsrecip);
+    }
+
+    /**
+     * Peak follower, one sample.
+     *
+     * @param xn Input sample
+     * @return Peak envelope
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    float processPeak(const float xn) {
+      const float x = si_fabsf(xn);
+      const float c = (x > mEnv) ? mAttack : mRelease;
+      mEnv = x + c * (mEnv - x);
+      return mEnv;
+    }
+
+    /**
+     * RMS follower, one sample.
+     *
+     * @param xn Input sample
+     * @return Mean square envelope, take square root (or half base 2 logarithm) for RMS
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    float processMeanSquare(const float xn) {
+      const float x = xn * xn;
+      const float c = (x > mEnv) ? mAttack : mRelease;
+      mEnv = x + c * (mEnv - x);
+      return mEnv;
+    }
+
+    /**
+     * Current envelope value.
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    float value(void) const {
+      return mEnv;
+    }
+
+    /*===========================================================================*/
+    /* Member Variables.                                                         */
+    /*===========================================================================*/
+
+    float mAttack;
+    float mRelease;
+    float mEnv;
+  };
+
+  /**
+   * Stereo linked compressor and limiter with optional look-ahead.
+   *
+   * The detector collects the peak (or mean square) of both channels over control
+   * periods of kControlRate frames. Once per period, the level is converted to the
+   * base 2 log domain with fasterlog2f, the gain computer applies threshold, ratio and
+   * soft knee, gain reduction is smoothed with attack and release, and converted back with
+   * fasterpow2f. Linear gain is interpolated across the period, so the per sample cost is
+   * reduced to level detection, an optional delay line access and two multiplications.
+   *
+   * Look-ahead delays the signal against the detector so gain reduction can start
+   * before a transient reaches the output.
+   *
+   * @tparam kControlRate Control period in frames.
+   */
+  template<uint32_t kControlRate = 16>
+  struct Compressor {
+
+    /*===========================================================================*/
+    /* Types and Data Structures.                                                */
+    /*===========================================================================*/
+
+    /**
+     * Level detection modes
+     */
+    enum Detection {
+      k_detection_peak = 0,
+      k_detection_rms,
+    };
+
+    /*===========================================================================*/
+    /* Constructor / Destructor.                                                 */
+    /*===========================================================================*/
+
+    /**
+     * Default constructor
+     */
+    Compressor(void) :
+      mDetection(k_detection_peak),
+      mThreshold(0.f),
+      mSlope(0.f),
+      mKnee(0.f),
+      mMakeup(0.f),
+      mAttack(0.f),
+      mRelease(0.f),
+      mLookahead(0),
+      mLevel(0.f),
+      mCount(0),
+      mReduction(0.f),
+      mGain(1.f),
+      mGainInc(0.f)
+    { }
+
+    /*===========================================================================*/
+    /* Public Methods.                                                           */
+    /*===========================================================================*/
+
+    /**
+     * Set level detection mode.
+     *
+     * @param mode Detection mode
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setDetection(const Detection mode) {
+      mDetection = mode;
+    }
+
+    /**
+     * Set threshold, ratio and soft knee width.
+     *
+     * @param threshold_db Threshold in dBFS
+     * @param ratio Compression ratio, >= 1
+     * @param knee_db Knee width in dB, 0 for a hard knee
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setCurve(const float threshold_db, const float ratio, const float knee_db) {
+      mThreshold = threshold_db * k_dyn_log2_per_db;
+      mSlope = 1.f - 1.f / clipminf(1.f, ratio);
+      mKnee = clipminf(0.f, knee_db) * k_dyn_log2_per_db;
+    }
+
+    /**
+     * Configure as a brickwall limiter, hard knee and infinite ratio.
+     *
+     * @param ceiling_db Ceiling in dBFS
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setLimiter(const float ceiling_db) {
+      mThreshold = ceiling_db * k_dyn_log2_per_db;
+      mSlope = 1.f;
+      mKnee = 0.f;
+    }
+
+    /**
+     * Set makeup gain.
+     *
+     * @param gain_db Makeup gain in dB
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setMakeup(const float gain_db) {
+      mMakeup = gain_db * k_dyn_log2_per_db;
+    }
+
+    /**
+     * Set attack and release times.
+     *
+     * @param attack Attack time in seconds
+     * @param release Release time in seconds
+     * @param fsrecip Reciprocal of sampling frequency (1/Fs)
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setTimes(const float attack, const float release, const float fsrecip) {
+      mAttack = dyn_coeff(attack, fsrecip * kControlRate);
+      mRelease = dyn_coeff(release, fsrecip * kControlRate);
+    }
+
+    /**
+     * Set the memory area for look-ahead and the look-ahead time.
+     *
+     * The signal is delayed by exactly the given frames. The gain for a control period is known at its end and
+     * ramped in over the next one, so it is in place at the output for look-ahead of 2 x kControlRate frames or more.
+     *
+     * @param ram Pointer to memory buffer, or 0 to disable look-ahead
+     * @param line_size Size in float pairs of memory buffer
+     * @param frames Look-ahead in frames, less than line_size
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setLookahead(f32pair_t *ram, const size_t line_size, const uint32_t frames) {
+      if (ram == 0 || frames == 0) {
+        mLookahead = 0;
+        return;
+      }
+      mLine.setMemory(ram, line_size);
+      mLine.clear();
+      mLookahead = (frames < line_size) ? frames : line_size - 1;
+    }
+
+    /**
+     * Current gain reduction.
+     *
+     * @return Gain reduction in dB, zero or negative
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    float reduction(void) const {
+      return mReduction * k_dyn_db_per_log2;
+    }
+
+    /**
+     * Process interleaved stereo frames.
+     *
+     * @param xn Input buffer, interleaved stereo
+     * @param yn Output buffer, interleaved stereo, can be the same as xn
+     * @param frames Number of frames to process
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void process(const float *xn, float *yn, uint32_t frames) {
+      const bool rms = (mDetection == k_detection_rms);
+      for (uint32_t t = 0; t < frames; ++t) {
+        const float l = xn[2*t];
+        const float r = xn[2*t+1];
+
+        if (rms)
+          mLevel += l * l + r * r;
+        else
+          mLevel = clipminf(mLevel, clipminf(si_fabsf(l), si_fabsf(r)));
+
+        f32pair_t s = f32pair(l, r);
+        if (mLookahead) {
+          // Read before write, read(1) after it would be the sample just written
+          const f32pair_t d = mLine.read(mLookahead);
+          mLine.write(s);
+          s = d;
+        }
+
+        mGain += mGainInc;
+        yn[2*t]   = mGain * s.a;
+        yn[2*t+1] = mGain * s.b;
+
+        if (++mCount == kControlRate) {
+          updateGain(rms);
+          mCount = 0;
+        }
+      }
+    }
+
+    /*===========================================================================*/
+    /* Member Variables.                                                         */
+    /*===========================================================================*/
+
+    DualDelayLine mLine;
+    Detection     mDetection;
+    float         mThreshold;
+    float         mSlope;
+    float         mKnee;
+    float         mMakeup;
+    float         mAttack;
+    float         mRelease;
+    uint32_t      mLookahead;
+    float         mLevel;
+    uint32_t      mCount;
+    float         mReduction;
+    float         mGain;
+    float         mGainInc;
+
+  private:
+
+    /*===========================================================================*/
+    /* Private Methods.                                                          */
+    /*===========================================================================*/
+
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void updateGain(const bool rms) {
+      // Level in log2 units, mean square of both channels halved for RMS
+      const float level = rms
+        ? 0.5f * fasterlog2f(mLevel * (0.5f / kControlRate) + 1e-20f)
+        : fasterlog2f(mLevel + 1e-20f);
+      mLevel = 0.f;
+
+      // Gain computer, quadratic soft knee
+      const float over = level - mThreshold;
+      float target;
+      if (2.f * over <= -mKnee)
+        target = 0.f;
+      else if (2.f * over < mKnee) {
+        const float k = over + 0.5f * mKnee;
+        target = -mSlope * k * k / (2.f * mKnee);
+      }
+      else
+        target = -mSlope * over;
+
+      // Smoothing, attack when reduction increases
+      const float c = (target < mReduction) ? mAttack : mRelease;
+      mReduction = target + c * (mReduction - target);
+
+      // Rescaled so that integer powers, and unity gain in particular, are exact
+      const float gain = 1.02949504f * fasterpow2f(mReduction + mMakeup);
+      mGainInc = (gain - mGain) * (1.f / kControlRate);
+    }
+
+  };
+
+}
+
+/** @} */
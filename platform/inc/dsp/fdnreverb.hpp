@@ -0,0 +1,403 @@
+#pragma once
+/*
+    BSD 3-Clause License
+
+    Copyright (c) 2018, KORG INC.
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice, this
+      list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    * Neither the name of the copyright holder nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+    FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+    DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//*/
+
+/**
+ * @file    fdnreverb.hpp
+ * @brief   Feedback delay network reverberator.
+ *
+ * @addtogroup dsp DSP
+ * @{
+ *
+ */
+
+#include "float_math.h"
+#include "int_math.h"
+#include "buffer_ops.h"
+#include "delayline.hpp"
+#include "biquad.hpp"
+#include "simplelfo.hpp"
+#include "smoother.hpp"
+
+/**
+ * Common DSP Utilities
+ */
+namespace dsp {
+
+  /**
+   * Feedback matrix types
+   */
+  enum FDNMixing {
+    /** Normalized Hadamard matrix, via fast Walsh-Hadamard transform */
+    k_fdn_mixing_hadamard = 0,
+    /** Householder reflection I - 2/N * 11^T */
+    k_fdn_mixing_householder,
+  };
+
+  /**
+   * Stereo feedback delay network reverberator.
+   *
+   * Lines have mutually prime lengths, a per line gain and first order damping
+   * filter, and are modulated by a shared LFO with evenly spread phases.
+   * All lines are carved out of a single contiguous memory area, typically in SDRAM.
+   *
+   * Processing is done in sub-blocks of kBlockSize frames: each line is read for the
+   * whole sub-block, feedback is computed from the read taps, then each line is
+   * written for the whole sub-block, so memory is accessed in short sequential runs.
+   *
+   * @tparam kLines Number of delay lines: 4, 8 or 16.
+   * @tparam kMixing Feedback matrix type.
+   * @tparam kBlockSize Sub-block size in frames, lines must be longer than this.
+   */
+  template<uint32_t kLines = 8, FDNMixing kMixing = k_fdn_mixing_hadamard, uint32_t kBlockSize = 16>
+  struct FDNReverb {
+
+    /*===========================================================================*/
+    /* Types and Data Structures.                                                */
+    /*===========================================================================*/
+
+    static_assert(kLines == 4 || kLines == 8 || kLines == 16, "kLines must be 4, 8 or 16.");
+
+    enum {
+      /** Maximum modulation depth in samples */
+      k_max_mod_depth = 32,
+      /** Shortest line length in samples */
+      k_min_length = kBlockSize + 2,
+      /** Room left above the longest line length for rounding lengths up to primes */
+      k_length_margin = 4 * kLines,
+    };
+
+    /**
+     * Next power of two, compile time.
+     */
+    static constexpr size_t nextPow2(size_t x, size_t p = 1) {
+      return (p >= x) ? p : nextPow2(x, p << 1);
+    }
+
+    /**
+     * Longest line length actually used, lines need at least two samples between their lengths.
+     *
+     * @param max_length Longest line length in samples
+     */
+    static constexpr uint32_t maxLength(uint32_t max_length) {
+      return (max_length < k_min_length + 2 * kLines) ? k_min_length + 2 * kLines : max_length;
+    }
+
+    /**
+     * Memory size of one line for a maximum line length, in floats.
+     *
+     * @param max_length Longest line length in samples
+     */
+    static constexpr size_t lineSize(uint32_t max_length) {
+      return nextPow2(maxLength(max_length) + k_length_margin + k_max_mod_depth + 2);
+    }
+
+    /**
+     * Memory required for a maximum line length, in floats.
+     *
+     * @param max_length Longest line length in samples
+     */
+    static constexpr size_t memorySize(uint32_t max_length) {
+      return kLines * lineSize(max_length);
+    }
+
+    /*===========================================================================*/
+    /* Constructor / Destructor.                                                 */
+    /*===========================================================================*/
+
+    /**
+     * Default constructor
+     */
+    FDNReverb(void) :
+      mModDepth(0),
+      mInputGain(1.f / kLines),
+      mOutputGain(2.f / kLines)
+    {
+      for (uint32_t i = 0; i < kLines; ++i) {
+        mLengths[i] = k_min_length;
+        mGains[i] = 0.f;
+        mModZ[i] = 0.f;
+      }
+    }
+
+    /*===========================================================================*/
+    /* Public Methods.                                                           */
+    /*===========================================================================*/
+
+    /**
+     * Set memory area and line lengths, and clear state.
+     *
+     * Line lengths are distinct primes spread geometrically between min_length and max_length, rounded up to the
+     * next prime. They stay below the line size less the modulation depth, where the search for a prime gives up.
+     *
+     * @param ram Pointer to memory buffer of memorySize(max_length) floats
+     * @param min_length Shortest line length in samples
+     * @param max_length Longest line length in samples
+     */
+    void init(float *ram, uint32_t min_length, uint32_t max_length) {
+      // Lengths must fit the memory sized by the caller for max_length, so min_length gives way
+      max_length = maxLength(max_length);
+      if (min_length < k_min_length)
+        min_length = k_min_length;
+      if (min_length > max_length - 2 * kLines)
+        min_length = max_length - 2 * kLines;
+      const size_t line_size = lineSize(max_length);
+      const uint32_t len_max = line_size - k_max_mod_depth - 2;
+
+      const float ratio = fastpowf((float)max_length / min_length, 1.f / (kLines - 1));
+      float target = min_length;
+      uint32_t prev = 0;
+      for (uint32_t i = 0; i < kLines; ++i, target *= ratio) {
+        // Leave one sample per remaining line below the limit, so that lengths stay distinct
+        const uint32_t len_cap = len_max - (kLines - 1 - i);
+        uint32_t len = (uint32_t)target;
+        if (len <= prev)
+          len = prev + 1;
+        uint32_t p = len;
+        while (p < len_cap && !isPrime(p))
+          ++p;
+        if (isPrime(p))
+          len = p;
+        mLengths[i] = prev = (len < len_cap) ? len : len_cap;
+        mLines[i].setMemory(ram + i * line_size, line_size);
+        mDampers[i].mCoeffs.setPoleLP(0.f);
+      }
+
+      for (uint32_t i = 0; i < kLines; ++i)
+        mGains[i] = 0.f;
+      clear();
+    }
+
+    /**
+     * Zero clear delay lines and filters.
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void clear(void) {
+      for (uint32_t i = 0; i < kLines; ++i) {
+        mLines[i].clear();
+        mDampers[i].flush();
+      }
+    }
+
+    /**
+     * Set decay time. Line gains are scaled by line length so that all lines decay at the same rate.
+     *
+     * @param rt60 Time to decay by 60dB in seconds
+     * @param fsrecip Reciprocal of sampling frequency (1/Fs)
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setDecay(const float rt60, const float fsrecip) {
+      // 10^(-3 * length / (rt60 * fs))
+      const float k = -9.965784285f * fsrecip / clipminf(0.001f, rt60);
+      for (uint32_t i = 0; i < kLines; ++i)
+        mGains[i] = fastpow2f(k * mLengths[i]);
+    }
+
+    /**
+     * Set damping filter of all lines.
+     *
+     * @param k Tangent of PI x cutoff frequency in radians: tan(pi*wc)
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setDamping(const float k) {
+      for (uint32_t i = 0; i < kLines; ++i)
+        mDampers[i].mCoeffs.setFOLP(k);
+    }
+
+    /**
+     * Set damping filter of a single line.
+     *
+     * @param line Line index
+     * @param k Tangent of PI x cutoff frequency in radians: tan(pi*wc)
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setDamping(const uint32_t line, const float k) {
+      mDampers[line].mCoeffs.setFOLP(k);
+    }
+
+    /**
+     * Set modulation.
+     *
+     * @param f0 LFO frequency in Hz
+     * @param depth Modulation depth in samples, up to k_max_mod_depth
+     * @param fsrecip Reciprocal of sampling frequency (1/Fs)
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setModulation(const float f0, const float depth, const float fsrecip) {
+      mLfo.setF0(f0, fsrecip);
+      mModDepth = clipminmaxf(0.f, depth, (float)k_max_mod_depth);
+    }
+
+    /**
+     * Line length in samples.
+     *
+     * @param line Line index
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    uint32_t length(const uint32_t line) const {
+      return mLengths[line];
+    }
+
+    /**
+     * Process interleaved stereo frames. Output is wet signal only.
+     *
+     * @param xn Input buffer, interleaved stereo
+     * @param yn Output buffer, interleaved stereo, can be the same as xn
+     * @param frames Number of frames to process
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void process(const float *xn, float *yn, uint32_t frames) {
+      while (frames) {
+        const uint32_t n = (frames > kBlockSize) ? kBlockSize : frames;
+        processBlock(xn, yn, n);
+        xn += 2 * n;
+        yn += 2 * n;
+        frames -= n;
+      }
+    }
+
+    /*===========================================================================*/
+    /* Member Variables.                                                         */
+    /*===========================================================================*/
+
+    DelayLine mLines[kLines];
+    BiQuad    mDampers[kLines];
+    SimpleLFO mLfo;
+    uint32_t  mLengths[kLines];
+    float     mGains[kLines];
+    float     mModZ[kLines];
+    float     mModDepth;
+    float     mInputGain;
+    float     mOutputGain;
+    float     mTaps[kLines][kBlockSize];
+
+  private:
+
+    /*===========================================================================*/
+    /* Private Methods.                                                          */
+    /*===========================================================================*/
+
+    static bool isPrime(const uint32_t x) {
+      if (x < 2)
+        return false;
+      for (uint32_t d = 2; d * d <= x; ++d)
+        if (x % d == 0)
+          return false;
+      return true;
+    }
+
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void mix(float *v) {
+      if (kMixing == k_fdn_mixing_hadamard) {
+        for (uint32_t h = 1; h < kLines; h <<= 1) {
+          for (uint32_t i = 0; i < kLines; i += 2 * h) {
+            for (uint32_t j = i; j < i + h; ++j) {
+              const float a = v[j];
+              const float b = v[j + h];
+              v[j] = a + b;
+              v[j + h] = a - b;
+            }
+          }
+        }
+        const float norm = (kLines == 4) ? 0.5f : (kLines == 16) ? 0.25f : 0.35355339059f;
+        for (uint32_t i = 0; i < kLines; ++i)
+          v[i] *= norm;
+      }
+      else {
+        float sum = 0.f;
+        for (uint32_t i = 0; i < kLines; ++i)
+          sum += v[i];
+        sum *= 2.f / kLines;
+        for (uint32_t i = 0; i < kLines; ++i)
+          v[i] -= sum;
+      }
+    }
+
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void processBlock(const float *xn, float *yn, const uint32_t frames) {
+      const float frames_recip = frames_recipf(frames);
+
+      // Read taps, while write indexes are still at sub-block start
+      mLfo.cycle(frames);
+      for (uint32_t i = 0; i < kLines; ++i) {
+        const float mod = mModDepth * mLfo.sine_uni_off((float)i / kLines - 0.5f);
+        const float mod_inc = (mod - mModZ[i]) * frames_recip;
+        float pos = mLengths[i] + mModZ[i];
+        float * __restrict__ taps = mTaps[i];
+        for (uint32_t t = 0; t < frames; ++t) {
+          pos += mod_inc;
+          taps[t] = mLines[i].readFrac(pos - t);
+        }
+        mModZ[i] = mod;
+      }
+
+      // Outputs, feedback and inputs
+      const float in_gain = mInputGain;
+      const float out_gain = mOutputGain;
+      for (uint32_t t = 0; t < frames; ++t) {
+        float v[kLines];
+        float l = 0.f, r = 0.f;
+        for (uint32_t i = 0; i < kLines; i += 4) {
+          v[i]   = mTaps[i][t];
+          v[i+1] = mTaps[i+1][t];
+          v[i+2] = mTaps[i+2][t];
+          v[i+3] = mTaps[i+3][t];
+          l += v[i] - v[i+2];
+          r += v[i+1] - v[i+3];
+        }
+        const float xl = in_gain * xn[2*t];
+        const float xr = in_gain * xn[2*t+1];
+        yn[2*t]   = out_gain * l;
+        yn[2*t+1] = out_gain * r;
+
+        mix(v);
+
+        for (uint32_t i = 0; i < kLines; i += 2) {
+          mTaps[i][t]   = mDampers[i].process_fo(mGains[i] * v[i]) + xl;
+          mTaps[i+1][t] = mDampers[i+1].process_fo(mGains[i+1] * v[i+1]) + xr;
+        }
+      }
+
+      // Write lines
+      for (uint32_t i = 0; i < kLines; ++i) {
+        const float * __restrict__ taps = mTaps[i];
+        for (uint32_t t = 0; t < frames; ++t)
+          mLines[i].write(taps[t]);
+      }
+    }
+
+  };
+
+}
+
+/** @} */
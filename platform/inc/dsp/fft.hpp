@@ -0,0 +1,253 @@
+#pragma once
+/*
+    BSD 3-Clause License
+
+    Copyright (c) 2018, KORG INC.
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice, this
+      list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    * Neither the name of the copyright holder nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+    FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+    DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//*/
+
+/**
+ * @file    fft.hpp
+ * @brief   Radix-2 complex FFT.
+ *
+ * @addtogroup dsp DSP
+ * @{
+ *
+ */
+
+#include "float_math.h"
+#include "int_math.h"
+
+/**
+ * Common DSP Utilities
+ */
+namespace dsp {
+
+  /**
+   * In-place radix-2 decimation in time FFT over interleaved complex buffers (re, im, re, im, ...).
+   *
+   * The transform can be run one butterfly stage at a time so that the work of
+   * large transforms can be spread over several processing callbacks.
+   * Twiddle factors live in caller provided memory and a table computed for a
+   * given size can be shared by all transforms of equal or smaller sizes.
+   */
+  struct FFT {
+
+    /*===========================================================================*/
+    /* Types and Data Structures.                                                */
+    /*===========================================================================*/
+
+    /*===========================================================================*/
+    /* Constructor / Destructor.                                                 */
+    /*===========================================================================*/
+
+    /**
+     * Default constructor
+     */
+    FFT(void) :
+      mTwiddles(0),
+      mSize(0),
+      mLog2Size(0),
+      mTwiddleStride(0)
+    { }
+
+    /*===========================================================================*/
+    /* Public Methods.                                                           */
+    /*===========================================================================*/
+
+    /**
+     * Size in floats of the twiddle table for transforms of up to given size.
+     *
+     * @param size Maximum transform size in complex points (power of two)
+     */
+    static constexpr size_t twiddlesSize(const size_t size) {
+      return size;
+    }
+
+    /**
+     * Compute twiddle factors for transforms of up to given size.
+     *
+     * @param twiddles Pointer to memory buffer of twiddlesSize(size) floats
+     * @param size Maximum transform size in complex points (power of two)
+     *
+     * @note Uses libm, intended for initialization time only.
+     */
+    static void computeTwiddles(float *twiddles, const size_t size) {
+      const double w = -2.0 * 3.14159265358979323846 / size;
+      for (size_t i = 0; i < size / 2; ++i) {
+        twiddles[2*i]   = (float)cos(w * i);
+        twiddles[2*i+1] = (float)sin(w * i);
+      }
+    }
+
+    /**
+     * Set the twiddle table and size of the transform.
+     *
+     * @param twiddles Twiddle table computed via computeTwiddles()
+     * @param twiddles_size Transform size the twiddle table was computed for
+     * @param size Transform size in complex points, power of two and not larger than twiddles_size
+     */
+    inline __attribute__((always_inline))
+    void setTwiddles(const float *twiddles, const size_t twiddles_size, const size_t size) {
+      mTwiddles = twiddles;
+      mSize = size;
+      mLog2Size = 31 - __builtin_clz(size);
+      mTwiddleStride = twiddles_size / size;
+    }
+
+    /**
+     * Transform size in complex points.
+     */
+    inline __attribute__((always_inline))
+    uint32_t size(void) const {
+      return mSize;
+    }
+
+    /**
+     * Number of butterfly stages of the transform.
+     */
+    inline __attribute__((always_inline))
+    uint32_t stages(void) const {
+      return mLog2Size;
+    }
+
+    /**
+     * Permute buffer into bit reversed order. First step of a transform.
+     *
+     * @param buf Interleaved complex buffer of size() points.
+     */
+    inline __attribute__((optimize("Ofast")))
+    void bitReverse(float * __restrict__ buf) const {
+      const uint32_t n = mSize;
+      for (uint32_t i = 0, j = 0; i < n; ++i) {
+        if (i < j) {
+          const float re = buf[2*i];
+          const float im = buf[2*i+1];
+          buf[2*i]   = buf[2*j];
+          buf[2*i+1] = buf[2*j+1];
+          buf[2*j]   = re;
+          buf[2*j+1] = im;
+        }
+        uint32_t bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+          j ^= bit;
+        j |= bit;
+      }
+    }
+
+    /**
+     * Copy a window of a complex ring buffer in bit reversed order. Can replace bitReverse() as first step of a transform.
+     *
+     * @param ring Interleaved complex ring buffer.
+     * @param mask Ring buffer size in complex points minus one (size must be a power of two).
+     * @param start Index of first point of the window in the ring buffer.
+     * @param buf Destination buffer of size() points.
+     */
+    inline __attribute__((optimize("Ofast")))
+    void bitReverseCopy(const float *ring, const uint32_t mask, const uint32_t start,
+                        float * __restrict__ buf) const {
+      const uint32_t n = mSize;
+      for (uint32_t i = 0, j = 0; i < n; ++i) {
+        const uint32_t k = (start + i) & mask;
+        buf[2*j]   = ring[2*k];
+        buf[2*j+1] = ring[2*k+1];
+        uint32_t bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+          j ^= bit;
+        j |= bit;
+      }
+    }
+
+    /**
+     * Run one butterfly stage over a bit reversed buffer.
+     *
+     * @param buf Interleaved complex buffer of size() points.
+     * @param s Stage index in [0, stages()-1], stages must be run in order.
+     * @param inverse Run inverse transform stage. Inverse transforms are not scaled.
+     */
+    inline __attribute__((optimize("Ofast")))
+    void stage(float * __restrict__ buf, const uint32_t s, const bool inverse) const {
+      const uint32_t n = mSize;
+      const uint32_t half = 1U << s;
+      const uint32_t stride = 2 * (mTwiddleStride << (mLog2Size - 1 - s));
+      const float sign = inverse ? -1.f : 1.f;
+      for (uint32_t k = 0; k < n; k += 2*half) {
+        float *a = buf + 2*k;
+        float *b = a + 2*half;
+        const float *w = mTwiddles;
+        for (uint32_t j = 0; j < half; ++j, a += 2, b += 2, w += stride) {
+          const float wr = w[0];
+          const float wi = sign * w[1];
+          const float tr = b[0] * wr - b[1] * wi;
+          const float ti = b[0] * wi + b[1] * wr;
+          b[0] = a[0] - tr;
+          b[1] = a[1] - ti;
+          a[0] += tr;
+          a[1] += ti;
+        }
+      }
+    }
+
+    /**
+     * Forward transform in place.
+     *
+     * @param buf Interleaved complex buffer of size() points.
+     */
+    inline __attribute__((optimize("Ofast")))
+    void forward(float * __restrict__ buf) const {
+      bitReverse(buf);
+      for (uint32_t s = 0; s < mLog2Size; ++s)
+        stage(buf, s, false);
+    }
+
+    /**
+     * Inverse transform in place, not scaled by 1/size().
+     *
+     * @param buf Interleaved complex buffer of size() points.
+     */
+    inline __attribute__((optimize("Ofast")))
+    void inverse(float * __restrict__ buf) const {
+      bitReverse(buf);
+      for (uint32_t s = 0; s < mLog2Size; ++s)
+        stage(buf, s, true);
+    }
+
+    /*===========================================================================*/
+    /* Member Variables.                                                         */
+    /*===========================================================================*/
+
+    const float *mTwiddles;
+    uint32_t     mSize;
+    uint32_t     mLog2Size;
+    uint32_t     mTwiddleStride;
+  };
+
+}
+
+/** @} */
@@ -0,0 +1,288 @@
+#pragma once
+/*
+    BSD 3-Clause License
+
+    Copyright (c) 2018, KORG INC.
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice, this
+      list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    * Neither the name of the copyright holder nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+    FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+    DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//*/
+
+/**
+ * @file    granular.hpp
+ * @brief   Granular pitch shifter and time stretcher.
+ *
+ * @addtogroup dsp DSP
+ * @{
+ *
+ */
+
+#include "float_math.h"
+#include "int_math.h"
+#include "buffer_ops.h"
+#include "lut.hpp"
+#include "delayline.hpp"
+
+/**
+ * Common DSP Utilities
+ */
+namespace dsp {
+
+  /**
+   * @name Grain window lookup table
+   * @{
+   */
+
+#define k_grain_window_size_exp   (8)
+
+  /** Hann window over one period, sin^2(pi x) */
+  struct GrainWindowCurve {
+    static constexpr double eval(const double x) {
+      return lut_cx_sin(k_lut_cx_pi * x) * lut_cx_sin(k_lut_cx_pi * x);
+    }
+  };
+
+  /** Hann window table with guard point, generated at compile time */
+  typedef lut_f<GrainWindowCurve, k_grain_window_size_exp> GrainWindowLUT;
+
+  /** @} */
+
+  /**
+   * Lookup grain window value.
+   *
+   * @param x Window phase, values outside [0, 1] are clipped and yield zero
+   */
+  static inline __attribute__((optimize("Ofast"),always_inline))
+  float grain_window(float x) {
+    return GrainWindowLUT::lookup_clip(x);
+  }
+
+  /**
+   * Stereo granular pitch shifter and time stretcher.
+   *
+   * Windowed grains are read from a circular buffer at a rate given by the pitch ratio.
+   * Grains are taken from a fixed pool and spawned round robin at regular intervals,
+   * the oldest grain being replaced when the pool is exhausted.
+   *
+   * Every grain of the pool is rendered on every frame, finished or not, so the cost
+   * per callback only depends on the number of frames and on kGrains, not on grain
+   * size, density or pitch.
+   *
+   * @tparam kGrains Grain pool size.
+   */
+  template<uint32_t kGrains = 4>
+  struct GrainShifter {
+
+    /*===========================================================================*/
+    /* Types and Data Structures.                                                */
+    /*===========================================================================*/
+
+    /** @private */
+    struct Grain {
+      float pos;
+      float posInc;
+      float phase;
+      float phaseInc;
+    };
+
+    /*===========================================================================*/
+    /* Constructor / Destructor.                                                 */
+    /*===========================================================================*/
+
+    /**
+     * Default constructor
+     */
+    GrainShifter(void) :
+      mRatio(1.f),
+      mGrainSize(2048.f),
+      mInterval(1024.f),
+      mDelay(1.f),
+      mStretch(1.f),
+      mScan(0.f),
+      mSpawnCount(0.f),
+      mGain(1.f),
+      mNextGrain(0)
+    {
+      for (uint32_t i = 0; i < kGrains; ++i) {
+        mGrains[i].pos = 1.f;
+        mGrains[i].posInc = 0.f;
+        mGrains[i].phase = 1.f;
+        mGrains[i].phaseInc = 0.f;
+      }
+    }
+
+    /*===========================================================================*/
+    /* Public Methods.                                                           */
+    /*===========================================================================*/
+
+    /**
+     * Set the memory area to use as buffer, and reset state.
+     *
+     * @param ram Pointer to memory buffer
+     * @param line_size Size in float pairs of memory buffer
+     *
+     * @note Will round size to next power of two.
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setMemory(f32pair_t *ram, size_t line_size) {
+      mLine.setMemory(ram, line_size);
+      mLine.clear();
+      mScan = 0.f;
+      mSpawnCount = 0.f;
+      for (uint32_t i = 0; i < kGrains; ++i)
+        mGrains[i].phase = 1.f;
+    }
+
+    /**
+     * Set pitch ratio applied to grains.
+     *
+     * @param ratio Playback rate ratio, e.g. 2 for one octave up
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setPitch(const float ratio) {
+      mRatio = clipminmaxf(0.125f, ratio, 8.f);
+    }
+
+    /**
+     * Set grain size and density.
+     *
+     * @param frames Grain size in frames
+     * @param overlap Number of overlapping grains, up to kGrains
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setGrain(const float frames, const float overlap) {
+      mGrainSize = clipminf(16.f, frames);
+      const float ov = clipminmaxf(1.f, overlap, (float)kGrains);
+      mInterval = mGrainSize / ov;
+      // Hann windows spaced by size/overlap sum to overlap/2
+      mGain = 2.f / ov;
+    }
+
+    /**
+     * Set grain source delay.
+     *
+     * @param frames Delay in frames between input and grain start positions
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setDelay(const float frames) {
+      mDelay = clipminf(1.f, frames);
+    }
+
+    /**
+     * Set time stretch factor, i.e. rate at which grain start positions advance relative to input.
+     *
+     * @param stretch 1 to follow input, 0 to freeze, in between to slow down.
+     *
+     * @note Grain start positions wrap back to the input when they get older than the buffer allows.
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setStretch(const float stretch) {
+      mStretch = clip01f(stretch);
+    }
+
+    /**
+     * Process interleaved stereo frames. Output is wet signal only.
+     *
+     * @param xn Input buffer, interleaved stereo
+     * @param yn Output buffer, interleaved stereo, can be the same as xn
+     * @param frames Number of frames to process
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void process(const float *xn, float *yn, const uint32_t frames) {
+      // Write whole block first, reads below are offset accordingly
+      const f32pair_t *x = (const f32pair_t *)xn;
+      for (uint32_t t = 0; t < frames; ++t)
+        mLine.write(x[t]);
+
+      // Range of grain positions that never reaches unwritten or overwritten samples
+      const float travel = (1.f - mRatio) * mGrainSize;
+      const float pos_min = mDelay + ((travel < 0.f) ? -travel : 0.f) + 1.f;
+      const float pos_max = (float)(mLine.mSize - frames - 2) - ((travel > 0.f) ? travel : 0.f);
+
+      // Spawn grains due in this block, with their start offset folded into initial state
+      mSpawnCount -= frames;
+      while (mSpawnCount <= 0.f) {
+        const float start = mSpawnCount + frames;
+        const float pos = clipminmaxf(pos_min, pos_min + mScan, pos_max);
+        Grain &g = mGrains[mNextGrain];
+        g.posInc = 1.f - mRatio;
+        g.phaseInc = 1.f / mGrainSize;
+        g.pos = pos - start * g.posInc;
+        g.phase = -start * g.phaseInc;
+        mNextGrain = (mNextGrain + 1) % kGrains;
+        mSpawnCount += mInterval;
+      }
+
+      // Scan position moves away from the input when stretching
+      mScan += (1.f - mStretch) * frames;
+      if (pos_min + mScan > pos_max)
+        mScan = 0.f;
+
+      buf_clr_f32(yn, 2 * frames);
+      f32pair_t *y = (f32pair_t *)yn;
+      const float gain = mGain;
+      const float lim = (float)(mLine.mSize - 2);
+      for (uint32_t i = 0; i < kGrains; ++i) {
+        Grain &g = mGrains[i];
+        float pos = g.pos + (frames - 1);
+        float phase = g.phase;
+        const float pos_inc = g.posInc - 1.f;
+        const float phase_inc = g.phaseInc;
+        for (uint32_t t = 0; t < frames; ++t) {
+          const float w = gain * grain_window(phase);
+          const f32pair_t s = mLine.readFrac(clipminmaxf(1.f, pos, lim));
+          y[t].a += w * s.a;
+          y[t].b += w * s.b;
+          pos += pos_inc;
+          phase += phase_inc;
+        }
+        // Finished grains keep running silent, keep their state bounded
+        g.pos = clipminmaxf(1.f, g.pos + frames * g.posInc, lim);
+        g.phase = clipmaxf(phase, 1.f);
+      }
+    }
+
+    /*===========================================================================*/
+    /* Member Variables.                                                         */
+    /*===========================================================================*/
+
+    DualDelayLine mLine;
+    Grain         mGrains[kGrains];
+    float         mRatio;
+    float         mGrainSize;
+    float         mInterval;
+    float         mDelay;
+    float         mStretch;
+    float         mScan;
+    float         mSpawnCount;
+    float         mGain;
+    uint32_t      mNextGrain;
+  };
+
+}
+
+/** @} */
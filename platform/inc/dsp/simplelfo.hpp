@@ -82,6 +82,17 @@ namespace dsp {
       phi0 += w0;
     }
 
+    /**
+     * Step phase multiple cycles forward
+     *
+     * @param n Number of cycles
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void cycle(const uint32_t n)
+    {
+      phi0 += (q31_t)((uint32_t)w0 * n);
+    }
+
     /**
      * Reset phase
      */
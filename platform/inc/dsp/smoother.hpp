@@ -0,0 +1,397 @@
+#pragma once
+/*
+    BSD 3-Clause License
+
+    Copyright (c) 2018, KORG INC.
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice, this
+      list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    * Neither the name of the copyright holder nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+    FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+    DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//*/
+
+#include "float_math.h"
+#include "int_math.h"
+#include "lut.hpp"
+
+/**
+ * @file    smoother.hpp
+ * @brief   Parameter smoothing with per-block ramp generation.
+ *
+ * @addtogroup dsp DSP
+ * @{
+ *
+ */
+
+/**
+ * Common DSP Utilities
+ */
+namespace dsp {
+
+  /**
+   * @name Block size reciprocals
+   * @{
+   */
+
+  /** Largest block size covered by the reciprocal table */
+#define k_smoother_max_frames   (64)
+
+  /** 1/n for n in [0, 64], 0 for n = 0 */
+  struct FramesRecip {
+    static constexpr float value(const uint32_t n) {
+      return (n == 0) ? 0.f : (float)(1.0 / n);
+    }
+  };
+
+  typedef lut_array<float, k_smoother_max_frames + 1, FramesRecip> FramesRecipLUT;
+
+  /**
+   * Reciprocal of a block size without division for the supported 1 to 64 frames.
+   *
+   * @param frames Block size
+   * @return 1/frames
+   */
+  static inline __attribute__((optimize("Ofast"),always_inline))
+  float frames_recipf(const uint32_t frames) {
+    return (frames <= k_smoother_max_frames) ? FramesRecipLUT::data()[frames] : 1.f / frames;
+  }
+
+  /** @} */
+
+  /**
+   * Linear ramp reaching its target at the end of each block.
+   */
+  struct LinearSmoother {
+
+    /*===========================================================================*/
+    /* Constructor / Destructor.                                                 */
+    /*===========================================================================*/
+
+    LinearSmoother(void) :
+      mZ(0.f), mTarget(0.f), mInc(0.f)
+    { }
+
+    /*===========================================================================*/
+    /* Public Methods.                                                           */
+    /*===========================================================================*/
+
+    /**
+     * Jump to a value without ramping
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void reset(const float value) {
+      mZ = mTarget = value;
+      mInc = 0.f;
+    }
+
+    /**
+     * Set value to reach at the end of the next block
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setTarget(const float target) {
+      mTarget = target;
+    }
+
+    /**
+     * Prepare the ramp of a block, to be called before next()
+     *
+     * @param frames Block size
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void begin(const uint32_t frames) {
+      mInc = (mTarget - mZ) * frames_recipf(frames);
+    }
+
+    /**
+     * Advance one frame
+     *
+     * @return Smoothed value, equal to the target on the last frame of the block
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    float next(void) {
+      return (mZ += mInc);
+    }
+
+    /**
+     * Ramp over a whole block
+     *
+     * @param out Output buffer
+     * @param frames Block size
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void fill_block(float *out, const uint32_t frames) {
+      const float z = mZ;
+      const float inc = (mTarget - z) * frames_recipf(frames);
+      for (uint32_t i = 0; i < frames; ++i)
+        out[i] = z + inc * (i + 1);
+      mZ = mTarget;
+      mInc = 0.f;
+    }
+
+    /**
+     * Current value
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    float value(void) const {
+      return mZ;
+    }
+
+    /*===========================================================================*/
+    /* Member Variables.                                                         */
+    /*===========================================================================*/
+
+    float mZ;
+    float mTarget;
+    float mInc;
+  };
+
+  /**
+   * One pole lowpass smoother.
+   */
+  struct OnePoleSmoother {
+
+    /*===========================================================================*/
+    /* Constructor / Destructor.                                                 */
+    /*===========================================================================*/
+
+    OnePoleSmoother(void) :
+      mZ(0.f), mTarget(0.f), mK(1.f)
+    { }
+
+    /*===========================================================================*/
+    /* Public Methods.                                                           */
+    /*===========================================================================*/
+
+    /**
+     * Jump to a value without smoothing
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void reset(const float value) {
+      mZ = mTarget = value;
+    }
+
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setTarget(const float target) {
+      mTarget = target;
+    }
+
+    /**
+     * Set smoothing coefficient directly, z += k * (target - z) per frame
+     *
+     * @param k Coefficient in (0, 1], 1 disables smoothing
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setCoeff(const float k) {
+      mK = k;
+    }
+
+    /**
+     * Set smoothing time constant
+     *
+     * @param time Time to reach 1-1/e of a step, in seconds
+     * @param fsrecip Reciprocal of update rate (1/Fs)
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setTime(const float time, const float fsrecip) {
+      // 1 - exp(-1/(time*fs)) = 1 - 2^(-1/(time*fs*ln2))
+      mK = (time <= 0.f) ? 1.f : 1.f - fastpow2f(-1.44269504f * fsrecip / time);
+    }
+
+    /**
+     * No block setup required, present for interface symmetry
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void begin(const uint32_t frames) {
+      (void)frames;
+    }
+
+    /**
+     * Advance one frame
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    float next(void) {
+      return (mZ += mK * (mTarget - mZ));
+    }
+
+    /**
+     * Smooth over a whole block
+     *
+     * @param out Output buffer
+     * @param frames Block size
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void fill_block(float *out, const uint32_t frames) {
+      // Distance to target decays geometrically
+      const float target = mTarget;
+      const float pole = 1.f - mK;
+      float d = mZ - target;
+      for (uint32_t i = 0; i < frames; ++i) {
+        d *= pole;
+        out[i] = target + d;
+      }
+      mZ = target + d;
+    }
+
+    inline __attribute__((optimize("Ofast"),always_inline))
+    float value(void) const {
+      return mZ;
+    }
+
+    /*===========================================================================*/
+    /* Member Variables.                                                         */
+    /*===========================================================================*/
+
+    float mZ;
+    float mTarget;
+    float mK;
+  };
+
+  /**
+   * Exponential ramp for gains, linear in the dB domain, reaching its target at the end of each block.
+   */
+  struct ExpSmoother {
+
+    /*===========================================================================*/
+    /* Types and Data Structures.                                                */
+    /*===========================================================================*/
+
+    /** Floor of the log domain, gains below -120dB ramp from or to -120dB */
+#define k_smoother_exp_floor_log2   (-19.93156857f)
+
+    /*===========================================================================*/
+    /* Constructor / Destructor.                                                 */
+    /*===========================================================================*/
+
+    ExpSmoother(void) :
+      mZ(1.f), mLog2Z(0.f), mLog2Target(0.f), mMul(1.f)
+    { }
+
+    /*===========================================================================*/
+    /* Public Methods.                                                           */
+    /*===========================================================================*/
+
+    /**
+     * Jump to a gain without ramping
+     *
+     * @param gain Linear gain
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void reset(const float gain) {
+      mLog2Z = mLog2Target = toLog2(gain);
+      mZ = fastpow2f(mLog2Z);
+      mMul = 1.f;
+    }
+
+    /**
+     * Set gain to reach at the end of the next block
+     *
+     * @param gain Linear gain
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setTarget(const float gain) {
+      mLog2Target = toLog2(gain);
+    }
+
+    /**
+     * Set gain to reach at the end of the next block
+     *
+     * @param db Gain in dB
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setTargetDb(const float db) {
+      // log2(10^(db/20)) = db * log2(10)/20
+      mLog2Target = clipminf(k_smoother_exp_floor_log2, db * 0.16609640f);
+    }
+
+    /**
+     * Prepare the ramp of a block, to be called before next()
+     *
+     * @param frames Block size
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void begin(const uint32_t frames) {
+      mMul = fastpow2f((mLog2Target - mLog2Z) * frames_recipf(frames));
+      mLog2Z = mLog2Target;
+    }
+
+    /**
+     * Advance one frame
+     *
+     * @return Smoothed gain
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    float next(void) {
+      return (mZ *= mMul);
+    }
+
+    /**
+     * Ramp over a whole block
+     *
+     * @param out Output buffer
+     * @param frames Block size
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void fill_block(float *out, const uint32_t frames) {
+      begin(frames);
+      const float mul = mMul;
+      float z = mZ;
+      for (uint32_t i = 0; i < frames; ++i)
+        out[i] = (z *= mul);
+      // Resynchronize to avoid drift of the running product
+      mZ = fastpow2f(mLog2Z);
+      mMul = 1.f;
+    }
+
+    /**
+     * Current gain
+     */
+    inline __attribute__((optimize("Ofast"),always_inline))
+    float value(void) const {
+      return mZ;
+    }
+
+    /*===========================================================================*/
+    /* Member Variables.                                                         */
+    /*===========================================================================*/
+
+    float mZ;
+    float mLog2Z;
+    float mLog2Target;
+    float mMul;
+
+  private:
+
+    /*===========================================================================*/
+    /* Private Methods.                                                          */
+    /*===========================================================================*/
+
+    static inline __attribute__((optimize("Ofast"),always_inline))
+    float toLog2(const float gain) {
+      return clipminf(k_smoother_exp_floor_log2, fastlog2f(clipminf(1e-6f, gain)));
+    }
+  };
+}
+
+/** @} */
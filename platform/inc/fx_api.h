@@ -323,7 +323,7 @@ extern "C" {
    */
   __fast_inline float fx_sat_cubicf(float x) {
     const float xf = si_fabsf(clip1f(x)) * k_cubicsat_size;
-    const uint32_t xi = (uint32_t)x;
+    const uint32_t xi = (uint32_t)xf;
     const float y0 = cubicsat_lut_f[xi];
     const float y1 = cubicsat_lut_f[xi+1];
     return si_copysignf(linintf(xf - xi, y0, y1), x);
@@ -344,7 +344,7 @@ extern "C" {
    */
   __fast_inline float fx_sat_schetzenf(float x) {
     const float xf = si_fabsf(clip1f(x)) * k_schetzen_size;
-    const uint32_t xi = (uint32_t)x;
+    const uint32_t xi = (uint32_t)xf;
     const float y0 = schetzen_lut_f[xi];
     const float y1 = schetzen_lut_f[xi+1];
     return si_copysignf(linintf(xf - xi, y0, y1), x);
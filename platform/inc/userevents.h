@@ -0,0 +1,122 @@
+/*
+    BSD 3-Clause License
+
+    Copyright (c) 2018, KORG INC.
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice, this
+      list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    * Neither the name of the copyright holder nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+    FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+    DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//*/
+
+/**
+ * @file    userevents.h
+ * @brief   Sample accurate event lists for custom user programs.
+ *
+ * The firmware applies parameter changes between blocks. Runtimes able to time events within a block, such as the host
+ * runtime, let units fetch the events falling inside the current block from their cycle/process hook, so that the
+ * unit can split the block at event boundaries or ramp toward new values. On the instrument no events are returned and
+ * all changes keep arriving through the regular hooks.
+ *
+ * @addtogroup common Common
+ * @{
+ */
+
+#ifndef __userevents_h
+#define __userevents_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  /**
+   * Event types.
+   */
+  enum {
+    /** Parameter change. index: parameter index, value: value as passed to the param hook */
+    k_user_event_param = 0U,
+    /** Oscillator value change. value: value as passed to the value hook */
+    k_user_event_value,
+    /** Note on. index: note number, value: velocity */
+    k_user_event_note_on,
+    /** Note off. index: note number */
+    k_user_event_note_off,
+    /** Oscillator pitch change. value: note number in high byte, fine in low byte */
+    k_user_event_pitch,
+    /** Oscillator shape LFO change. value: Q31 */
+    k_user_event_shape_lfo,
+    k_num_user_event_types
+  };
+
+  /** Mask selecting an event type in user_events_get() */
+#define USER_EVENT_MASK(type) (1U<<(type))
+  /** Mask selecting all event types */
+#define USER_EVENT_MASK_ALL   ((1U<<k_num_user_event_types)-1)
+
+  /**
+   * Timed event.
+   */
+  typedef struct user_event {
+    /** Frame offset from the start of the current block */
+    uint16_t offset;
+    /** Event type */
+    uint8_t  type;
+    /** Type specific index */
+    uint8_t  index;
+    /** Type specific value */
+    int32_t  value;
+  } user_event_t;
+
+  /** @private */
+  const user_event_t *_user_events(uint32_t type_mask, uint32_t *count) __attribute__((weak));
+
+  /**
+   * Fetch events falling inside the current block.
+   *
+   * Only valid from within the cycle/process hook. Events are sorted by offset, offsets are in [1, frames-1]:
+   * changes due at the block start have already been applied through the regular hooks. Fetched events are
+   * consumed, the unit is responsible for applying them. Events of types not in the mask are applied by the
+   * runtime through the regular hooks before the next block, as on the instrument.
+   *
+   * @param type_mask Types of events to fetch, see USER_EVENT_MASK()
+   * @param events    Set to the first event
+   * @return Number of events, always 0 on the instrument
+   */
+  static inline __attribute__((always_inline))
+  uint32_t user_events_get(const uint32_t type_mask, const user_event_t **events) {
+    uint32_t count = 0;
+    *events = (_user_events != NULL) ? _user_events(type_mask, &count) : NULL;
+    return count;
+  }
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // __userevents_h
+
+/** @} */
@@ -45,8 +45,118 @@
 #ifndef __cortexm4_h
 #define __cortexm4_h
 
+#if defined(__arm__) || defined(__thumb__)
+
 #include "arm_math.h" // CMSIS
 
+#else
+
+/**
+ * @name    Host Fill-ins
+ * @note    Portable versions of the CMSIS intrinsics used by the SDK headers, for native builds of host tools.
+ * @note    Saturating subtractions update an emulated GE flag set so that the qsub/sel idioms of fixed_math.h behave as intended.
+ * @{
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define __SIMD32_TYPE int32_t
+
+static uint32_t __host_ge_flags;
+
+static inline __attribute__((always_inline))
+int32_t __host_sat(int64_t x, const int64_t lo, const int64_t hi) {
+  return (int32_t)((x < lo) ? lo : (x > hi) ? hi : x);
+}
+
+static inline __attribute__((always_inline))
+int32_t __QADD(int32_t a, int32_t b) {
+  return __host_sat((int64_t)a + b, INT32_MIN, INT32_MAX);
+}
+
+static inline __attribute__((always_inline))
+int32_t __QSUB(int32_t a, int32_t b) {
+  __host_ge_flags = (a >= b) ? 0xF : 0x0;
+  return __host_sat((int64_t)a - b, INT32_MIN, INT32_MAX);
+}
+
+static inline __attribute__((always_inline))
+int32_t __QADD16(int32_t a, int32_t b) {
+  const int32_t lo = __host_sat((int16_t)a + (int16_t)b, INT16_MIN, INT16_MAX);
+  const int32_t hi = __host_sat((int16_t)(a >> 16) + (int16_t)(b >> 16), INT16_MIN, INT16_MAX);
+  return (int32_t)(((uint32_t)hi << 16) | ((uint32_t)lo & 0xFFFF));
+}
+
+static inline __attribute__((always_inline))
+int32_t __QSUB16(int32_t a, int32_t b) {
+  const int16_t al = (int16_t)a, bl = (int16_t)b;
+  const int16_t ah = (int16_t)(a >> 16), bh = (int16_t)(b >> 16);
+  __host_ge_flags = ((al >= bl) ? 0x3 : 0x0) | ((ah >= bh) ? 0xC : 0x0);
+  const int32_t lo = __host_sat(al - bl, INT16_MIN, INT16_MAX);
+  const int32_t hi = __host_sat(ah - bh, INT16_MIN, INT16_MAX);
+  return (int32_t)(((uint32_t)hi << 16) | ((uint32_t)lo & 0xFFFF));
+}
+
+static inline __attribute__((always_inline))
+int32_t __SEL(int32_t a, int32_t b) {
+  uint32_t mask = 0;
+  for (uint32_t i = 0; i < 4; ++i)
+    if (__host_ge_flags & (1U << i))
+      mask |= 0xFFU << (8 * i);
+  return (int32_t)(((uint32_t)a & mask) | ((uint32_t)b & ~mask));
+}
+
+static inline __attribute__((always_inline))
+int32_t __SSAT(int32_t x, uint32_t n) {
+  return __host_sat(x, -(1LL << (n - 1)), (1LL << (n - 1)) - 1);
+}
+
+static inline __attribute__((always_inline))
+uint32_t __USAT(int32_t x, uint32_t n) {
+  return (uint32_t)__host_sat(x, 0, (1LL << n) - 1);
+}
+
+static inline __attribute__((always_inline))
+int32_t __SMMLA(int32_t a, int32_t b, int32_t c) {
+  return (int32_t)(c + (((int64_t)a * b) >> 32));
+}
+
+static inline __attribute__((always_inline))
+uint8_t __CLZ(uint32_t x) {
+  return x ? (uint8_t)__builtin_clz(x) : 32;
+}
+
+static inline __attribute__((always_inline))
+uint32_t __REV(uint32_t x) {
+  return __builtin_bswap32(x);
+}
+
+static inline __attribute__((always_inline))
+uint32_t __RBIT(uint32_t x) {
+  x = ((x >> 1) & 0x55555555) | ((x & 0x55555555) << 1);
+  x = ((x >> 2) & 0x33333333) | ((x & 0x33333333) << 2);
+  x = ((x >> 4) & 0x0F0F0F0F) | ((x & 0x0F0F0F0F) << 4);
+  return __builtin_bswap32(x);
+}
+
+static inline __attribute__((always_inline))
+uint32_t __get_APSR(void) {
+  return __host_ge_flags << 16;
+}
+
+#define __PKHBT(a, b, s) ((int32_t)(((uint32_t)(a) & 0x0000FFFF) | (((uint32_t)(b) << (s)) & 0xFFFF0000)))
+#define __PKHTB(a, b, s) ((int32_t)(((uint32_t)(a) & 0xFFFF0000) | (((uint32_t)(b) >> (s)) & 0x0000FFFF)))
+
+#define __NOP() do { } while (0)
+#define __DMB() __asm__ volatile ("" ::: "memory")
+#define __DSB() __asm__ volatile ("" ::: "memory")
+#define __ISB() __asm__ volatile ("" ::: "memory")
+
+/** @} */
+
+#endif
+
 /**
  * @name    ARM Cortex-M4 Core Intrinsics
  * @note    See http://www.keil.com/pack/doc/cmsis/Core/html/group__intrinsic__CPU__gr.html
@@ -140,7 +140,16 @@ typedef uint64_t uq64_0_t;
 #define q31_to_f32(q) ((float)(q) * q31_to_f32_c)
 
 #define f32_to_q15(f)   ((q15_t)ssat((q31_t)((float)(f) * ((1<<15)-1)),16))
+#if defined(__arm__) || defined(__thumb__)
 #define f32_to_q31(f)   ((q31_t)((float)(f) * (float)0x7FFFFFFF))
+#else
+/* VCVT saturates out of range values and converts NaN to zero, host conversions do neither */
+static inline __attribute__((always_inline))
+q31_t __host_f32_to_q31(float x) {
+  return (x != x) ? 0 : (x >= 2147483648.f) ? 0x7FFFFFFF : (x <= -2147483648.f) ? (q31_t)0x80000000 : (q31_t)x;
+}
+#define f32_to_q31(f)   __host_f32_to_q31((float)(f) * (float)0x7FFFFFFF)
+#endif
 
 /** @} */
 
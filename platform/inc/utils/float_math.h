@@ -580,7 +580,7 @@ float fastercosf(float x) {
  */
 static inline __attribute__((optimize("Ofast"), always_inline))
 float fastcosfullf(float x) {
-  return fastersinfullf(x + M_PI_2);
+  return fastsinfullf(x + M_PI_2);
 }
 
 /** "Faster" cosine approximation, valid on full x domain
@@ -604,7 +604,7 @@ float fasttanf(float x) {
  */
 static inline __attribute__((optimize("Ofast"), always_inline))
 float fastertanf(float x) {
-  return fastcosf(x) / fastercosf(x);
+  return fastersinf(x) / fastercosf(x);
 }
 
 /** "Fast" tangent approximation, valid on full x domain, except where tangent diverges.
@@ -755,15 +755,18 @@ float fasteratan2f(float y, float x) {
 
 /** Hyperbolic tangent approximation
  * @note Adapted from http://math.stackexchange.com/questions/107292/rapid-approximation-of-tanhx
+ * @note The rational approximation only holds for positive x, evaluated on |x| and mirrored.
  */
 static inline __attribute__((optimize("Ofast"), always_inline))
 float fastertanhf(float x) {
-  return (-0.67436811832e-5f +
-          (0.2468149110712040f +
-           (0.583691066395175e-1f + 0.3357335044280075e-1f * x) * x) * x) /
+  const float ax = si_fabsf(x);
+  const float y = (-0.67436811832e-5f +
+                   (0.2468149110712040f +
+                    (0.583691066395175e-1f + 0.3357335044280075e-1f * ax) * ax) * ax) /
     (0.2464845986383725f +
      (0.609347197060491e-1f +
-      (0.1086202599228572f + 0.2874707922475963e-1f * x) * x) * x);
+      (0.1086202599228572f + 0.2874707922475963e-1f * ax) * ax) * ax);
+  return si_copysignf(y, x);
 }
 
 /** @} */
@@ -790,7 +793,7 @@ float ampdbf(const float amp) {
  */
 static inline __attribute__((optimize("Ofast"), always_inline))
 float fasterampdbf(const float amp) {
-  static const float c = 3.3219280948873626f; // 20.f / log2f(10);
+  static const float c = 6.0205999132796239f; // 20.f / log2f(10);
   return c*fasterlog2f(amp);
 }
 
@@ -0,0 +1,319 @@
+/*
+    BSD 3-Clause License
+
+    Copyright (c) 2018, KORG INC.
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice, this
+      list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    * Neither the name of the copyright holder nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+    FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+    DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//*/
+
+/**
+ * @file    lut.hpp
+ * @brief   Compile time lookup table generation.
+ *
+ * @addtogroup utils Utils
+ * @{
+ *
+ * @addtogroup utils_lut Lookup Tables
+ * @{
+ *
+ */
+
+#ifndef __lut_hpp
+#define __lut_hpp
+
+#include <stdint.h>
+
+#include "float_math.h"
+#include "int_math.h"
+
+/*===========================================================================*/
+/* Index Sequences.                                                          */
+/*===========================================================================*/
+
+/**
+ * @name    Index Sequences
+ * @note    Built by halving so that instantiation depth stays logarithmic in table size.
+ * @{
+ */
+
+template <uint32_t... I>
+struct lut_seq { };
+
+template <typename A, typename B>
+struct lut_seq_cat;
+
+template <uint32_t... A, uint32_t... B>
+struct lut_seq_cat<lut_seq<A...>, lut_seq<B...> > {
+  typedef lut_seq<A..., (sizeof...(A) + B)...> type;
+};
+
+template <uint32_t N>
+struct lut_make_seq {
+  typedef typename lut_seq_cat<typename lut_make_seq<N/2>::type,
+                               typename lut_make_seq<N - N/2>::type>::type type;
+};
+
+template <>
+struct lut_make_seq<0> {
+  typedef lut_seq<> type;
+};
+
+template <>
+struct lut_make_seq<1> {
+  typedef lut_seq<0> type;
+};
+
+/** @} */
+
+/*===========================================================================*/
+/* Compile Time Math.                                                        */
+/*===========================================================================*/
+
+/**
+ * @name    Compile Time Math
+ * @note    Double precision, C++11 constexpr versions of common curve building blocks.
+ * @note    Only meant for table generation, far too slow for run time use.
+ * @{
+ */
+
+#define k_lut_cx_pi   (3.14159265358979323846)
+#define k_lut_cx_ln2  (0.69314718055994530942)
+#define k_lut_cx_e    (2.71828182845904523536)
+
+constexpr double lut_cx_abs(const double x) {
+  return (x < 0) ? -x : x;
+}
+
+constexpr double lut_cx_floor(const double x) {
+  return ((double)(int64_t)x > x) ? (double)(int64_t)x - 1.0 : (double)(int64_t)x;
+}
+
+constexpr double lut_cx_sin_series(const double x2, const double term, const uint32_t k, const double sum) {
+  return (k > 14) ? sum : lut_cx_sin_series(x2, -term * x2 / ((2*k + 2) * (2*k + 3)), k + 1, sum + term);
+}
+
+constexpr double lut_cx_sin_reduced(const double x) {
+  return lut_cx_sin_series(x * x, x, 0, 0.0);
+}
+
+/** Sine, x in radians */
+constexpr double lut_cx_sin(const double x) {
+  // Reduce to [-pi, pi] first so that the series converges quickly
+  return lut_cx_sin_reduced(x - 2*k_lut_cx_pi * lut_cx_floor(x / (2*k_lut_cx_pi) + 0.5));
+}
+
+/** Cosine, x in radians */
+constexpr double lut_cx_cos(const double x) {
+  return lut_cx_sin(x + 0.5 * k_lut_cx_pi);
+}
+
+constexpr double lut_cx_ipow(const double x, const uint32_t n) {
+  return (n == 0) ? 1.0 : (n & 1) ? x * lut_cx_ipow(x * x, n >> 1) : lut_cx_ipow(x * x, n >> 1);
+}
+
+constexpr double lut_cx_exp_series(const double x, const double term, const uint32_t k, const double sum) {
+  return (k > 20) ? sum : lut_cx_exp_series(x, term * x / (k + 1), k + 1, sum + term);
+}
+
+/** Natural exponential */
+constexpr double lut_cx_exp(const double x) {
+  // e^x = e^n * e^r with n integer and r in [0, 1)
+  return (x < 0) ? 1.0 / lut_cx_exp(-x)
+    : lut_cx_ipow(k_lut_cx_e, (uint32_t)x) * lut_cx_exp_series(x - (uint32_t)x, 1.0, 0, 0.0);
+}
+
+constexpr double lut_cx_atanh_series(const double s2, const double term, const uint32_t k, const double sum) {
+  return (k > 30) ? sum : lut_cx_atanh_series(s2, term * s2, k + 1, sum + term / (2*k + 1));
+}
+
+/** Natural logarithm, x > 0 */
+constexpr double lut_cx_log(const double x) {
+  // Scale into [1, 2) then log(x) = 2*atanh((x-1)/(x+1))
+  return (x >= 2.0) ? lut_cx_log(0.5 * x) + k_lut_cx_ln2
+    : (x < 1.0) ? lut_cx_log(2.0 * x) - k_lut_cx_ln2
+    : 2.0 * lut_cx_atanh_series(((x - 1) / (x + 1)) * ((x - 1) / (x + 1)), (x - 1) / (x + 1), 0, 0.0);
+}
+
+/** Base 2 exponential */
+constexpr double lut_cx_pow2(const double x) {
+  return lut_cx_exp(x * k_lut_cx_ln2);
+}
+
+/** Base 2 logarithm, x > 0 */
+constexpr double lut_cx_log2(const double x) {
+  return lut_cx_log(x) / k_lut_cx_ln2;
+}
+
+/** x to the power of y, x > 0 */
+constexpr double lut_cx_pow(const double x, const double y) {
+  return lut_cx_exp(y * lut_cx_log(x));
+}
+
+/** Square root, x >= 0 */
+constexpr double lut_cx_sqrt(const double x) {
+  return (x <= 0) ? 0.0 : lut_cx_exp(0.5 * lut_cx_log(x));
+}
+
+/** Hyperbolic tangent */
+constexpr double lut_cx_tanh(const double x) {
+  return (lut_cx_abs(x) > 20.0) ? ((x < 0) ? -1.0 : 1.0)
+    : (lut_cx_exp(2*x) - 1.0) / (lut_cx_exp(2*x) + 1.0);
+}
+
+/** @} */
+
+/*===========================================================================*/
+/* Lookup.                                                                   */
+/*===========================================================================*/
+
+/**
+ * @name    Lookup
+ * @note    For tables of 2^size_exp segments plus a guard point, as generated by lut_f.
+ * @{
+ */
+
+/** Linearly interpolated lookup, x in [0, 1], not checking input
+ */
+static inline __attribute__((optimize("Ofast"), always_inline))
+float lut_linintf(const float *lut, const uint32_t size_exp, const float x) {
+  const float idxf = x * (1U << size_exp);
+  // x = 1 lands on the guard point through the fractional part
+  const uint32_t idx = clipmaxu32((uint32_t)idxf, (1U << size_exp) - 1);
+  return linintf(idxf - idx, lut[idx], lut[idx+1]);
+}
+
+/** Linearly interpolated lookup of a periodic table, x >= 0 wrapped to [0, 1)
+ * @note The guard point must repeat the first entry.
+ */
+static inline __attribute__((optimize("Ofast"), always_inline))
+float lut_linintf_wrap(const float *lut, const uint32_t size_exp, const float x) {
+  const float idxf = (x - (uint32_t)x) * (1U << size_exp);
+  const uint32_t idx = (uint32_t)idxf & ((1U << size_exp) - 1);
+  return linintf(idxf - idx, lut[idx], lut[idx+1]);
+}
+
+/** @} */
+
+/*===========================================================================*/
+/* Table Generation.                                                         */
+/*===========================================================================*/
+
+/**
+ * @name    Table Generation
+ * @{
+ */
+
+/** Plain array wrapper so that tables can be returned from constexpr functions */
+template <typename T, uint32_t kSize>
+struct lut_storage {
+  T data[kSize];
+};
+
+/** Evaluate Gen::value for each index of the sequence */
+template <typename T, typename Gen, uint32_t... I>
+constexpr lut_storage<T, sizeof...(I)> lut_build(lut_seq<I...>) {
+  return {{ Gen::value(I)... }};
+}
+
+/**
+ * Constant array of kSize elements evaluated at compile time and placed in .rodata.
+ *
+ * @tparam T     Element type
+ * @tparam kSize Number of elements
+ * @tparam Gen   Type providing static constexpr T value(uint32_t i)
+ */
+template <typename T, uint32_t kSize, typename Gen>
+struct lut_array {
+  static constexpr lut_storage<T, kSize> table = lut_build<T, Gen>(typename lut_make_seq<kSize>::type());
+
+  static inline __attribute__((optimize("Ofast"), always_inline))
+  const T *data(void) {
+    return table.data;
+  }
+};
+
+template <typename T, uint32_t kSize, typename Gen>
+constexpr lut_storage<T, kSize> lut_array<T, kSize, Gen>::table;
+
+/** Sample Curve::eval at i/kSize, rounded to single precision */
+template <typename Curve, uint32_t kSize>
+struct lut_curve_sampler {
+  static constexpr float value(const uint32_t i) {
+    return (float)Curve::eval((double)i / kSize);
+  }
+};
+
+/**
+ * Interpolation ready table of a curve over [0, 1], 2^kSizeExp segments plus guard point.
+ *
+ * @tparam Curve    Type providing static constexpr double eval(double x) for x in [0, 1]
+ * @tparam kSizeExp Base 2 logarithm of the number of segments
+ *
+ * Usage:
+ * @code
+ * struct Drive { static constexpr double eval(double x) { return lut_cx_tanh(4 * x); } };
+ * typedef lut_f<Drive, 8> drive_lut;
+ * const float y = si_copysignf(drive_lut::lookup_clip(si_fabsf(x)), x);
+ * @endcode
+ */
+template <typename Curve, uint32_t kSizeExp>
+struct lut_f : lut_array<float, (1U << kSizeExp) + 1, lut_curve_sampler<Curve, (1U << kSizeExp)> > {
+
+  typedef lut_array<float, (1U << kSizeExp) + 1, lut_curve_sampler<Curve, (1U << kSizeExp)> > array_t;
+
+  enum {
+    size_exp = kSizeExp,
+    size = 1U << kSizeExp,
+    mask = (1U << kSizeExp) - 1,
+    lut_size = (1U << kSizeExp) + 1
+  };
+
+  /** Linearly interpolated lookup, x in [0, 1], not checking input */
+  static inline __attribute__((optimize("Ofast"), always_inline))
+  float lookup(const float x) {
+    return lut_linintf(array_t::table.data, kSizeExp, x);
+  }
+
+  /** Linearly interpolated lookup, x clipped to [0, 1] */
+  static inline __attribute__((optimize("Ofast"), always_inline))
+  float lookup_clip(const float x) {
+    return lut_linintf(array_t::table.data, kSizeExp, clip01f(x));
+  }
+
+  /** Linearly interpolated lookup of a periodic curve, x wrapped to [0, 1), x >= 0 */
+  static inline __attribute__((optimize("Ofast"), always_inline))
+  float lookup_wrap(const float x) {
+    return lut_linintf_wrap(array_t::table.data, kSizeExp, x);
+  }
+};
+
+/** @} */
+
+#endif // __lut_hpp
+
+/** @} @} */
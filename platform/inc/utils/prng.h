@@ -0,0 +1,238 @@
+/*
+    BSD 3-Clause License
+
+    Copyright (c) 2018, KORG INC.
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice, this
+      list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    * Neither the name of the copyright holder nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+    FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+    DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//*/
+
+
+/**
+ * @file    prng.h
+ * @brief   Inlinable pseudo random number generators and noise fills.
+ *
+ * @addtogroup utils Utils
+ * @{
+ *
+ * @addtogroup utils_prng Pseudo Random Numbers
+ * @{
+ *
+ */
+
+#ifndef __prng_h
+#define __prng_h
+
+#include "fixed_math.h"
+#include "int_math.h"
+#include "float_math.h"
+
+/**
+ * @name    Generator state
+ * @{
+ */
+
+/** Default seed, also used in place of the invalid zero seed */
+#define PRNG_DEFAULT_SEED 0x2545F491U
+
+/** Xorshift32 generator state, must never be zero
+ */
+typedef struct prng {
+  uint32_t s;
+} prng_t;
+
+/** Pink noise filter state
+ */
+typedef struct prng_pink {
+  float b0, b1, b2;
+} prng_pink_t;
+
+/** Brown noise integrator state
+ */
+typedef struct prng_brown {
+  float z;
+} prng_brown_t;
+
+/** Seed generator. Equal seeds yield equal sequences on all targets.
+ *
+ * @param st Generator state
+ * @param seed Seed value, zero selects PRNG_DEFAULT_SEED
+ */
+static inline __attribute__((always_inline))
+void prng_seed(prng_t *st, const uint32_t seed)
+{
+  st->s = (seed) ? seed : PRNG_DEFAULT_SEED;
+}
+
+/** @} */
+
+/**
+ * @name    Scalar generation
+ * @{
+ */
+
+/** Next 32-bit value (xorshift32), in [1, UINT_MAX]
+ */
+static inline __attribute__((optimize("Ofast"),always_inline))
+uint32_t prng_u32(prng_t *st)
+{
+  uint32_t x = st->s;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  st->s = x;
+  return x;
+}
+
+/** Uniform value in [-1.0, 1.0)
+ */
+static inline __attribute__((optimize("Ofast"),always_inline))
+float prng_bi_f32(prng_t *st)
+{
+  return q31_to_f32((q31_t)prng_u32(st));
+}
+
+/** Uniform value in [0.0, 1.0)
+ */
+static inline __attribute__((optimize("Ofast"),always_inline))
+float prng_uni_f32(prng_t *st)
+{
+  return (prng_u32(st) >> 8) * 5.9604644775390625e-8f; // 2^-24
+}
+
+/** Triangular value in (-1.0, 1.0), sum of two uniform 16-bit halves of one draw
+ */
+static inline __attribute__((optimize("Ofast"),always_inline))
+float prng_tri_f32(prng_t *st)
+{
+  const uint32_t x = prng_u32(st);
+  return ((int32_t)(int16_t)x + (int32_t)(int16_t)(x >> 16)) * 1.52587890625e-5f; // 2^-16
+}
+
+/** @} */
+
+/**
+ * @name    Block noise fills
+ * @{
+ */
+
+/** Fill buffer with uniform white noise in [-gain, gain)
+ */
+static inline __attribute__((optimize("Ofast"),always_inline))
+void prng_fill_white(prng_t *st,
+                     float * __restrict__ buf,
+                     const size_t len,
+                     const float gain)
+{
+  uint32_t x = st->s;
+  const float scale = gain * q31_to_f32_c;
+  for (const float *end = buf + len; buf != end; ) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *(buf++) = scale * (q31_t)x;
+  }
+  st->s = x;
+}
+
+/** Fill buffer with triangular probability density dither in (-amp, amp), i.e.: +/- 1 LSB for amp = LSB
+ */
+static inline __attribute__((optimize("Ofast"),always_inline))
+void prng_fill_tpdf_dither(prng_t *st,
+                           float * __restrict__ buf,
+                           const size_t len,
+                           const float amp)
+{
+  uint32_t x = st->s;
+  const float scale = amp * 1.52587890625e-5f;
+  for (const float *end = buf + len; buf != end; ) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *(buf++) = scale * ((int32_t)(int16_t)x + (int32_t)(int16_t)(x >> 16));
+  }
+  st->s = x;
+}
+
+/** Fill buffer with pink noise, approximately in [-gain, gain]
+ * @note Three pole economy filter, within 0.5dB of -3dB/octave above 10Hz at 48kHz.
+ */
+static inline __attribute__((optimize("Ofast"),always_inline))
+void prng_fill_pink(prng_t *st,
+                    prng_pink_t *pk,
+                    float * __restrict__ buf,
+                    const size_t len,
+                    const float gain)
+{
+  uint32_t x = st->s;
+  float b0 = pk->b0, b1 = pk->b1, b2 = pk->b2;
+  const float scale = 0.125f * gain * q31_to_f32_c;
+  for (const float *end = buf + len; buf != end; ) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    const float w = scale * (q31_t)x;
+    b0 = 0.99765f * b0 + w * 0.0990460f;
+    b1 = 0.96300f * b1 + w * 0.2965164f;
+    b2 = 0.57000f * b2 + w * 1.0526913f;
+    *(buf++) = b0 + b1 + b2 + w * 0.1848f;
+  }
+  pk->b0 = b0;
+  pk->b1 = b1;
+  pk->b2 = b2;
+  st->s = x;
+}
+
+/** Fill buffer with brown (red) noise, approximately in [-gain, gain]
+ * @note Leaky integrator of white noise, -6dB/octave above ~4Hz at 48kHz.
+ */
+static inline __attribute__((optimize("Ofast"),always_inline))
+void prng_fill_brown(prng_t *st,
+                     prng_brown_t *br,
+                     float * __restrict__ buf,
+                     const size_t len,
+                     const float gain)
+{
+  uint32_t x = st->s;
+  float z = br->z;
+  const float scale = 0.0125f * q31_to_f32_c;
+  for (const float *end = buf + len; buf != end; ) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    z = 0.9995f * z + scale * (q31_t)x;
+    *(buf++) = gain * z;
+  }
+  br->z = z;
+  st->s = x;
+}
+
+/** @} */
+
+#endif // __prng_h
+
+/** @} @} */
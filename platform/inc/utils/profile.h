@@ -0,0 +1,256 @@
+/*
+    BSD 3-Clause License
+
+    Copyright (c) 2018, KORG INC.
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice, this
+      list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    * Neither the name of the copyright holder nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+    FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+    DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//*/
+
+/**
+ * @file    profile.h
+ * @brief   Cycle count profiling of code scopes.
+ *
+ * @addtogroup utils Utils
+ * @{
+ *
+ * @addtogroup utils_profile Profiling
+ * @{
+ *
+ */
+
+#ifndef __profile_h
+#define __profile_h
+
+#include <stdint.h>
+
+/**
+ * @name    Sample ring
+ * @note    Samples of all scopes of a unit go to a single ring, found under the prof_ring symbol. The layout is the
+ *          same on target and host, so that a memory dump of the ring can be decoded by the prof_dump host tool.
+ * @{
+ */
+
+/** Ring identifier, "PROF" */
+#define PROF_MAGIC 0x464F5250U
+
+/** Maximum number of scopes, and maximum scope name length including the terminator */
+#define PROF_MAX_SCOPES 16
+#define PROF_NAME_SIZE 16
+
+/** Ring capacity in samples, power of two. Effects have room in SDRAM, oscillators share 32KB of SRAM with their code */
+#ifndef PROF_RING_SIZE
+#if defined(PROFILE_RING_SDRAM)
+#define PROF_RING_SIZE 4096
+#else
+#define PROF_RING_SIZE 256
+#endif
+#endif
+
+/** Duration of one pass through a scope
+ */
+typedef struct prof_sample {
+  uint32_t scope;
+  uint32_t ticks;
+} prof_sample_t;
+
+/** Sample ring, written by a single context
+ */
+typedef struct prof_ring {
+  uint32_t magic;
+  /** Tick rate, the core clock on target and 1GHz on host */
+  uint32_t hz;
+  uint32_t capacity;
+  /** Samples written since the ring was set up, the last capacity of them are kept */
+  volatile uint32_t head;
+  uint32_t scopes;
+  char names[PROF_MAX_SCOPES][PROF_NAME_SIZE];
+  prof_sample_t samples[PROF_RING_SIZE];
+} prof_ring_t;
+
+/** @} */
+
+#if defined(PROFILE)
+
+#if defined(__arm__) || defined(__thumb__)
+#include "cortexm4.h"
+#else
+#include <time.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @name    Tick source
+ * @{
+ */
+
+#if defined(__arm__) || defined(__thumb__)
+
+#if defined(STM32F401xC)
+#define PROF_CLOCK_HZ 84000000U
+#else
+#define PROF_CLOCK_HZ 180000000U
+#endif
+
+/** DWT cycle counter
+ */
+static inline __attribute__((always_inline))
+uint32_t prof_ticks(void)
+{
+  return DWT->CYCCNT;
+}
+
+static inline __attribute__((always_inline))
+void prof_clock_enable(void)
+{
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+#else
+
+#define PROF_CLOCK_HZ 1000000000U
+
+/** Monotonic clock in ns, wrapping at 32 bits like the cycle counter
+ */
+static inline __attribute__((always_inline))
+uint32_t prof_ticks(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)((uint64_t)ts.tv_sec * 1000000000U + (uint64_t)ts.tv_nsec);
+}
+
+static inline __attribute__((always_inline))
+void prof_clock_enable(void)
+{
+}
+
+#endif
+
+/** @} */
+
+/**
+ * @name    Scopes
+ * @{
+ */
+
+/** Ring shared by all translation units of a unit. SDRAM is not zeroed at load, the ring is set up on first use. */
+#if defined(PROFILE_RING_SDRAM)
+__attribute__((weak, section(".sdram"))) prof_ring_t prof_ring;
+#else
+__attribute__((weak)) prof_ring_t prof_ring;
+#endif
+
+typedef struct prof_scope {
+  uint32_t scope;
+  uint32_t start;
+} prof_scope_t;
+
+/** Register a scope name, on the first pass through the scope
+ *
+ * @return Scope index plus one, or zero when the scope table is full
+ */
+static __attribute__((noinline, unused))
+uint32_t prof_register(const char *name)
+{
+  prof_ring_t *r = &prof_ring;
+  if (r->magic != PROF_MAGIC) {
+    prof_clock_enable();
+    r->hz = PROF_CLOCK_HZ;
+    r->capacity = PROF_RING_SIZE;
+    r->head = 0;
+    r->scopes = 0;
+    r->magic = PROF_MAGIC;
+  }
+  if (r->scopes == PROF_MAX_SCOPES)
+    return 0;
+  char *dst = r->names[r->scopes];
+  uint32_t i = 0;
+  for (; i < PROF_NAME_SIZE - 1 && name[i]; ++i)
+    dst[i] = name[i];
+  dst[i] = '\0';
+  return ++r->scopes;
+}
+
+static inline __attribute__((always_inline))
+prof_scope_t prof_scope_begin(uint32_t *scope, const char *name)
+{
+  if (*scope == 0)
+    *scope = prof_register(name);
+  prof_scope_t s = {*scope, prof_ticks()};
+  return s;
+}
+
+/** Store the duration of a scope. The sample is written before the head moves past it, so that a reader never sees
+ *  a sample that is not complete.
+ */
+static inline __attribute__((always_inline))
+void prof_scope_end(const prof_scope_t *s)
+{
+  const uint32_t ticks = prof_ticks() - s->start;
+  if (s->scope == 0)
+    return;
+  prof_ring_t *r = &prof_ring;
+  const uint32_t head = r->head;
+  prof_sample_t *dst = &r->samples[head & (PROF_RING_SIZE - 1)];
+  dst->scope = s->scope - 1;
+  dst->ticks = ticks;
+  __asm__ volatile ("" ::: "memory");
+  r->head = head + 1;
+}
+
+#define PROF_CAT_(a, b) a##b
+#define PROF_CAT(a, b) PROF_CAT_(a, b)
+
+/** Time the enclosing block from this point to its end, under the given name (string literal, 15 characters at most)
+ */
+#define PROF_SCOPE(name)                                                \
+  static uint32_t PROF_CAT(__prof_id_, __LINE__);                       \
+  const prof_scope_t PROF_CAT(__prof_scope_, __LINE__)                  \
+    __attribute__((cleanup(prof_scope_end), unused)) =                  \
+    prof_scope_begin(&PROF_CAT(__prof_id_, __LINE__), (name))
+
+#ifdef __cplusplus
+}
+#endif
+
+#else
+
+/** Compiled out unless PROFILE is defined, by building with PROFILE=1 */
+#define PROF_SCOPE(name) do { } while (0)
+
+#endif
+
+/** @} */
+
+#endif // __profile_h
+
+/** @} @} */
@@ -68,6 +68,14 @@ DLIBS = -lm
 DADEFS = $(MDEFS) -DCORTEX_USE_FPU=TRUE -DARM_MATH_CM4 -D__FPU_PRESENT
 DDEFS = $(MDEFS) -DCORTEX_USE_FPU=TRUE -DARM_MATH_CM4 -D__FPU_PRESENT
 
+# PROF_SCOPE instrumentation, see inc/utils/profile.h. Effects keep the sample ring in SDRAM.
+ifeq ($(PROFILE),1)
+  DDEFS += -DPROFILE
+ifeq (,$(findstring k_user_module_osc,$(MDEFS)))
+  DDEFS += -DPROFILE_RING_SDRAM
+endif
+endif
+
 COPT = -std=c11 -mstructure-size-boundary=8
 CXXOPT = -std=c++11 -fno-rtti -fno-exceptions -fno-non-call-exceptions
 
@@ -78,13 +86,109 @@ CXXWARN = -W -Wall -Wextra
 
 FPU_OPTS = -mfloat-abi=hard -mfpu=fpv4-sp-d16 -fsingle-precision-constant -fcheck-new
 
-OPT = -g -Os -mlittle-endian
+# Optimization profiles, set OPTPROFILE in project.mk or on the command line
+OPTPROFILES = size speed fast lto-speed
+OPTPROFILE ?= size
+
+ifeq ($(OPTPROFILE),size)
+  OPT = -g -Os -mlittle-endian
+else ifeq ($(OPTPROFILE),speed)
+  OPT = -g -O2 -mlittle-endian
+else ifeq ($(OPTPROFILE),fast)
+  OPT = -g -O3 -mlittle-endian
+else ifeq ($(OPTPROFILE),lto-speed)
+  OPT = -g -O2 -mlittle-endian -flto
+else
+  $(error Unknown OPTPROFILE $(OPTPROFILE), expected one of: $(OPTPROFILES))
+endif
 OPT += $(FPU_OPTS)
-#OPT += -flto
 
 TOPT = -mthumb -mno-thumb-interwork -DTHUMB_NO_INTERWORKING -DTHUMB_PRESENT
 
 
+# #############################################################################
+# configure worst-case execution time analysis (host tool)
+# #############################################################################
+
+HOSTDIR = $(PLATFORMDIR)/../host
+WCET = $(HOSTDIR)/build/wcet
+
+# Core clock and flash wait states of the target MCU, oscillators have no SDRAM
+ifneq (,$(findstring STM32F401,$(MDEFS)))
+  WCETFLAGS = -c 84 -f 2
+else
+  WCETFLAGS = -c 180 -f 5
+endif
+ifneq (,$(findstring k_user_module_osc,$(MDEFS)))
+  WCETFLAGS += -s 0
+endif
+
+# #############################################################################
+# configure stack usage check (host tool)
+# #############################################################################
+
+STACKCHECK = $(HOSTDIR)/build/stack_check
+
+# Hooks run on the firmware stack, the build fails when a hook call chain needs more (bytes)
+STACK_BUDGET ?= 1024
+
+# #############################################################################
+# configure optimization profile matrix
+# #############################################################################
+
+PROFILEDIR = $(BUILDDIR)/profile
+
+# Fast SRAM of the module in KiB, from the linker script
+SRAMSIZE = $(shell sed -n 's/^ *SRAM .*len *= *\([0-9]*\)K.*/\1/p' $(LDSCRIPT))
+
+# #############################################################################
+# configure object cache
+# #############################################################################
+
+# Objects are shared between projects and platforms by a hash of the preprocessed source and of the compiler flags
+# that don't reach the preprocessor. Set OBJCACHEDIR empty to disable.
+OBJCACHEDIR ?= $(PLATFORMDIR)/../build/objcache
+
+ifeq ($(detected_OS),Darwin)
+  HASH = shasum
+else
+  HASH = sha1sum
+endif
+
+# #############################################################################
+# configure native host build (make host)
+# #############################################################################
+
+HOSTCC   = gcc
+HOSTCXXC = g++
+HOSTSZ   = size
+
+# Same options as the units of the host Makefile, the firmware API resolves against the host runtime at load time
+HOSTOPT = -O2 -g -fPIC -MMD -MP
+HOSTCOPT = -std=c11
+HOSTCXXOPT = -std=c++11 -fno-rtti -fno-exceptions
+
+# Target, module and instrumentation definitions only, MCU definitions select Cortex-M4 code in CMSIS
+HOSTDEFS = $(filter -DUSER_TARGET_% -DPROFILE%,$(DDEFS)) $(UDEFS)
+
+# SDRAM of the module in KiB, from the linker script, for the size check of __sdram data
+SDRAMSIZE = $(shell sed -n 's/^ *SDRAM .*len *= *\([0-9]*\)K.*/\1/p' $(LDSCRIPT))
+
+# Memory access tracing, see host/src/mem_trace.h. The unit is linked without libtsan, the host tool provides the
+# instrumentation entry points.
+ifeq ($(MEMTRACE),1)
+  HOSTOPT += -fsanitize=thread --param tsan-instrument-func-entry-exit=0
+endif
+
+# #############################################################################
+# configure SRAM placement advisor (host tool)
+# #############################################################################
+
+SRAMADVISOR = $(HOSTDIR)/build/sram_advisor
+
+# Header of section attributes written by make placement, extra options can be set with USRAMADVISORFLAGS
+PLACEMENTHDR ?= $(PROJECTDIR)/placement.h
+
 # #############################################################################
 # set targets and directories
 # #############################################################################
@@ -96,6 +200,9 @@ PAYLOAD = payload.bin
 BUILDDIR = $(PROJECTDIR)/build
 OBJDIR = $(BUILDDIR)/obj
 LSTDIR = $(BUILDDIR)/lst
+DEPDIR = $(BUILDDIR)/.dep
+# Staged in the build directory, so that builds for several platforms can package at once
+PKGSTAGEDIR = $(BUILDDIR)/pkg
 
 ASMSRC = $(PROJECTDIR)/$(UASMSRC)
 
@@ -117,6 +224,25 @@ CXXOBJS := $(addprefix $(OBJDIR)/, $(notdir $(CXXSRC:.cpp=.o)))
 
 OBJS := $(ASMXOBJS) $(ASMOBJS) $(COBJS) $(CXXOBJS)
 
+HOSTBUILDDIR = $(BUILDDIR)/host
+# Traced objects are kept apart so that switching does not mix builds
+ifeq ($(MEMTRACE),1)
+  HOSTBUILDDIR = $(BUILDDIR)/host_memtrace
+endif
+HOSTOBJDIR = $(HOSTBUILDDIR)/obj
+HOSTUNIT = $(HOSTBUILDDIR)/$(PROJECT).so
+
+# The host entry replaces the entry template of the module
+HOSTCOBJS := $(patsubst $(OBJDIR)/%,$(HOSTOBJDIR)/%,$(filter-out $(OBJDIR)/$(MCSRC:.c=.o),$(COBJS))) \
+	     $(HOSTOBJDIR)/unit_entry.o
+HOSTCXXOBJS := $(patsubst $(OBJDIR)/%,$(HOSTOBJDIR)/%,$(CXXOBJS))
+HOSTOBJS := $(HOSTCOBJS) $(HOSTCXXOBJS)
+
+# Objects are named after their source file only
+ifneq ($(words $(OBJS)),$(words $(sort $(OBJS))))
+  $(error Source files with the same name would build the same object: $(sort $(foreach o,$(OBJS),$(if $(filter-out 1,$(words $(filter $(o),$(OBJS)))),$(notdir $(o))))))
+endif
+
 DINCDIR = $(PROJECTDIR)/inc \
 	  $(PROJECTDIR)/inc/api \
           $(PLATFORMDIR)/../inc \
@@ -125,6 +251,7 @@ DINCDIR = $(PROJECTDIR)/inc \
           $(CMSISDIR)/Include
 
 INCDIR := $(patsubst %,-I%,$(DINCDIR) $(UINCDIR))
+HOSTINCDIR := $(patsubst %,-I%,$(filter-out $(CMSISDIR)/Include,$(DINCDIR)) $(UINCDIR))
 
 DEFS := $(DDEFS) $(UDEFS)
 ADEFS := $(DADEFS) $(UADEFS)
@@ -141,9 +268,9 @@ LIBDIR := $(patsubst %,-I%,$(DLIBDIR) $(ULIBDIR))
 MCFLAGS   := -mcpu=$(MCU)
 ODFLAGS	  = -x --syms
 ASFLAGS   = $(MCFLAGS) -g $(TOPT) -Wa,-alms=$(LSTDIR)/$(notdir $(<:.s=.lst)) $(ADEFS)
-ASXFLAGS  = $(MCFLAGS) -g $(TOPT) -Wa,-alms=$(LSTDIR)/$(notdir $(<:.S=.lst)) $(ADEFS)
-CFLAGS    = $(MCFLAGS) $(TOPT) $(OPT) $(COPT) $(CWARN) -Wa,-alms=$(LSTDIR)/$(notdir $(<:.c=.lst)) $(DEFS)
-CXXFLAGS  = $(MCFLAGS) $(TOPT) $(OPT) $(CXXOPT) $(CXXWARN) -Wa,-alms=$(LSTDIR)/$(notdir $(<:.cpp=.lst)) $(DEFS)
+ASXFLAGS  = $(MCFLAGS) -g $(TOPT) -Wa,-alms=$(LSTDIR)/$(notdir $(<:.S=.lst)) $(ADEFS) -MMD -MP -MF $(DEPDIR)/$(@F).d
+CFLAGS    = $(MCFLAGS) $(TOPT) $(OPT) $(UOPT_$(<F)) $(COPT) $(CWARN) -fstack-usage -Wa,-alms=$(LSTDIR)/$(notdir $(<:.c=.lst)) $(DEFS)
+CXXFLAGS  = $(MCFLAGS) $(TOPT) $(OPT) $(UOPT_$(<F)) $(CXXOPT) $(CXXWARN) -fstack-usage -Wa,-alms=$(LSTDIR)/$(notdir $(<:.cpp=.lst)) $(DEFS)
 LDFLAGS   = $(MCFLAGS) $(TOPT) $(OPT) -nostartfiles $(LIBDIR) -Wl,-Map=$(BUILDDIR)/$(PROJECT).map,--cref,--no-warn-mismatch,--library-path=$(RULESPATH),--script=$(LDSCRIPT) $(LDOPT)
 
 OUTFILES := $(BUILDDIR)/$(PROJECT).elf \
@@ -160,9 +287,9 @@ all: PRE_ALL $(OBJS) $(OUTFILES) POST_ALL
 
 PRE_ALL:
 
-POST_ALL: package
+POST_ALL: stack package
 
-$(OBJS): | $(BUILDDIR) $(OBJDIR) $(LSTDIR)
+$(OBJS): | $(BUILDDIR) $(OBJDIR) $(LSTDIR) $(DEPDIR)
 
 $(BUILDDIR):
 	@echo Compiler Options
@@ -176,6 +303,42 @@ $(OBJDIR):
 $(LSTDIR):
 	@mkdir -p $(LSTDIR)
 
+$(DEPDIR):
+	@mkdir -p $(DEPDIR)
+
+comma := ,
+
+# $(call cached_compile,compiler,flags)
+# Dependencies are written by the preprocessor pass that computes the cache key. The key also holds the build
+# directory and the real paths of the sources, which the debug information and listings refer to, so that entries
+# are only shared by builds of the same files, e.g. the platforms of a multi-platform build. Object, stack usage and
+# listing are taken from the cache on a hit. Otherwise they are stored through temporary files, the object last, so
+# that concurrent builds never see a partial entry.
+define cached_compile
+	pp=$(DEPDIR)/$(@F).i; \
+	$(1) -E $(2) -I. $(INCDIR) -MMD -MP -MF $(DEPDIR)/$(@F).d -MT $@ $< > $$pp || exit 1; \
+	key=`( sed 's|^\(# *[0-9]* "\).*/|\1|' $$pp; \
+	       sed -n 's|^# *[0-9]* "\([^"<]*\)".*|\1|p' $$pp | while read f; do realpath "$$f"; done | sort -u; \
+	       echo $(CURDIR) $(1) $(filter-out -D% -I% -Wa$(comma)%,$(2)) ) | $(HASH) | cut -c1-40`; \
+	rm -f $$pp; \
+	lst=$(LSTDIR)/$(basename $(<F)).lst; \
+	entry=$(OBJCACHEDIR)/$$key; \
+	if [ -n "$(OBJCACHEDIR)" ] && [ -f $$entry.o ]; then \
+	  rm -f $(@:.o=.su) $$lst; \
+	  cp $$entry.o $@ || exit 1; \
+	  [ ! -f $$entry.su ] || cp $$entry.su $(@:.o=.su); \
+	  [ ! -f $$entry.lst ] || cp $$entry.lst $$lst; \
+	else \
+	  $(1) -c $(2) -I. $(INCDIR) $< -o $@ || exit 1; \
+	  if [ -n "$(OBJCACHEDIR)" ] && mkdir -p $(OBJCACHEDIR); then \
+	    for ext in su lst o; do \
+	      case $$ext in su) f=$(@:.o=.su);; lst) f=$$lst;; o) f=$@;; esac; \
+	      [ ! -f $$f ] || { cp $$f $$entry.$$ext.$$$$ && mv $$entry.$$ext.$$$$ $$entry.$$ext; }; \
+	    done; \
+	  fi; \
+	fi
+endef
+
 $(ASMOBJS) : $(OBJDIR)/%.o : %.s
 	@echo Assembling $(<F)
 	@$(AS) -c $(ASFLAGS) -I. $(INCDIR) $< -o $@
@@ -186,11 +349,11 @@ $(ASMXOBJS) : $(OBJDIR)/%.o : %.S
 
 $(COBJS) : $(OBJDIR)/%.o : %.c
 	@echo Compiling $(<F)
-	@$(CC) -c $(CFLAGS) -I. $(INCDIR) $< -o $@
+	@$(call cached_compile,$(CC),$(CFLAGS))
 
 $(CXXOBJS) : $(OBJDIR)/%.o : %.cpp
 	@echo Compiling $(<F)
-	@$(CXXC) -c $(CXXFLAGS) -I. $(INCDIR) $< -o $@
+	@$(call cached_compile,$(CXXC),$(CXXFLAGS))
 
 $(BUILDDIR)/%.elf: $(OBJS) $(LDSCRIPT)
 	@echo Linking $@
@@ -215,18 +378,108 @@ $(BUILDDIR)/%.elf: $(OBJS) $(LDSCRIPT)
 	@echo Creating $@
 	@$(OD) -S $< > $@
 
+wcet: $(BUILDDIR)/$(PROJECT).list
+	@$(MAKE) -s -C $(HOSTDIR) build/wcet
+	@$(WCET) $(WCETFLAGS) $(UWCETFLAGS) $<
+
+stack: $(BUILDDIR)/$(PROJECT).list
+ifneq (,$(findstring -flto,$(OPT)))
+	@echo "No per function stack usage with link time optimization, skipping stack usage check"
+else
+	@if ! command -v $(HOSTCXXC) > /dev/null 2>&1; then \
+	  echo "Host compiler not found, skipping stack usage check"; \
+	else \
+	  $(MAKE) -s -C $(HOSTDIR) build/stack_check > /dev/null || exit 1; \
+	  echo Checking stack usage; \
+	  $(STACKCHECK) -b $(STACK_BUDGET) $< $(OBJDIR); \
+	fi
+endif
+
+# Code and data in SRAM and SDRAM, and worst-case cycles of the cycle/process hook, under each optimization profile
+profile-matrix:
+	@if ! command -v $(HOSTCXXC) > /dev/null 2>&1; then \
+	  echo "Host compiler not found, no cycle counts"; \
+	else \
+	  $(MAKE) -s -C $(HOSTDIR) build/wcet > /dev/null || exit 1; \
+	fi
+	@for p in $(OPTPROFILES); do \
+	  echo Building $$p profile; \
+	  $(MAKE) --no-print-directory OPTPROFILE=$$p BUILDDIR=$(PROFILEDIR)/$$p $(PROFILEDIR)/$$p/$(PROJECT).list > /dev/null || exit 1; \
+	done
+	@echo
+	@printf "%-10s %8s %9s %8s %10s\n" profile SRAM "of $(SRAMSIZE)K" SDRAM cycles
+	@for p in $(OPTPROFILES); do \
+	  $(SZ) -A $(PROFILEDIR)/$$p/$(PROJECT).elf | awk -v p=$$p -v kb=$(SRAMSIZE) \
+	    '$$3 >= 536870912 && $$3 < 805306368 { sram += $$2 } $$3 >= 3221225472 { sdram += $$2 } \
+	     END { printf "%-10s %8d %8.1f%% %8d ", p, sram, 100.0 * sram / (kb * 1024), sdram }'; \
+	  if [ -x $(WCET) ]; then \
+	    $(WCET) $(WCETFLAGS) $(UWCETFLAGS) $(PROFILEDIR)/$$p/$(PROJECT).list \
+	      | awk '/^_hook_(cycle|process): [0-9]/ { c = $$2 } END { printf "%10s\n", c == "" ? "n/a" : c }'; \
+	  else \
+	    echo; \
+	  fi; \
+	done
+
+# Native shared object of the unit, for the tools of the host runtime, see host/README.md
+host: $(HOSTUNIT)
+ifneq (,$(strip $(UASMSRC) $(UASMXSRC)))
+	$(error Assembly sources can't be built for the host)
+endif
+	@if [ -n "$(SDRAMSIZE)" ]; then \
+	  $(HOSTSZ) -A $(HOSTUNIT) | awk -v kb=$(SDRAMSIZE) \
+	    '$$1 == ".sdram" && $$2 > kb * 1024 { printf "__sdram data of %d bytes exceeds the %dK of SDRAM\n", $$2, kb; exit 1 }'; \
+	fi
+
+# SRAM or SDRAM placement of zero-initialized data from the accesses of a host render, see host/README.md. The SRAM
+# budget is what the code and initialized data of the device build leave, the default of the tool without one.
+placement:
+ifneq (,$(findstring k_user_module_osc,$(MDEFS)))
+	$(error Oscillators have no SDRAM, nothing to place)
+endif
+	@$(MAKE) --no-print-directory MEMTRACE=1 host
+	@$(MAKE) -s -C $(HOSTDIR) build/sram_advisor
+	@budget=; \
+	if [ -f $(BUILDDIR)/$(PROJECT).elf ]; then \
+	  budget=`$(SZ) -A $(BUILDDIR)/$(PROJECT).elf | awk -v kb=$(SRAMSIZE) \
+	    '$$1 != ".bss" && $$3 >= 536870912 && $$3 < 805306368 { used += $$2 } END { print kb * 1024 - used }'`; \
+	fi; \
+	$(SRAMADVISOR) $${budget:+-b $$budget} $(USRAMADVISORFLAGS) -o $(PLACEMENTHDR) $(BUILDDIR)/host_memtrace/$(PROJECT).so
+
+$(HOSTOBJS): | $(HOSTOBJDIR)
+
+$(HOSTOBJDIR):
+	@mkdir -p $(HOSTOBJDIR)
+
+$(filter-out %/unit_entry.o,$(HOSTCOBJS)) : $(HOSTOBJDIR)/%.o : %.c
+	@echo Compiling $(<F) for host
+	@$(HOSTCC) -c $(HOSTOPT) $(HOSTCOPT) $(CWARN) $(HOSTDEFS) -I. $(HOSTINCDIR) $< -o $@
+
+$(HOSTOBJDIR)/unit_entry.o: $(HOSTDIR)/src/unit_entry.c
+	@echo Compiling $(<F) for host
+	@$(HOSTCC) -c $(HOSTOPT) $(HOSTCOPT) $(CWARN) $(HOSTDEFS) -I. $(HOSTINCDIR) $< -o $@
+
+$(HOSTCXXOBJS) : $(HOSTOBJDIR)/%.o : %.cpp
+	@echo Compiling $(<F) for host
+	@$(HOSTCXXC) -c $(HOSTOPT) $(HOSTCXXOPT) $(CXXWARN) $(HOSTDEFS) -I. $(HOSTINCDIR) $< -o $@
+
+$(HOSTUNIT): $(HOSTOBJS)
+	@echo Linking $@
+	@$(HOSTCXXC) -shared $(HOSTOBJS) -o $@ -lm
+
 clean:
 	@echo Cleaning
 	-rm -fR .dep $(BUILDDIR) $(PROJECTDIR)/$(PKGARCH)
 	@echo
 	@echo Done
 
-package:
+package: $(BUILDDIR)/$(PROJECT).bin
 	@echo Packaging to $(PROJECTDIR)/$(PKGARCH)
-	@mkdir -p $(PKGDIR)
-	@([ ! -z "$(PLATFORM)" ] && (sed -E s'/^( *"platform" *: *")[^"]+(.*)$$/\1$(PLATFORM)\2/' $(PROJECTDIR)/$(MANIFEST) > $(PKGDIR)/$(MANIFEST))) || cp -a $(PROJECTDIR)/$(MANIFEST) $(PKGDIR)/
-	@cp -a $(BUILDDIR)/$(PROJECT).bin $(PKGDIR)/$(PAYLOAD)
-	@$(ZIP) $(ZIP_ARGS) $(PROJECT).zip $(PKGDIR)
-	@mv $(PROJECT).zip $(PROJECTDIR)/$(PKGARCH)
+	@mkdir -p $(PKGSTAGEDIR)/$(PKGDIR)
+	@([ ! -z "$(PLATFORM)" ] && (sed -E s'/^( *"platform" *: *")[^"]+(.*)$$/\1$(PLATFORM)\2/' $(PROJECTDIR)/$(MANIFEST) > $(PKGSTAGEDIR)/$(PKGDIR)/$(MANIFEST))) || cp -a $(PROJECTDIR)/$(MANIFEST) $(PKGSTAGEDIR)/$(PKGDIR)/
+	@cp -a $(BUILDDIR)/$(PROJECT).bin $(PKGSTAGEDIR)/$(PKGDIR)/$(PAYLOAD)
+	@cd $(PKGSTAGEDIR) && $(abspath $(ZIP)) $(ZIP_ARGS) $(PROJECT).zip $(PKGDIR)
+	@mv $(PKGSTAGEDIR)/$(PROJECT).zip $(PROJECTDIR)/$(PKGARCH)
 	@echo
 	@echo Done
+
+-include $(wildcard $(DEPDIR)/*.d) $(wildcard $(HOSTOBJDIR)/*.d)
@@ -40,13 +40,17 @@
 
 #include "userosc.h"
 #include "waves.hpp"
+#include "smoother.hpp"
+#include "prng.h"
 
 static Waves s_waves;
+static prng_t s_prng;
 
 void OSC_INIT(uint32_t platform, uint32_t api)
 {
   (void)platform;
   (void)api;
+  prng_seed(&s_prng, PRNG_DEFAULT_SEED);
 }
 
 void OSC_CYCLE(const user_osc_param_t * const params,
@@ -84,12 +88,12 @@ void OSC_CYCLE(const user_osc_param_t * const params,
   float phisub = s.phisub;
 
   float lfoz = s.lfoz;
-  const float lfo_inc = (s.lfo - lfoz) / frames;
+  const float lfo_inc = (s.lfo - lfoz) * dsp::frames_recipf(frames);
   
-  const float ditheramt = p.bitcrush * 2e-008f;
-  
-  const float bitres = osc_bitresf(p.bitcrush);
-  const float bitres_recip = 1.f / bitres;
+  // Dither noise filled per block, reused cyclically past 64 frames
+  float dither[64];
+  prng_fill_tpdf_dither(&s_prng, dither, (frames < 64) ? frames : 64, s.dither);
+  uint32_t ditheridx = 0;
 
   const float submix = p.submix;
   const float ringmix = p.ringmix;
@@ -113,7 +117,7 @@ void OSC_CYCLE(const user_osc_param_t * const params,
     sig = clip1m1f(sig);
     
     sig = prelpf.process_fo(sig);
-    sig += s.dither * osc_white();
+    sig += dither[(ditheridx++) & 0x3F];
     sig = si_roundf(sig * s.bitres) * s.bitresrcp;
     sig = postlpf.process_fo(sig);
     sig = osc_softclipf(0.125f, sig);
@@ -0,0 +1,19 @@
+# #############################################################################
+# Project Customization
+# #############################################################################
+
+include $(PLATFORMDIR)/modfx.mk
+
+PROJECT = dynamics_test
+
+UCSRC = 
+
+UCXXSRC = ../src/dynamics.cpp
+
+UINCDIR =
+
+UDEFS =
+
+ULIB = 
+
+ULIBDIR =
@@ -12,18 +12,20 @@
 #include "usermodfx.h"
 
 #include "delayline.hpp"
+#include "smoother.hpp"
 
 static dsp::DualDelayLine s_delay;
 
 static __sdram f32pair_t s_delay_ram[8192];
 
-static float s_len_z, s_len;
+static dsp::OnePoleSmoother s_len;
 static const float s_fs_recip = 1.f / 48000.f;
 
 void MODFX_INIT(uint32_t platform, uint32_t api)
 {
   s_delay.setMemory(s_delay_ram, 8192);  
-  s_len = s_len_z = 1.f;
+  s_len.reset(1.f);
+  s_len.setCoeff(0.00004f);
 }
 
 void MODFX_PROCESS(const float *main_xn, float *main_yn,
@@ -37,15 +39,14 @@ void MODFX_PROCESS(const float *main_xn, float *main_yn,
   const float *sx = sub_xn;
   float * __restrict sy = sub_yn;
   
-  const float len = s_len;
-  float len_z = s_len_z;
+  dsp::OnePoleSmoother len = s_len;
   
   for (; my != my_e; ) {
     
     *(my++) = *(mx++);
     *(sy++) = *(sx++);
     
-    len_z = linintf(0.00004f, len_z, len);
+    const float len_z = len.next();
     
     const f32pair_t r = s_delay.readFrac(len_z);
     s_delay.write((f32pair_t){*(mx++), *(sx++)});
@@ -54,7 +55,7 @@ void MODFX_PROCESS(const float *main_xn, float *main_yn,
     *(sy++) = r.b;
   }
 
-  s_len_z = len_z;
+  s_len = len;
 }
 
 
@@ -65,7 +66,7 @@ void MODFX_PARAM(uint8_t index, int32_t value)
   case k_user_modfx_param_time:
     break;
   case k_user_modfx_param_depth:
-    s_len = 1 + valf * valf * 0.1f * 48000.f; // up to 100ms delay
+    s_len.setTarget(1 + valf * valf * 0.1f * 48000.f); // up to 100ms delay
     break;
   default:
     break;
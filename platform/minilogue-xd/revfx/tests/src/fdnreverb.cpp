@@ -0,0 +1,74 @@
+/*
+ * File: fdnreverb.cpp
+ *
+ * Test feedback delay network reverb with lines in SDRAM
+ *
+ * 
+ * 
+ * 2018 (c) Korg
+ *
+ */
+
+#include "userrevfx.h"
+
+#include "fdnreverb.hpp"
+
+typedef dsp::FDNReverb<8, dsp::k_fdn_mixing_hadamard> Reverb;
+
+#define MAX_LENGTH 4800
+
+static Reverb s_reverb;
+
+static __sdram float s_reverb_ram[Reverb::memorySize(MAX_LENGTH)];
+
+static float s_mix;
+static const float s_fs_recip = 1.f / 48000.f;
+
+void REVFX_INIT(uint32_t platform, uint32_t api)
+{
+  s_reverb.init(s_reverb_ram, 700, MAX_LENGTH);
+  s_reverb.setDecay(2.f, s_fs_recip);
+  s_reverb.setDamping(fx_tanpif(0.1667f));
+  s_reverb.setModulation(0.5f, 8.f, s_fs_recip);
+  s_mix = 0.5f;
+}
+
+void REVFX_PROCESS(float *xn, uint32_t frames)
+{
+  float * __restrict x = xn;
+  const float * x_e = x + 2*frames;
+
+  const float dry = 1.f - s_mix;
+  const float wet = s_mix;
+
+  float wet_buf[2*64];
+  
+  for (; x != x_e; ) {
+    const uint32_t n = (x_e - x) > 2*64 ? 64 : (x_e - x) / 2;
+    s_reverb.process(x, wet_buf, n);
+    for (uint32_t i = 0; i < 2*n; ++i)
+      x[i] = dry * x[i] + wet * wet_buf[i];
+    x += 2*n;
+  }
+}
+
+
+void REVFX_PARAM(uint8_t index, int32_t value)
+{
+  const float valf = q31_to_f32(value);
+  switch (index) {
+  case k_user_revfx_param_time:
+    s_reverb.setDecay(0.2f + 9.8f * valf * valf, s_fs_recip);
+    break;
+  case k_user_revfx_param_depth:
+    s_mix = valf;
+    break;
+  case k_user_revfx_param_shift_depth:
+    // Damping cutoff from ~23.5kHz down to ~1kHz
+    s_reverb.setDamping(fx_tanpif(0.02f + 0.47f * (1.f - valf)));
+    break;
+  default:
+    break;
+  }
+}
+
@@ -0,0 +1,19 @@
+# #############################################################################
+# Project Customization
+# #############################################################################
+
+include $(PLATFORMDIR)/delfx.mk
+
+PROJECT = granular_test
+
+UCSRC = 
+
+UCXXSRC = ../src/granular.cpp
+
+UINCDIR =
+
+UDEFS =
+
+ULIB = 
+
+ULIBDIR =
@@ -39,6 +39,7 @@
  */
 
 #include "userosc.h"
+#include "lut.hpp"
 
 #define k_pad_size 0x1f25
 
@@ -51,27 +52,18 @@ typedef struct State {
   uint8_t flags;
 } State;
 
-#define DUMMY(x)   (x), (x)+1, (x)+2, (x)+3, (x)+4, (x)+5, (x)+6, (x)+7
-#define DUMMY4(x)  DUMMY(x), DUMMY((x)+8), DUMMY((x)+16), DUMMY((x)+24)
-#define DUMMY8(x)  DUMMY4(x), DUMMY4((x)+32), DUMMY4((x)+64), DUMMY4((x)+96)
-#define DUMMY16(x) DUMMY8(x), DUMMY8((x)+128), DUMMY8((x)+256), DUMMY8((x)+384)
-#define DUMMY32(x) DUMMY16(x), DUMMY16((x)+512), DUMMY16((x)+1024), DUMMY16((x)+1536)
-
 static State s_state;
 
-static const uint32_t k_pad_data[k_pad_size] __attribute__((used)) = {
-    DUMMY32(0), 
-    DUMMY32(2048),
-    DUMMY32(2*2048),
-    DUMMY16(3*2048),
-    DUMMY16(3*2048+512),
-    DUMMY16(3*2048+2*512),
-    DUMMY8(3*2048+3*512),
-    DUMMY8(3*2048+3*512+128),
-    DUMMY4(3*2048+3*512+2*128),
-    0, 1, 2, 3, 4
+/** Padding word i holds i, the last 5 words hold 0 to 4 */
+struct PadWords {
+  static constexpr uint32_t value(const uint32_t i) {
+    return (i < k_pad_size - 5) ? i : i - (k_pad_size - 5);
+  }
 };
 
+/** Explicit instantiation emits the padding table, generated at compile time */
+template struct lut_array<uint32_t, k_pad_size, PadWords>;
+
 enum {
   k_flags_none = 0,
   k_flag_reset = 1<<0,
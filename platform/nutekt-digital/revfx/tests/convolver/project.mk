@@ -0,0 +1,19 @@
+# #############################################################################
+# Project Customization
+# #############################################################################
+
+include $(PLATFORMDIR)/revfx.mk
+
+PROJECT = convolver_test
+
+UCSRC = 
+
+UCXXSRC = ../src/convolver.cpp
+
+UINCDIR =
+
+UDEFS =
+
+ULIB = 
+
+ULIBDIR =
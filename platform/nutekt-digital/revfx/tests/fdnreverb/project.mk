@@ -0,0 +1,19 @@
+# #############################################################################
+# Project Customization
+# #############################################################################
+
+include $(PLATFORMDIR)/revfx.mk
+
+PROJECT = fdnreverb_test
+
+UCSRC = 
+
+UCXXSRC = ../src/fdnreverb.cpp
+
+UINCDIR =
+
+UDEFS =
+
+ULIB = 
+
+ULIBDIR =
@@ -0,0 +1,75 @@
+/*
+ * File: convolver.cpp
+ *
+ * Test partitioned convolution with an impulse response in SDRAM
+ *
+ * 
+ * 
+ * 2018 (c) Korg
+ *
+ */
+
+#include "userrevfx.h"
+
+#include "convolver.hpp"
+
+typedef dsp::Convolver<32, 8, 2> Convolver;
+
+#define IR_LEN 48000
+
+static Convolver s_conv;
+
+static __sdram float s_ir[IR_LEN];
+static __sdram float s_conv_ram[Convolver::memorySize(IR_LEN)];
+
+static float s_mix;
+
+void REVFX_INIT(uint32_t platform, uint32_t api)
+{
+  // Exponentially decaying noise, -60dB at the end
+  float env = 0.05f;
+  const float decay = fastpow2f(-9.966f / IR_LEN);
+  for (uint32_t i = 0; i < IR_LEN; ++i) {
+    s_ir[i] = env * fx_white();
+    env *= decay;
+  }
+  s_conv.init(s_conv_ram, Convolver::memorySize(IR_LEN), s_ir, IR_LEN);
+  s_mix = 0.5f;
+}
+
+void REVFX_PROCESS(float *xn, uint32_t frames)
+{
+  float * __restrict x = xn;
+  const float * x_e = x + 2*frames;
+
+  const float dry = 1.f - s_mix;
+  const float wet = s_mix;
+
+  float wet_buf[2*64];
+  
+  for (; x != x_e; ) {
+    const uint32_t n = (x_e - x) > 2*64 ? 64 : (x_e - x) / 2;
+    s_conv.process(x, wet_buf, n);
+    for (uint32_t i = 0; i < 2*n; ++i)
+      x[i] = dry * x[i] + wet * wet_buf[i];
+    x += 2*n;
+  }
+}
+
+
+void REVFX_PARAM(uint8_t index, int32_t value)
+{
+  const float valf = q31_to_f32(value);
+  switch (index) {
+  case k_user_revfx_param_time:
+    break;
+  case k_user_revfx_param_depth:
+    s_mix = valf;
+    break;
+  case k_user_revfx_param_shift_depth:
+    break;
+  default:
+    break;
+  }
+}
+
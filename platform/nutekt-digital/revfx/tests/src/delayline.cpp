@@ -12,19 +12,21 @@
 #include "userrevfx.h"
 
 #include "delayline.hpp"
+#include "smoother.hpp"
 
 static dsp::DelayLine s_delay;
 
-static __sdram float s_delay_ram[48000];
+static __sdram float s_delay_ram[65536];
 
-static float s_len_z, s_len;
+static dsp::OnePoleSmoother s_len;
 static float s_mix;
 static const float s_fs_recip = 1.f / 48000.f;
 
 void REVFX_INIT(uint32_t platform, uint32_t api)
 {
-  s_delay.setMemory(s_delay_ram, 48000);  
-  s_len = s_len_z = 1.f;
+  s_delay.setMemory(s_delay_ram, 65536);  
+  s_len.reset(1.f);
+  s_len.setCoeff(0.00004f);
   s_mix = 1.f;
 }
 
@@ -33,8 +35,7 @@ void REVFX_PROCESS(float *xn, uint32_t frames)
   float * __restrict x = xn;
   const float * x_e = x + 2*frames;
   
-  const float len = s_len;
-  float len_z = s_len_z;
+  dsp::OnePoleSmoother len = s_len;
 
   const float dry = 1.f - s_mix;
   const float wet = s_mix;
@@ -43,14 +44,14 @@ void REVFX_PROCESS(float *xn, uint32_t frames)
     
     *(x++);
     
-    len_z = linintf(0.00004f, len_z, len);
+    const float len_z = len.next();
     
     const float r = 0.25f * s_delay.readFrac(len_z);
     s_delay.write(*x);
     *(x++) = dry * (*x) + wet * r;
   }
 
-  s_len_z = len_z;
+  s_len = len;
 }
 
 
@@ -61,7 +62,7 @@ void REVFX_PARAM(uint8_t index, int32_t value)
   case k_user_revfx_param_time:
     break;
   case k_user_revfx_param_depth:
-    s_len = 1 + valf * valf * 0.1f * 48000.f; // up to 100ms delay
+    s_len.setTarget(1 + valf * valf * 0.1f * 48000.f); // up to 100ms delay
     break;
   case k_user_revfx_param_shift_depth:
     // Rescale to add notch around 0.5f
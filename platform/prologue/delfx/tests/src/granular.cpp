@@ -0,0 +1,70 @@
+/*
+ * File: granular.cpp
+ *
+ * Test granular pitch shifter with buffer in SDRAM
+ *
+ * 
+ * 
+ * 2018 (c) Korg
+ *
+ */
+
+#include "userdelfx.h"
+
+#include "granular.hpp"
+
+#define BUFFER_SIZE 32768
+
+static dsp::GrainShifter<4> s_shifter;
+
+static __sdram f32pair_t s_shifter_ram[BUFFER_SIZE];
+
+static float s_mix;
+
+void DELFX_INIT(uint32_t platform, uint32_t api)
+{
+  s_shifter.setMemory(s_shifter_ram, BUFFER_SIZE);
+  s_shifter.setGrain(2400.f, 4.f);
+  s_shifter.setDelay(480.f);
+  s_mix = 0.5f;
+}
+
+void DELFX_PROCESS(float *xn, uint32_t frames)
+{
+  float * __restrict x = xn;
+  const float * x_e = x + 2*frames;
+
+  const float dry = 1.f - s_mix;
+  const float wet = s_mix;
+
+  float wet_buf[2*64];
+  
+  for (; x != x_e; ) {
+    const uint32_t n = (x_e - x) > 2*64 ? 64 : (x_e - x) / 2;
+    s_shifter.process(x, wet_buf, n);
+    for (uint32_t i = 0; i < 2*n; ++i)
+      x[i] = dry * x[i] + wet * wet_buf[i];
+    x += 2*n;
+  }
+}
+
+
+void DELFX_PARAM(uint8_t index, int32_t value)
+{
+  const float valf = q31_to_f32(value);
+  switch (index) {
+  case k_user_delfx_param_time:
+    // -12 to +12 semitones
+    s_shifter.setPitch(0.5f * fx_pow2f(2.f * valf));
+    break;
+  case k_user_delfx_param_depth:
+    s_mix = valf;
+    break;
+  case k_user_delfx_param_shift_depth:
+    s_shifter.setStretch(1.f - valf);
+    break;
+  default:
+    break;
+  }
+}
+
@@ -0,0 +1,19 @@
+# #############################################################################
+# Project Customization
+# #############################################################################
+
+include $(PLATFORMDIR)/modfx.mk
+
+PROJECT = chorus_test
+
+UCSRC = 
+
+UCXXSRC = ../src/chorus.cpp
+
+UINCDIR =
+
+UDEFS =
+
+ULIB = 
+
+ULIBDIR =
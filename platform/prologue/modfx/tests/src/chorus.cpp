@@ -0,0 +1,55 @@
+/*
+ * File: chorus.cpp
+ *
+ * Test multi-voice chorus over SDRAM delay line, main and sub in one pass
+ *
+ * 
+ * 
+ * 2018 (c) Korg
+ *
+ */
+
+#include "usermodfx.h"
+
+#include "chorus.hpp"
+#include "profile.h"
+
+static dsp::Chorus<3> s_chorus;
+
+static __sdram f32pair_t s_chorus_ram[8192];
+
+static const float s_fs_recip = 1.f / 48000.f;
+
+void MODFX_INIT(uint32_t platform, uint32_t api)
+{
+  s_chorus.setMemory(s_chorus_ram, 8192);
+  s_chorus.setDelay(480.f);
+  s_chorus.setModulation(0.5f, 96.f, s_fs_recip);
+  s_chorus.setVibrato(6.f, 8.f, s_fs_recip);
+}
+
+void MODFX_PROCESS(const float *main_xn, float *main_yn,
+                   const float *sub_xn,  float *sub_yn,
+                   uint32_t frames)
+{
+  PROF_SCOPE("chorus");
+  s_chorus.process(main_xn, main_yn, sub_xn, sub_yn, frames);
+}
+
+
+void MODFX_PARAM(uint8_t index, int32_t value)
+{
+  const float valf = q31_to_f32(value);
+  switch (index) {
+  case k_user_modfx_param_time:
+    // 0.05 to 5Hz
+    s_chorus.setModulation(0.05f + 4.95f * valf * valf, 96.f, s_fs_recip);
+    break;
+  case k_user_modfx_param_depth:
+    s_chorus.setMix(1.f - 0.5f * valf, 0.5f * valf);
+    break;
+  default:
+    break;
+  }
+}
+
@@ -0,0 +1,64 @@
+/*
+ * File: dynamics.cpp
+ *
+ * Test compressor with look-ahead in SDRAM on main and sub timbres
+ *
+ * 
+ * 
+ * 2018 (c) Korg
+ *
+ */
+
+#include "usermodfx.h"
+
+#include "dynamics.hpp"
+
+#define LOOKAHEAD 48
+
+static dsp::Compressor<16> s_comp_main;
+static dsp::Compressor<16> s_comp_sub;
+
+static __sdram f32pair_t s_lookahead_ram[2][64];
+
+static const float s_fs_recip = 1.f / 48000.f;
+
+void MODFX_INIT(uint32_t platform, uint32_t api)
+{
+  s_comp_main.setCurve(-18.f, 4.f, 6.f);
+  s_comp_main.setTimes(0.002f, 0.15f, s_fs_recip);
+  s_comp_main.setLookahead(s_lookahead_ram[0], 64, LOOKAHEAD);
+  s_comp_sub.setCurve(-18.f, 4.f, 6.f);
+  s_comp_sub.setTimes(0.002f, 0.15f, s_fs_recip);
+  s_comp_sub.setLookahead(s_lookahead_ram[1], 64, LOOKAHEAD);
+}
+
+void MODFX_PROCESS(const float *main_xn, float *main_yn,
+                   const float *sub_xn,  float *sub_yn,
+                   uint32_t frames)
+{
+  s_comp_main.process(main_xn, main_yn, frames);
+  s_comp_sub.process(sub_xn, sub_yn, frames);
+}
+
+
+void MODFX_PARAM(uint8_t index, int32_t value)
+{
+  const float valf = q31_to_f32(value);
+  switch (index) {
+  case k_user_modfx_param_time:
+    // Threshold from 0 to -48dBFS, with matching makeup gain
+    s_comp_main.setCurve(-48.f * valf, 4.f, 6.f);
+    s_comp_main.setMakeup(27.f * valf);
+    s_comp_sub.setCurve(-48.f * valf, 4.f, 6.f);
+    s_comp_sub.setMakeup(27.f * valf);
+    break;
+  case k_user_modfx_param_depth:
+    // Release from 20ms to 1s
+    s_comp_main.setTimes(0.002f, 0.02f + 0.98f * valf, s_fs_recip);
+    s_comp_sub.setTimes(0.002f, 0.02f + 0.98f * valf, s_fs_recip);
+    break;
+  default:
+    break;
+  }
+}
+
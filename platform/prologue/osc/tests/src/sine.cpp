@@ -39,6 +39,7 @@
  */
 
 #include "userosc.h"
+#include "userevents.h"
 
 typedef struct State {
   float w0;
@@ -76,31 +77,49 @@ void OSC_CYCLE(const user_osc_param_t * const params,
   const float w0 = s_state.w0 = osc_w0f_for_note((params->pitch)>>8, params->pitch & 0xFF);
   float phase = (flags & k_flag_reset) ? 0.f : s_state.phase;
   
-  const float drive = s_state.drive;
-  const float dist  = s_state.dist;
+  float drive = s_state.drive;
+  float dist  = s_state.dist;
 
   const float lfo = s_state.lfo = q31_to_f32(params->shape_lfo);
   float lfoz = (flags & k_flag_reset) ? lfo : s_state.lfoz;
   const float lfo_inc = (lfo - lfoz) / frames;
+
+  // Parameter changes within the block, when the runtime provides them
+  const user_event_t *ev;
+  const uint32_t ev_cnt = user_events_get(USER_EVENT_MASK(k_user_event_param), &ev);
+  const user_event_t *ev_e = ev + ev_cnt;
   
   q31_t * __restrict y = (q31_t *)yn;
   const q31_t * y_e = y + frames;
   
-  for (; y != y_e; ) {
-    const float dist_mod = dist + lfoz * dist;
+  for (;;) {
+    // Render up to the next event
+    const q31_t * y_seg = (ev != ev_e) ? (q31_t *)yn + ev->offset : y_e;
+
+    for (; y != y_seg; ) {
+      const float dist_mod = dist + lfoz * dist;
     
-    // Phase distortion
-    float p = phase + linintf(dist_mod, 0.f, dist_mod * osc_sinf(phase));
-    p = (p <= 0) ? 1.f - p : p - (uint32_t)p;
+      // Phase distortion
+      float p = phase + linintf(dist_mod, 0.f, dist_mod * osc_sinf(phase));
+      p = (p <= 0) ? 1.f - p : p - (uint32_t)p;
 
-    // Main signal
-    const float sig  = osc_softclipf(0.05f, drive * osc_sinf(p));
-    *(y++) = f32_to_q31(sig);
+      // Main signal
+      const float sig  = osc_softclipf(0.05f, drive * osc_sinf(p));
+      *(y++) = f32_to_q31(sig);
     
-    phase += w0;
-    phase -= (uint32_t)phase;
+      phase += w0;
+      phase -= (uint32_t)phase;
+
+      lfoz += lfo_inc;
+    }
+
+    if (ev == ev_e)
+      break;
 
-    lfoz += lfo_inc;
+    _hook_param(ev->index, ev->value);
+    drive = s_state.drive;
+    dist = s_state.dist;
+    ++ev;
   }
   
   s_state.phase = phase;